@@ -0,0 +1,64 @@
+#ifndef FieldComposite_h
+#define FieldComposite_h 1
+
+#include <DD4hep/FieldTypes.h>
+
+#include <memory>
+#include <vector>
+
+/**
+   Magnetic field made of several field maps (FieldXYZ, FieldBrBz, FieldRPhiZ or any other
+   magnetic field element) and an optional constant field used outside all of them.
+
+   The bounding boxes of the maps are indexed in a coarse regular grid covering their union, so that
+   each lookup only evaluates the maps whose box overlaps the grid cell of the query point. Fields
+   without a known bounding box are evaluated everywhere.
+
+   Example XML for the fields section of the compact XML:
+
+     <field name="MDIField" type="FieldComposite" indexBins="32">
+       <field name="Solenoid" type="FieldBrBz" ... />
+       <field name="QD0Left" type="FieldXYZ" ... />
+       <strength x="0" y="0" z="2*tesla"/>
+     </field>
+ */
+class FieldComposite : public dd4hep::CartesianField::Object {
+public:
+  /// Region where a field is non-zero
+  struct Box {
+    double min[3];
+    double max[3];
+    bool contains(const double* pos) const {
+      return pos[0] >= min[0] && pos[0] <= max[0] && pos[1] >= min[1] && pos[1] <= max[1] && pos[2] >= min[2] &&
+             pos[2] <= max[2];
+    }
+  };
+
+  std::vector<std::unique_ptr<dd4hep::CartesianField::Object>> fields; // all fields, owned by the composite
+  std::vector<Box> boxes;                                              // bounding box of the bounded fields
+  std::vector<int> boundedFields;                                      // index in fields of the boxes
+  std::vector<int> unboundedFields;                                    // fields evaluated everywhere
+
+  int nIndexBins[3];                 // cells per axis of the grid index
+  double indexMin[3], indexMax[3];   // union of the bounding boxes
+  double indexInvStep[3];            // reciprocal cell size of the grid index
+  std::vector<int> cellOffsets;      // first entry in cellFields of each cell, plus the end of the last cell
+  std::vector<int> cellFields;       // bounded fields (index in boxes) overlapping each cell
+
+  bool hasFallback;         // use fallbackField outside all boxes
+  double fallbackField[3];  // constant field outside all boxes
+
+public:
+  /// Initializing constructor
+  FieldComposite();
+  /// Call to access the field components at a given location
+  virtual void fieldComponents(const double* pos, double* field);
+  /// Take ownership of field, its bounding box is deduced from the known field map types
+  void add(dd4hep::CartesianField::Object* field);
+  /// Build the grid index with nBins cells per axis, must be called after the last add()
+  void buildIndex(int nBins);
+  /// Bounding box of the known field map types, false if the field type has no bounds
+  static bool boundingBox(const dd4hep::CartesianField::Object* field, Box& box);
+};
+
+#endif // FieldComposite_h
@@ -3,6 +3,10 @@
 
 #include <DD4hep/FieldTypes.h>
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -31,15 +35,37 @@ public:
   double bScale;                       // Bfield scale factor
   std::vector<FieldValues_t> fieldMap; // List with the field map points
 
+  std::string cacheFile;                    // binary cache of the field map, not used if empty
+  const FieldValues_t* mappedFieldMap;      // field map points mapped from cacheFile, used instead of fieldMap
+  std::shared_ptr<const void> mappedRegion; // keeps cacheFile mapped while mappedFieldMap is in use
+
+  // Lookups through the cell cache and inside the cached cell, flushed from the threads. Shared with the
+  // thread-local caches, which flush their last lookups when they give up the cell, even after the map is deleted
+  struct CellCacheCounters {
+    std::atomic<std::uint64_t> lookups{0};
+    std::atomic<std::uint64_t> hits{0};
+  };
+
+  bool useCellCache;                                // keep the last bin used by each thread, see fieldComponents
+  std::uint64_t cellCacheId;                        // unique identifier of the map in the thread-local cell caches
+  std::shared_ptr<CellCacheCounters> cacheCounters; // cell cache statistics of the map
+
 public:
   /// Initializing constructor
   FieldMapBrBz();
+  /// Destructor, prints the cell cache statistics
+  virtual ~FieldMapBrBz();
   /// Call to access the field components at a given location
   virtual void fieldComponents(const double* pos, double* field);
+  /// Field components at n locations given in SoA layout, the fields are added to bx, by and bz
+  void batchFieldComponents(std::size_t n, const double* x, const double* y, const double* z, double* bx, double* by,
+                            double* bz);
   /// Field the FieldMap from the the tree specified in the XML
   void fillFieldMapFromTree(const std::string& filename, double coorUnits, double BfieldUnits);
   /// Get global index in the Field map
   int getGlobalIndex(const int rBin, const int zBin);
+  /// Field map points, from the cache if it is mapped or from fieldMap
+  const FieldValues_t* nodes() const { return mappedFieldMap ? mappedFieldMap : fieldMap.data(); }
 };
 
 #endif // FieldMap_rzBrBz_h
@@ -0,0 +1,74 @@
+#ifndef FieldMap_RPhiZ_h
+#define FieldMap_RPhiZ_h 1
+
+#include <DD4hep/FieldTypes.h>
+
+#include <string>
+#include <vector>
+
+/**
+   3D field map in cylindrical coordinates (rho, phi, z), with the field given as Brho, Bphi and Bz.
+   The phi nodes must cover a full turn, the map is periodic in phi.
+
+   The field is interpolated linearly in rho and z, and in phi along the chord between the two phi
+   nodes: the azimuthal weight is sin(phi - phi0) / (sin(phi - phi0) + sin(phi1 - phi)), which only
+   needs cross products with the precomputed node directions. The phi bin of the previous lookup of
+   the thread is tried first, atan2 is only used when the point left it.
+ */
+class FieldMapRPhiZ : public dd4hep::CartesianField::Object {
+public:
+  struct FieldValues_t {
+    double Brho;
+    double Bphi;
+    double Bz;
+    FieldValues_t(double _Brho, double _Bphi, double _Bz) : Brho(_Brho), Bphi(_Bphi), Bz(_Bz) {}
+  };
+
+  int coorsOrder; // integer with the order with which variables are scanned in the fieldmap, 1(2) for RPZ(RZP) order
+  std::string strCoorsOrder; // string  with the order with which variables are scanned in the fieldmap, e.g. RPZ
+  std::string ntupleName;    // tree name
+  std::string rhoVar;        // rho  coordinate name in tree
+  std::string phiVar;        // phi  coordinate name in tree
+  std::string zVar;          // z    coordinate name in tree
+  std::string BrhoVar;       // Brho component  name in tree
+  std::string BphiVar;       // Bphi component  name in tree
+  std::string BzVar;         // Bz   component  name in tree
+
+  int nRho, nPhi, nZ;             // bins in rho, phi and z coordinates in fieldmap, nPhi distinct nodes over 2 pi
+  int rhoOrdering;                // rho coordinate ordering, 1(-1) if from low-to-high (high-to-low)
+  double rhoMin, rhoMax, rhoStep; // min, max and step-size of rho coordinate in fieldmap
+  int phiOrdering;                // phi coordinate ordering, 1(-1) if from low-to-high (high-to-low)
+  double phiMin, phiStep;         // first node and step-size of phi coordinate in fieldmap
+  int zOrdering;                  // z   coordinate ordering, 1(-1) if from low-to-high (high-to-low)
+  double zMin, zMax, zStep;       // min, max and step-size of z coordinate in fieldmap
+
+  double bScale;                       // Bfield scale factor
+  std::vector<FieldValues_t> fieldMap; // List with the field map points, in RPhiZ order
+
+  double rhoInvStep, zInvStep, phiInvStep; // reciprocal step-sizes
+  std::vector<double> cosPhi, sinPhi;      // direction of the phi nodes, nPhi + 1 entries to close the turn
+
+public:
+  /// Initializing constructor
+  FieldMapRPhiZ();
+  /// Call to access the field components at a given location
+  virtual void fieldComponents(const double* pos, double* field);
+  /// Field the FieldMap from the the tree specified in the XML
+  void fillFieldMapFromTree(const std::string& filename, double coorUnits, double phiUnits, double BfieldUnits);
+  /// Get global index in the Field map
+  int getGlobalIndex(const int rhoBin, const int phiBin, const int zBin, const int nTreePhi);
+  /// Precompute the phi node directions and the reciprocal step-sizes, once the grid parameters are final
+  void buildTables();
+
+private:
+  /// True if (x, y) is in phi bin, with the cross products of (x, y) with the bin edges
+  bool inPhiBin(int phiBin, double x, double y, double& c0, double& c1) const {
+    c0 = cosPhi[phiBin] * y - sinPhi[phiBin] * x;
+    c1 = sinPhi[phiBin + 1] * x - cosPhi[phiBin + 1] * y;
+    return c0 >= 0 && c1 >= 0;
+  }
+  /// Phi bin containing (x, y) from atan2, with the cross products of (x, y) with the bin edges
+  int findPhiBin(double x, double y, double& c0, double& c1) const;
+};
+
+#endif // FieldMap_RPhiZ_h
@@ -3,6 +3,10 @@
 
 #include <DD4hep/FieldTypes.h>
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -14,6 +18,11 @@ public:
     double Bz;
     FieldValues_t(double _Bx, double _By, double _Bz) : Bx(_Bx), By(_By), Bz(_Bz) {}
   };
+  struct FloatFieldValues_t {
+    float Bx;
+    float By;
+    float Bz;
+  };
 
   int coorsOrder; // integer with the order with which variables are scanned in the fieldmap, 1(2) for RZ(ZR) order
   std::string strCoorsOrder; // string  with the order with which variables are scanned in the fieldmap, RZ or ZR order
@@ -36,16 +45,81 @@ public:
   double bScale;                       // Bfield scale factor
   std::vector<FieldValues_t> fieldMap; // List with the field map points
 
+  std::string cacheFile;                    // binary cache of the field map, not used if empty
+  const FieldValues_t* mappedFieldMap;      // field map points mapped from cacheFile, used instead of fieldMap
+  std::shared_ptr<const void> mappedRegion; // keeps cacheFile mapped while mappedFieldMap is in use
+
+  bool floatStorage;                             // store the packed cells or the points in single precision
+  std::vector<FloatFieldValues_t> fieldMapFloat; // field map points in single precision, used with floatStorage
+
+  bool usePackedCells;                   // interpolate from the packed cells instead of fieldMap
+  double xInvStep, yInvStep, zInvStep;   // reciprocal step-sizes used by the packed cells lookup
+  std::vector<float> packedCellsFloat;   // 8 corners x 3 components per grid cell, single precision
+  std::vector<double> packedCellsDouble; // 8 corners x 3 components per grid cell, double precision
+
+  static constexpr int packedCellSize = 24; // values per packed cell, ordered Bx[8], By[8], Bz[8]
+
+  bool useCubic;                          // tricubic Hermite interpolation from hermiteNodes instead of trilinear
+  std::vector<float> hermiteNodesFloat;   // value and 7 derivatives x 3 components per grid node, single precision
+  std::vector<double> hermiteNodesDouble; // value and 7 derivatives x 3 components per grid node, double precision
+
+  // values per Hermite node, ordered Bx[8], By[8], Bz[8]. Entry d is the derivative of order d & 1 in x,
+  // (d >> 1) & 1 in y and d >> 2 in z, in units of the grid steps
+  static constexpr int hermiteNodeSize = 24;
+
+  // Lookups through the cell cache and inside the cached cell, flushed from the threads. Shared with the
+  // thread-local caches, which flush their last lookups when they give up the cell, even after the map is deleted
+  struct CellCacheCounters {
+    std::atomic<std::uint64_t> lookups{0};
+    std::atomic<std::uint64_t> hits{0};
+  };
+
+  bool useCellCache;                                // keep the last cell used by each thread, see cachedFieldComponents
+  std::uint64_t cellCacheId;                        // unique identifier of the map in the thread-local cell caches
+  std::shared_ptr<CellCacheCounters> cacheCounters; // cell cache statistics of the map
+
+  bool hasSymmetry;         // at least one mirror symmetry is declared
+  bool mirror[3];           // mirror symmetry in x, y and z, only the x (y, z) >= 0 part of the map is stored
+  double mirrorSigns[3][3]; // sign of Bx, By and Bz after mirroring in x, y and z
+
 public:
   /// Initializing constructor
   FieldMapXYZ();
+  /// Destructor, prints the cell cache statistics
+  virtual ~FieldMapXYZ();
 
   /// Call to access the field components at a given location
   virtual void fieldComponents(const double* pos, double* field);
+  /// Field components at n locations given in SoA layout, the fields are added to bx, by and bz
+  void batchFieldComponents(std::size_t n, const double* x, const double* y, const double* z, double* bx, double* by,
+                            double* bz);
   /// Field the FieldMap from the the tree specified in the XML
   void fillFieldMapFromTree(const std::string& filename, double coorUnits, double BfieldUnits);
   /// Get global index in the Field map
   int getGlobalIndex(const int xBin, const int yBin, const int zBin);
+  /// Field map points, from the cache if it is mapped or from fieldMap
+  const FieldValues_t* nodes() const { return mappedFieldMap ? mappedFieldMap : fieldMap.data(); }
+  /// Build the packed cells from fieldMap, must be called once the grid parameters are final
+  void buildPackedCells();
+  /// Build the Hermite nodes from fieldMap, must be called once the grid parameters are final
+  void buildHermiteNodes();
+  /// Build the storage used for the lookups (packed cells, Hermite nodes, single precision points), releasing the
+  /// double precision points if they are not used anymore. Must be called once the grid parameters are final
+  void buildStorage();
+  /// Memory used by the field storage in bytes
+  std::size_t storageBytes() const;
+
+private:
+  /// Field lookup in the stored part of the map
+  void interpolate(const double* pos, double* field) const;
+  /// Field lookup from the field map points
+  template <typename Node> void nodeFieldComponents(const Node* fieldNodes, const double* pos, double* field) const;
+  /// Field lookup from the field map points, through the last cell used by the thread
+  template <typename Node> void cachedFieldComponents(const Node* fieldNodes, const double* pos, double* field) const;
+  /// Field lookup from the packed cells
+  template <typename T> void packedFieldComponents(const T* cells, const double* pos, double* field) const;
+  /// Field lookup from the Hermite nodes
+  template <typename T> void hermiteFieldComponents(const T* hermiteNodes, const double* pos, double* field) const;
 };
 
 #endif // FieldMap_XYZ_h
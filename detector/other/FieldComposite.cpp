@@ -0,0 +1,216 @@
+#include "FieldComposite.h"
+#include "FieldMapBrBz.h"
+#include "FieldMapRPhiZ.h"
+#include "FieldMapXYZ.h"
+
+#include <DD4hep/Version.h>
+#if DD4HEP_VERSION_GE(0, 24)
+#include <DD4hep/detail/Handle.inl>
+#else
+#include <DD4hep/Handle.inl>
+#endif
+
+#include <DD4hep/DetFactoryHelper.h>
+#include <DD4hep/Plugins.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using dd4hep::CartesianField;
+using dd4hep::Detector;
+using dd4hep::Ref_t;
+
+DD4HEP_INSTANTIATE_HANDLE(FieldComposite);
+
+FieldComposite::FieldComposite()
+    : nIndexBins{0, 0, 0}, indexMin{0., 0., 0.}, indexMax{-1., -1., -1.}, indexInvStep{0., 0., 0.},
+      hasFallback(false), fallbackField{0., 0., 0.} {
+  field_type = CartesianField::MAGNETIC;
+  type = CartesianField::MAGNETIC;
+} // ctor
+
+void FieldComposite::fieldComponents(const double* pos, double* globalField) {
+
+  for (const int i : unboundedFields)
+    fields[i]->fieldComponents(pos, globalField);
+
+  // Only the maps overlapping the cell of the grid index can contain the point
+  bool insideMap = false;
+  if (pos[0] >= indexMin[0] && pos[0] <= indexMax[0] && pos[1] >= indexMin[1] && pos[1] <= indexMax[1] &&
+      pos[2] >= indexMin[2] && pos[2] <= indexMax[2]) {
+    const int xCell = std::min(int((pos[0] - indexMin[0]) * indexInvStep[0]), nIndexBins[0] - 1);
+    const int yCell = std::min(int((pos[1] - indexMin[1]) * indexInvStep[1]), nIndexBins[1] - 1);
+    const int zCell = std::min(int((pos[2] - indexMin[2]) * indexInvStep[2]), nIndexBins[2] - 1);
+    const int cell = xCell + nIndexBins[0] * (yCell + nIndexBins[1] * zCell);
+    for (int k = cellOffsets[cell]; k < cellOffsets[cell + 1]; k++) {
+      const int b = cellFields[k];
+      if (boxes[b].contains(pos)) {
+        insideMap = true;
+        fields[boundedFields[b]]->fieldComponents(pos, globalField);
+      }
+    }
+  }
+
+  if (hasFallback && not insideMap) {
+    globalField[0] += fallbackField[0];
+    globalField[1] += fallbackField[1];
+    globalField[2] += fallbackField[2];
+  }
+}
+
+void FieldComposite::add(CartesianField::Object* field) {
+
+  fields.emplace_back(field);
+  Box box;
+  if (boundingBox(field, box)) {
+    boxes.push_back(box);
+    boundedFields.push_back(fields.size() - 1);
+  } else {
+    unboundedFields.push_back(fields.size() - 1);
+  }
+}
+
+bool FieldComposite::boundingBox(const CartesianField::Object* field, Box& box) {
+
+  if (const FieldMapXYZ* mapXYZ = dynamic_cast<const FieldMapXYZ*>(field)) {
+    const double mins[3] = {mapXYZ->xMin, mapXYZ->yMin, mapXYZ->zMin};
+    const double maxs[3] = {mapXYZ->xMax, mapXYZ->yMax, mapXYZ->zMax};
+    for (int axis = 0; axis < 3; axis++) {
+      box.min[axis] = mapXYZ->mirror[axis] ? -maxs[axis] : mins[axis];
+      box.max[axis] = maxs[axis];
+    }
+    return true;
+  }
+  // FieldMapBrBz is mirrored in z and extends the map down to rho = 0 and z = 0
+  if (const FieldMapBrBz* mapBrBz = dynamic_cast<const FieldMapBrBz*>(field)) {
+    box = {{-mapBrBz->rhoMax, -mapBrBz->rhoMax, -mapBrBz->zMax}, {mapBrBz->rhoMax, mapBrBz->rhoMax, mapBrBz->zMax}};
+    return true;
+  }
+  // FieldMapRPhiZ covers the full turn, between zMin and zMax
+  if (const FieldMapRPhiZ* mapRPhiZ = dynamic_cast<const FieldMapRPhiZ*>(field)) {
+    const double rhoMax = mapRPhiZ->rhoMax;
+    box = {{-rhoMax, -rhoMax, mapRPhiZ->zMin}, {rhoMax, rhoMax, mapRPhiZ->zMax}};
+    return true;
+  }
+  return false;
+}
+
+/**
+   Grid over the union of the bounding boxes, each cell lists the boxes overlapping it. The cells
+   of a box are found with the same arithmetic as in fieldComponents, so a point inside a box is
+   always in one of its cells
+ */
+void FieldComposite::buildIndex(int nBins) {
+
+  cellOffsets.clear();
+  cellFields.clear();
+  if (boxes.empty()) {
+    nIndexBins[0] = nIndexBins[1] = nIndexBins[2] = 0;
+    return;
+  }
+
+  for (int axis = 0; axis < 3; axis++) {
+    indexMin[axis] = boxes.front().min[axis];
+    indexMax[axis] = boxes.front().max[axis];
+    for (const Box& box : boxes) {
+      indexMin[axis] = std::min(indexMin[axis], box.min[axis]);
+      indexMax[axis] = std::max(indexMax[axis], box.max[axis]);
+    }
+    nIndexBins[axis] = std::max(nBins, 1);
+    const double size = indexMax[axis] - indexMin[axis];
+    indexInvStep[axis] = size > 0 ? nIndexBins[axis] / size : 0.;
+  }
+
+  auto cellRange = [this](const Box& box, int axis, int& first, int& last) {
+    first = std::min(int((box.min[axis] - indexMin[axis]) * indexInvStep[axis]), nIndexBins[axis] - 1);
+    last = std::min(int((box.max[axis] - indexMin[axis]) * indexInvStep[axis]), nIndexBins[axis] - 1);
+  };
+
+  // Count the boxes per cell, then fill them in the order they were added
+  const int nCells = nIndexBins[0] * nIndexBins[1] * nIndexBins[2];
+  cellOffsets.assign(nCells + 1, 0);
+  for (int pass = 0; pass < 2; pass++) {
+    std::vector<int> filled(cellOffsets.begin(), cellOffsets.end() - 1);
+    for (std::size_t b = 0; b < boxes.size(); b++) {
+      int first[3], last[3];
+      for (int axis = 0; axis < 3; axis++)
+        cellRange(boxes[b], axis, first[axis], last[axis]);
+      for (int iz = first[2]; iz <= last[2]; iz++) {
+        for (int iy = first[1]; iy <= last[1]; iy++) {
+          for (int ix = first[0]; ix <= last[0]; ix++) {
+            const int cell = ix + nIndexBins[0] * (iy + nIndexBins[1] * iz);
+            if (pass == 0)
+              cellOffsets[cell + 1]++;
+            else
+              cellFields[filled[cell]++] = b;
+          }
+        }
+      }
+    }
+    if (pass == 0) {
+      for (int cell = 0; cell < nCells; cell++)
+        cellOffsets[cell + 1] += cellOffsets[cell];
+      cellFields.resize(cellOffsets.back());
+    }
+  }
+}
+
+static Ref_t create_FieldComposite(Detector& description, dd4hep::xml::Handle_t handle) {
+  dd4hep::xml::Component xmlParameter(handle);
+  const int indexBins = xmlParameter.attr<int>(_Unicode(indexBins), 16);
+
+  std::unique_ptr<FieldComposite> ptr(new FieldComposite());
+
+  // The fields are created by their own plugins, as if they were in the fields section
+  for (xml_coll_t c(handle, _Unicode(field)); c; ++c) {
+    dd4hep::xml::Handle_t childHandle = c;
+    dd4hep::xml::Component xmlChild(childHandle);
+    const std::string childType = xmlChild.attr<std::string>(_Unicode(type));
+    dd4hep::NamedObject* child =
+        dd4hep::PluginService::Create<dd4hep::NamedObject*>(childType, &description, &childHandle);
+    CartesianField::Object* field = dynamic_cast<CartesianField::Object*>(child);
+    if (not field || field->field_type != CartesianField::MAGNETIC) {
+      std::stringstream error;
+      error << "FieldComposite[ERROR]: " << childType << " is not a magnetic field type";
+      throw std::runtime_error(error.str());
+    }
+    ptr->add(field);
+  }
+
+  // Constant field outside all maps, with the same syntax as ConstantField
+  if (xmlParameter.hasChild(_Unicode(strength))) {
+    dd4hep::xml::Component strength = xmlParameter.child(_Unicode(strength));
+    ptr->hasFallback = true;
+    ptr->fallbackField[0] = strength.attr<double>(_Unicode(x), 0.);
+    ptr->fallbackField[1] = strength.attr<double>(_Unicode(y), 0.);
+    ptr->fallbackField[2] = strength.attr<double>(_Unicode(z), 0.);
+  }
+
+  ptr->buildIndex(indexBins);
+
+  std::cout << "FieldComposite with " << ptr->fields.size() << " fields" << std::endl;
+  for (std::size_t b = 0; b < ptr->boxes.size(); b++) {
+    const FieldComposite::Box& box = ptr->boxes[b];
+    std::cout << std::setw(24) << ptr->fields[ptr->boundedFields[b]]->name << " x [" << box.min[0] / dd4hep::cm << ", "
+              << box.max[0] / dd4hep::cm << "] y [" << box.min[1] / dd4hep::cm << ", " << box.max[1] / dd4hep::cm
+              << "] z [" << box.min[2] / dd4hep::cm << ", " << box.max[2] / dd4hep::cm << "] cm" << std::endl;
+  }
+  for (const int i : ptr->unboundedFields)
+    std::cout << std::setw(24) << ptr->fields[i]->name << " evaluated everywhere" << std::endl;
+  const double nCells = std::max(1, ptr->nIndexBins[0] * ptr->nIndexBins[1] * ptr->nIndexBins[2]);
+  std::cout << "indexBins   " << std::setw(13) << indexBins << std::endl;
+  std::cout << "mapsPerCell " << std::setw(13) << ptr->cellFields.size() / nCells << std::endl;
+  if (ptr->hasFallback)
+    std::cout << "fallback    " << std::setw(13) << ptr->fallbackField[0] / dd4hep::tesla << " "
+              << ptr->fallbackField[1] / dd4hep::tesla << " " << ptr->fallbackField[2] / dd4hep::tesla << " tesla"
+              << std::endl;
+
+  CartesianField obj;
+  obj.assign(ptr.release(), xmlParameter.nameStr(), xmlParameter.typeStr());
+
+  return obj;
+}
+DECLARE_XMLELEMENT(FieldComposite, create_FieldComposite)
@@ -1,4 +1,6 @@
 #include "FieldMapBrBz.h"
+#include "FieldMapCache.h"
+#include "FieldMapSimd.h"
 
 #include <DD4hep/Version.h>
 #if DD4HEP_VERSION_GE(0, 24)
@@ -12,8 +14,12 @@
 #include <TFile.h>
 #include <TTree.h>
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 #include <stdexcept>
 #include <string>
 
@@ -24,6 +30,9 @@ using dd4hep::Ref_t;
 DD4HEP_INSTANTIATE_HANDLE(FieldMapBrBz);
 
 namespace {
+// Size of the TTree cache used for the sequential read of the field map
+const long long treeCacheSize = 64 * 1024 * 1024;
+
 void checkBranch(int retCode) {
 
   if (retCode != 0) {
@@ -32,13 +41,150 @@ void checkBranch(int retCode) {
     throw std::runtime_error(error.str());
   }
 }
+
+// Use the cached field map if it is valid for the identification in header
+bool readCache(FieldMapBrBz& map, FieldMapCache::Header& header) {
+
+  const double* values = FieldMapCache::load(map.cacheFile, header, map.mappedRegion);
+  if (not values)
+    return false;
+
+  map.nRho = header.nBins[0];
+  map.nZ = header.nBins[1];
+  map.rhoOrdering = header.ordering[0];
+  map.zOrdering = header.ordering[1];
+  map.coorsOrder = header.coorsOrder;
+  map.strCoorsOrder = header.strCoorsOrder;
+  map.rhoMin = header.gridMin[0];
+  map.zMin = header.gridMin[1];
+  map.rhoMax = header.gridMax[0];
+  map.zMax = header.gridMax[1];
+  map.rhoStep = header.gridStep[0];
+  map.zStep = header.gridStep[1];
+
+  if (header.nValues != 2 * std::uint64_t(map.nRho) * map.nZ) {
+    map.mappedRegion.reset();
+    return false;
+  }
+  std::vector<FieldMapBrBz::FieldValues_t>().swap(map.fieldMap);
+  map.mappedFieldMap = reinterpret_cast<const FieldMapBrBz::FieldValues_t*>(values);
+  return true;
+}
+
+void writeCache(const FieldMapBrBz& map, FieldMapCache::Header header) {
+
+  header.nBins[0] = map.nRho;
+  header.nBins[1] = map.nZ;
+  header.ordering[0] = map.rhoOrdering;
+  header.ordering[1] = map.zOrdering;
+  header.coorsOrder = map.coorsOrder;
+  map.strCoorsOrder.copy(header.strCoorsOrder, sizeof(header.strCoorsOrder) - 1);
+  header.gridMin[0] = map.rhoMin;
+  header.gridMin[1] = map.zMin;
+  header.gridMax[0] = map.rhoMax;
+  header.gridMax[1] = map.zMax;
+  header.gridStep[0] = map.rhoStep;
+  header.gridStep[1] = map.zStep;
+
+  FieldMapCache::store(map.cacheFile, header, reinterpret_cast<const double*>(map.fieldMap.data()),
+                       2 * map.fieldMap.size());
+}
+
+// Last (rho, z) bin used by the thread in a map: field at the 4 corners (corner c at rBin + (c & 1), zBin + (c >> 1)),
+// and the lookups not yet flushed to the map
+struct CellCacheBrBz {
+  std::uint64_t owner = 0; // cellCacheId of the map the cell belongs to, 0 if empty
+  int rBin = -1, zBin = -1;
+  double Br[4];
+  double Bz[4];
+  std::uint64_t lookups = 0;
+  std::uint64_t hits = 0;
+};
+
+// Bin caches of the thread, one per map, as for FieldMapXYZ
+const int cellCacheSlots = 8;
+// Set while the caches of the thread exist, as for FieldMapXYZ
+thread_local bool cellCachesBrBzAlive = false;
+struct CellCachesBrBz {
+  CellCacheBrBz cells[cellCacheSlots];
+  std::shared_ptr<FieldMapBrBz::CellCacheCounters> counters[cellCacheSlots]; // counters of the owners
+  int lastSlot = 0;                                                          // slot of the last lookup
+  int nextSlot = 0;                                                          // slot taken by the next map
+
+  void flush(int slot) {
+    if (counters[slot]) {
+      counters[slot]->lookups += cells[slot].lookups;
+      counters[slot]->hits += cells[slot].hits;
+    }
+    cells[slot].lookups = 0;
+    cells[slot].hits = 0;
+  }
+
+  CellCacheBrBz& cell(std::uint64_t owner, const std::shared_ptr<FieldMapBrBz::CellCacheCounters>& ownerCounters) {
+    if (cells[lastSlot].owner == owner)
+      return cells[lastSlot];
+    for (int slot = 0; slot < cellCacheSlots; slot++) {
+      if (cells[slot].owner == owner) {
+        lastSlot = slot;
+        return cells[slot];
+      }
+    }
+    lastSlot = nextSlot;
+    nextSlot = (nextSlot + 1) % cellCacheSlots;
+    flush(lastSlot);
+    cells[lastSlot] = CellCacheBrBz();
+    cells[lastSlot].owner = owner;
+    counters[lastSlot] = ownerCounters;
+    return cells[lastSlot];
+  }
+
+  void release(std::uint64_t owner) {
+    for (int slot = 0; slot < cellCacheSlots; slot++) {
+      if (cells[slot].owner == owner) {
+        flush(slot);
+        cells[slot] = CellCacheBrBz();
+        counters[slot].reset();
+      }
+    }
+  }
+
+  CellCachesBrBz() { cellCachesBrBzAlive = true; }
+
+  ~CellCachesBrBz() {
+    cellCachesBrBzAlive = false;
+    for (int slot = 0; slot < cellCacheSlots; slot++)
+      flush(slot);
+  }
+};
+thread_local CellCachesBrBz cellCachesBrBz;
+
+// Source of FieldMapBrBz::cellCacheId, a map allocated at the address of a deleted one must not reuse its cells
+std::atomic<std::uint64_t> nextCellCacheId(1);
+
+// Lookups between two updates of the shared counters of the map
+const std::uint64_t cacheFlushInterval = 4096;
 } // namespace
 
-FieldMapBrBz::FieldMapBrBz() {
+FieldMapBrBz::FieldMapBrBz()
+    : mappedFieldMap(nullptr), useCellCache(false), cellCacheId(nextCellCacheId++),
+      cacheCounters(std::make_shared<CellCacheCounters>()) {
   field_type = CartesianField::MAGNETIC;
   type = CartesianField::MAGNETIC;
 } // ctor
 
+FieldMapBrBz::~FieldMapBrBz() {
+
+  if (cellCachesBrBzAlive)
+    cellCachesBrBz.release(cellCacheId);
+  const std::uint64_t cacheLookups = cacheCounters->lookups;
+  const std::uint64_t cacheHits = cacheCounters->hits;
+  if (useCellCache && cacheLookups > 0) {
+    std::cout << "FieldMapBrBz: " << cacheHits << " of " << cacheLookups << " lookups in the cached cell ("
+              << 100.0 * cacheHits / cacheLookups << "%), not counting the last " << cacheFlushInterval
+              << " or less lookups of the other threads" << std::endl;
+  }
+} // dtor
+
 int FieldMapBrBz::getGlobalIndex(const int rBin, const int zBin) {
 
   // Global index in fieldmap array from rho and z axes indexes
@@ -68,18 +214,15 @@ void FieldMapBrBz::fieldComponents(const double* pos, double* globalField) {
   // get position coordinates in our system
   const double posRho = sqrt(pos[0] * pos[0] + pos[1] * pos[1]);
   const double posZ = pos[2];
-  const double posPhi = atan2(pos[1], pos[0]);
 
-  // Get the rho, z and phi coordinates of the 3D point
+  // Get the rho and z coordinates of the 3D point
   double r = posRho;
   double z = posZ;
-  double phi = posPhi;
 
-  // Get positive values to do less checks when comparing
-  if (z < 0) {
+  // Get positive values to do less checks when comparing, phi is rotated by pi for z < 0
+  const bool negativeZ = z < 0;
+  if (negativeZ)
     z *= -1;
-    phi += M_PI;
-  }
 
   // APS: Note the mokka field map does not start at 0, so we have to assume that
   // this area is covered, or add some more parameters for the values where the
@@ -111,36 +254,78 @@ void FieldMapBrBz::fieldComponents(const double* pos, double* globalField) {
     zBin -= 1;
   }
 
+  // Field values at the four corners of the bin, from the thread-local cache if the previous lookup was in the same
+  // bin. The cache is keyed by the bins rather than by the cell edges, so the result does not depend on the cache
+  CellCacheBrBz localCell;
+  CellCacheBrBz& cell = useCellCache ? cellCachesBrBz.cell(cellCacheId, cacheCounters) : localCell;
+  if (useCellCache)
+    cell.lookups++;
+
+  if (useCellCache && rBin == cell.rBin && zBin == cell.zBin) {
+    cell.hits++;
+  } else {
+    int rBin0 = rBin;
+    int rBin1 = rBin + 1;
+    int zBin0 = zBin;
+    int zBin1 = zBin + 1;
+    // Protection in case the sampled coordinate is exactly at maximum value of fieldma
+    if (rBin1 > nRho - 1)
+      rBin1 = rBin0;
+    if (zBin1 > nZ - 1)
+      zBin1 = zBin0;
+    const FieldMapBrBz::FieldValues_t* fieldNodes = nodes();
+    const FieldMapBrBz::FieldValues_t& B_r0z0 = fieldNodes[rBin0 + zBin0 * nRho];
+    const FieldMapBrBz::FieldValues_t& B_r1z0 = fieldNodes[rBin1 + zBin0 * nRho];
+    const FieldMapBrBz::FieldValues_t& B_r0z1 = fieldNodes[rBin0 + zBin1 * nRho];
+    const FieldMapBrBz::FieldValues_t& B_r1z1 = fieldNodes[rBin1 + zBin1 * nRho];
+
+    cell.rBin = rBin;
+    cell.zBin = zBin;
+    cell.Br[0] = B_r0z0.Br;
+    cell.Br[1] = B_r1z0.Br;
+    cell.Br[2] = B_r0z1.Br;
+    cell.Br[3] = B_r1z1.Br;
+    cell.Bz[0] = B_r0z0.Bz;
+    cell.Bz[1] = B_r1z0.Bz;
+    cell.Bz[2] = B_r0z1.Bz;
+    cell.Bz[3] = B_r1z1.Bz;
+  }
+
+  if (useCellCache && cell.lookups >= cacheFlushInterval) {
+    cacheCounters->lookups += cell.lookups;
+    cacheCounters->hits += cell.hits;
+    cell.lookups = 0;
+    cell.hits = 0;
+  }
+
   // Get normalized coordinate of (r,z) point in bin
   double rd = (r - r0) / rhoStep;
   double zd = (z - z0) / zStep;
 
-  // Get the field values at the four corners of bin containing the (r,z) point
-  int rBin0 = rBin;
-  int rBin1 = rBin + 1;
-  int zBin0 = zBin;
-  int zBin1 = zBin + 1;
-  // Protection in case the sampled coordinate is exactly at maximum value of fieldma
-  if (rBin1 > nRho - 1)
-    rBin1 = rBin0;
-  if (zBin1 > nZ - 1)
-    zBin1 = zBin0;
-  const FieldMapBrBz::FieldValues_t& B_r0z0 = fieldMap[rBin0 + zBin0 * nRho];
-  const FieldMapBrBz::FieldValues_t& B_r1z0 = fieldMap[rBin1 + zBin0 * nRho];
-  const FieldMapBrBz::FieldValues_t& B_r0z1 = fieldMap[rBin0 + zBin1 * nRho];
-  const FieldMapBrBz::FieldValues_t& B_r1z1 = fieldMap[rBin1 + zBin1 * nRho];
-
   // field at (r,z) point is linear interpolation of fielmap values at bin corners
   double field[2] = {0.0, 0.0};
 
-  field[0] = (1.0 - rd) * (1.0 - zd) * B_r0z0.Br + rd * (1.0 - zd) * B_r1z0.Br + (1.0 - rd) * zd * B_r0z1.Br +
-             rd * zd * B_r1z1.Br;
+  field[0] = (1.0 - rd) * (1.0 - zd) * cell.Br[0] + rd * (1.0 - zd) * cell.Br[1] + (1.0 - rd) * zd * cell.Br[2] +
+             rd * zd * cell.Br[3];
 
-  field[1] = (1.0 - rd) * (1.0 - zd) * B_r0z0.Bz + rd * (1.0 - zd) * B_r1z0.Bz + (1.0 - rd) * zd * B_r0z1.Bz +
-             rd * zd * B_r1z1.Bz;
+  field[1] = (1.0 - rd) * (1.0 - zd) * cell.Bz[0] + rd * (1.0 - zd) * cell.Bz[1] + (1.0 - rd) * zd * cell.Bz[2] +
+             rd * zd * cell.Bz[3];
 
-  globalField[0] += field[0] * sin(phi);
-  globalField[1] += field[0] * cos(phi);
+  // sin(phi) and cos(phi) from y/rho and x/rho, with phi = atan2(y, x) (+ pi for z < 0) and phi = 0 on the z axis
+  double sinPhi = 0.0;
+  double cosPhi = 1.0;
+  if (posRho > 0) {
+    const double invRho = 1.0 / posRho;
+    sinPhi = pos[1] * invRho;
+    cosPhi = pos[0] * invRho;
+  }
+  if (negativeZ) {
+    sinPhi = -sinPhi;
+    cosPhi = -cosPhi;
+  }
+
+  globalField[0] += field[0] * sinPhi;
+  globalField[1] += field[0] * cosPhi;
   globalField[2] += field[1];
 
   /*
@@ -154,8 +339,44 @@ void FieldMapBrBz::fieldComponents(const double* pos, double* globalField) {
   return;
 }
 
+/**
+    Batch version of fieldComponents, uses the SIMD kernels of FieldMapSimd.h when the CPU has
+    AVX2 or AVX-512 and the scalar interpolation for the remaining points
+ */
+void FieldMapBrBz::batchFieldComponents(std::size_t n, const double* x, const double* y, const double* z, double* bx,
+                                        double* by, double* bz) {
+
+  static_assert(sizeof(FieldValues_t) == 2 * sizeof(double), "FieldValues_t must be a plain Br, Bz pair");
+
+  std::size_t i = 0;
+  // The kernels gather with 32-bit indices
+  if (2.0 * nRho * nZ < 2147483647.0) {
+    const FieldMapSimd::GridBrBz grid = {
+        reinterpret_cast<const double*>(nodes()), nRho, nZ, rhoMin, rhoMax, 1.0 / rhoStep, zMin, zMax,
+        1.0 / zStep};
+    i = FieldMapSimd::bilinearBatch(grid, n, x, y, z, bx, by, bz);
+  }
+
+  for (; i < n; i++) {
+    const double pos[3] = {x[i], y[i], z[i]};
+    double field[3] = {bx[i], by[i], bz[i]};
+    FieldMapBrBz::fieldComponents(pos, field);
+    bx[i] = field[0];
+    by[i] = field[1];
+    bz[i] = field[2];
+  }
+}
+
 void FieldMapBrBz::fillFieldMapFromTree(const std::string& filename, double coorUnits, double BfieldUnits) {
 
+  // Everything besides the source file which changes the content of the field map
+  std::stringstream cacheKey;
+  cacheKey << std::hexfloat << ntupleName << ":" << rhoVar << ":" << zVar << ":" << BrhoVar << ":" << BzVar << ":"
+           << coorUnits << ":" << BfieldUnits << ":" << bScale;
+  FieldMapCache::Header cacheHeader = FieldMapCache::makeHeader(FieldMapCache::BrBz, filename, cacheKey.str());
+  if (not cacheFile.empty() && readCache(*this, cacheHeader))
+    return;
+
   TFile* file = TFile::Open(filename.c_str());
   if (not file) {
     std::stringstream error;
@@ -179,6 +400,13 @@ void FieldMapBrBz::fillFieldMapFromTree(const std::string& filename, double coor
     throw std::runtime_error(error.str());
   }
 
+  // Only read the branches in use, through the tree cache
+  tree->SetBranchStatus("*", false);
+  for (const std::string* var : {&rhoVar, &zVar, &BrhoVar, &BzVar})
+    tree->SetBranchStatus(var->c_str(), true);
+  tree->SetCacheSize(treeCacheSize);
+  tree->AddBranchToCache("*", true);
+
   // Set branch adresses
   float r, z, Br, Bz;
   checkBranch(tree->SetBranchAddress(rhoVar.c_str(), &r));
@@ -186,18 +414,22 @@ void FieldMapBrBz::fillFieldMapFromTree(const std::string& filename, double coor
   checkBranch(tree->SetBranchAddress(BrhoVar.c_str(), &Br));
   checkBranch(tree->SetBranchAddress(BzVar.c_str(), &Bz));
 
-  // Loop over the tree entries. In this loop get,
+  // Read the tree entries sequentially, once. In this loop get,
   //  - min, max and step-size values of fieldmap coordinates
   //  - coordinates ordering
+  //  - the field values, in the order of the tree
+  const auto loadStart = std::chrono::steady_clock::now();
   zStep = -1;
   rhoStep = -1;
   rhoOrdering = 1;
   zOrdering = 1;
   strCoorsOrder = std::string("");
   const int treeEntries = tree->GetEntries();
-  fieldMap.reserve(treeEntries);
+  std::vector<float> treeBr(treeEntries), treeBz(treeEntries);
   for (int i = 0; i < treeEntries; i++) {
     tree->GetEntry(i);
+    treeBr[i] = Br;
+    treeBz[i] = Bz;
 
     if (i == 0) {
       rhoMin = r;
@@ -268,17 +500,25 @@ void FieldMapBrBz::fillFieldMapFromTree(const std::string& filename, double coor
     throw std::runtime_error(error.str());
   }
 
-  // Fill the array with the Bfield values in the RZ order
+  // Fill the array with the Bfield values in the RZ order, transposing in memory from the tree order
+  fieldMap.clear();
+  fieldMap.reserve(elements);
   for (int iz = 0; iz < nZ; iz++) {
     for (int ir = 0; ir < nRho; ir++) {
-      tree->GetEntry(getGlobalIndex(ir, iz));
-      fieldMap.push_back(
-          FieldMapBrBz::FieldValues_t(double(Br) * bScale * BfieldUnits, double(Bz) * bScale * BfieldUnits));
+      const int i = getGlobalIndex(ir, iz);
+      fieldMap.push_back(FieldMapBrBz::FieldValues_t(double(treeBr[i]) * bScale * BfieldUnits,
+                                                     double(treeBz[i]) * bScale * BfieldUnits));
     }
   }
 
   file->Close();
   delete file;
+
+  const std::chrono::duration<double> loadTime = std::chrono::steady_clock::now() - loadStart;
+  std::cout << "FieldMapBrBz: read " << treeEntries << " entries in " << loadTime.count() << " s" << std::endl;
+
+  if (not cacheFile.empty())
+    writeCache(*this, cacheHeader);
 }
 
 static Ref_t create_FieldMap_rzBrBz(Detector&, dd4hep::xml::Handle_t handle) {
@@ -305,8 +545,13 @@ static Ref_t create_FieldMap_rzBrBz(Detector&, dd4hep::xml::Handle_t handle) {
   double coorUnits = xmlParameter.attr<double>(_Unicode(coorUnits));
   double BfieldUnits = xmlParameter.attr<double>(_Unicode(BfieldUnits));
 
+  std::string cacheFile = xmlParameter.attr<std::string>(_Unicode(cacheFile), std::string());
+  bool cellCache = xmlParameter.attr<bool>(_Unicode(cellCache), false);
+
   CartesianField obj;
   FieldMapBrBz* ptr = new FieldMapBrBz();
+  ptr->cacheFile = cacheFile;
+  ptr->useCellCache = cellCache;
   ptr->rScale = rScale;
   ptr->zScale = zScale;
   ptr->bScale = bScale;
@@ -342,6 +587,8 @@ static Ref_t create_FieldMap_rzBrBz(Detector&, dd4hep::xml::Handle_t handle) {
   std::cout << "CoorsOrder  " << std::setw(13) << ptr->strCoorsOrder.c_str() << std::endl;
   std::cout << "coorUnits   " << std::setw(13) << coorUnits / dd4hep::cm << " cm" << std::endl;
   std::cout << "BfieldUnits " << std::setw(13) << BfieldUnits / dd4hep::tesla << " tesla" << std::endl;
+  std::cout << "cacheFile   " << std::setw(13) << (cacheFile.empty() ? "none" : cacheFile.c_str()) << std::endl;
+  std::cout << "cellCache   " << std::setw(13) << (ptr->useCellCache ? "true" : "false") << std::endl;
 
   ptr->rhoMin *= rScale;
   ptr->rhoMax *= rScale;
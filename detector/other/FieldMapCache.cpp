@@ -0,0 +1,140 @@
+#include "FieldMapCache.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace FieldMapCache {
+
+static_assert(sizeof(Header) % 64 == 0, "field values must start on a 64 bytes boundary");
+
+namespace {
+
+const char magicString[8] = {'K', '4', 'G', 'E', 'O', 'F', 'M', 'C'};
+
+// FNV-1a over 64-bit words, enough to detect truncated or corrupted files
+std::uint64_t hashWords(const void* data, std::uint64_t nBytes) {
+  std::uint64_t hash = 14695981039346656037ULL;
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  std::uint64_t i = 0;
+  for (; i + 8 <= nBytes; i += 8) {
+    std::uint64_t word;
+    std::memcpy(&word, bytes + i, 8);
+    hash = (hash ^ word) * 1099511628211ULL;
+  }
+  for (; i < nBytes; i++)
+    hash = (hash ^ bytes[i]) * 1099511628211ULL;
+  return hash;
+}
+
+bool sameIdentification(const Header& a, const Header& b) {
+  return std::memcmp(a.magic, b.magic, sizeof(a.magic)) == 0 && a.version == b.version && a.kind == b.kind &&
+         a.sourceSize == b.sourceSize && a.sourceMTime == b.sourceMTime && a.keyHash == b.keyHash;
+}
+
+} // namespace
+
+Header makeHeader(Kind kind, const std::string& sourceFile, const std::string& key) {
+
+  Header header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, magicString, sizeof(header.magic));
+  header.version = version;
+  header.kind = kind;
+  header.keyHash = hashWords(key.data(), key.size());
+
+  struct stat sourceStat;
+  if (::stat(sourceFile.c_str(), &sourceStat) == 0) {
+    header.sourceSize = sourceStat.st_size;
+    // with the nanoseconds, a map regenerated with the same size within a second is told apart
+#ifdef __APPLE__
+    const struct timespec& mTime = sourceStat.st_mtimespec;
+#else
+    const struct timespec& mTime = sourceStat.st_mtim;
+#endif
+    header.sourceMTime = std::int64_t(mTime.tv_sec) * 1000000000 + mTime.tv_nsec;
+  }
+  return header;
+}
+
+const double* load(const std::string& cacheFile, Header& header, std::shared_ptr<const void>& region) {
+
+  if (header.sourceSize == 0)
+    return nullptr;
+
+  const int fd = ::open(cacheFile.c_str(), O_RDONLY);
+  if (fd < 0)
+    return nullptr;
+
+  struct stat cacheStat;
+  if (::fstat(fd, &cacheStat) != 0 || std::uint64_t(cacheStat.st_size) < sizeof(Header)) {
+    ::close(fd);
+    return nullptr;
+  }
+
+  const std::size_t length = cacheStat.st_size;
+  void* address = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (address == MAP_FAILED)
+    return nullptr;
+
+  std::shared_ptr<const void> mapping(address, [length](const void* p) { ::munmap(const_cast<void*>(p), length); });
+
+  const Header* cached = static_cast<const Header*>(address);
+  const double* values = reinterpret_cast<const double*>(static_cast<const char*>(address) + sizeof(Header));
+  if (not sameIdentification(*cached, header)) {
+    std::cout << "FieldMapCache: " << cacheFile << " was built for another field map or source file" << std::endl;
+    return nullptr;
+  }
+  if (length != sizeof(Header) + cached->nValues * sizeof(double) ||
+      hashWords(values, cached->nValues * sizeof(double)) != cached->checksum) {
+    std::cout << "FieldMapCache: " << cacheFile << " is corrupted" << std::endl;
+    return nullptr;
+  }
+
+  header = *cached;
+  region = mapping;
+  std::cout << "FieldMapCache: mapped " << cached->nValues << " field values from " << cacheFile << std::endl;
+  return values;
+}
+
+void store(const std::string& cacheFile, Header header, const double* values, std::uint64_t nValues) {
+
+  if (header.sourceSize == 0) {
+    std::cout << "FieldMapCache: source file cannot be identified, " << cacheFile << " is not written" << std::endl;
+    return;
+  }
+
+  header.nValues = nValues;
+  header.checksum = hashWords(values, nValues * sizeof(double));
+
+  // Write next to the final file and rename, so that readers never see a partial cache
+  std::stringstream tmpName;
+  tmpName << cacheFile << ".tmp." << ::getpid();
+  {
+    std::ofstream out(tmpName.str(), std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+    out.write(reinterpret_cast<const char*>(values), nValues * sizeof(double));
+    if (not out) {
+      std::cout << "FieldMapCache[WARNING]: cannot write " << tmpName.str() << ", field map is not cached" << std::endl;
+      out.close();
+      std::remove(tmpName.str().c_str());
+      return;
+    }
+  }
+  if (std::rename(tmpName.str().c_str(), cacheFile.c_str()) != 0) {
+    std::cout << "FieldMapCache[WARNING]: cannot create " << cacheFile << ", field map is not cached" << std::endl;
+    std::remove(tmpName.str().c_str());
+    return;
+  }
+  std::cout << "FieldMapCache: wrote " << nValues << " field values to " << cacheFile << std::endl;
+}
+
+} // namespace FieldMapCache
@@ -0,0 +1,61 @@
+#ifndef FieldMap_Cache_h
+#define FieldMap_Cache_h 1
+//====================================================================
+//  Binary cache of the field maps read from ROOT trees
+//--------------------------------------------------------------------
+//  The cache file is a fixed-size Header followed by the field values
+//  (doubles, in the order used by the field map for its lookups). It
+//  is written once after reading the tree and memory-mapped read-only
+//  afterwards, so all processes on a node share the same pages.
+//
+//  A cache is only used if magic, version, map kind, source file
+//  (size and modification time in ns), reading key and checksum all match,
+//  otherwise the map is read again from the tree and the cache is
+//  rewritten.
+//====================================================================
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace FieldMapCache {
+
+enum Kind : std::uint32_t { XYZ = 1, BrBz = 2 };
+
+/// Version of the file layout, to be increased for any change of Header or of the stored values
+constexpr std::uint32_t version = 2;
+
+struct Header {
+  char magic[8];             // "K4GEOFMC"
+  std::uint32_t version;     // FieldMapCache::version
+  std::uint32_t kind;        // FieldMapCache::Kind
+  std::uint64_t sourceSize;  // size of the ROOT file the cache was built from
+  std::int64_t sourceMTime;  // modification time in ns of the ROOT file the cache was built from
+  std::uint64_t keyHash;     // hash of tree and branch names, units and scale factors
+  std::int32_t nBins[3];     // number of nodes per coordinate
+  std::int32_t ordering[3];  // 1(-1) for low-to-high (high-to-low) ordering in the tree
+  std::int32_t coorsOrder;   // coordinates ordering in the tree, as in the field maps
+  char strCoorsOrder[12];    // coordinates ordering string, as in the field maps
+  double gridMin[3];         // lower edges of the grid
+  double gridMax[3];         // upper edges of the grid
+  double gridStep[3];        // step-sizes of the grid
+  std::uint64_t nValues;     // number of doubles following the header
+  std::uint64_t checksum;    // hash of the field values
+  char padding[24];          // the values start on a 64 bytes boundary
+};
+
+/// Header with the identification part filled for the given source file and reading key,
+/// sourceSize is 0 if the source cannot be stat'ed (e.g. remote files), in which case no cache is used
+Header makeHeader(Kind kind, const std::string& sourceFile, const std::string& key);
+
+/// Map the cache read-only if it is valid for the identification part of header. On success the grid
+/// part of header is filled and the values are returned, they stay mapped as long as region is alive
+const double* load(const std::string& cacheFile, Header& header, std::shared_ptr<const void>& region);
+
+/// Write header and values to the cache, atomically with respect to concurrent readers and writers.
+/// Failures are reported and otherwise ignored, the field map is usable without its cache
+void store(const std::string& cacheFile, Header header, const double* values, std::uint64_t nValues);
+
+} // namespace FieldMapCache
+
+#endif // FieldMap_Cache_h
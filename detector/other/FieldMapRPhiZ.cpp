@@ -0,0 +1,435 @@
+#include "FieldMapRPhiZ.h"
+
+#include <DD4hep/Version.h>
+#if DD4HEP_VERSION_GE(0, 24)
+#include <DD4hep/detail/Handle.inl>
+#else
+#include <DD4hep/Handle.inl>
+#endif
+
+#include <DD4hep/DetFactoryHelper.h>
+
+#include <TFile.h>
+#include <TTree.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using dd4hep::CartesianField;
+using dd4hep::Detector;
+using dd4hep::Ref_t;
+
+DD4HEP_INSTANTIATE_HANDLE(FieldMapRPhiZ);
+
+namespace {
+// Size of the TTree cache used for the sequential read of the field map
+const long long treeCacheSize = 64 * 1024 * 1024;
+
+void checkBranch(int retCode) {
+
+  if (retCode != 0) {
+    std::stringstream error;
+    error << "FieldMap[ERROR]: Branch not correctly described ";
+    throw std::runtime_error(error.str());
+  }
+}
+} // namespace
+
+FieldMapRPhiZ::FieldMapRPhiZ() {
+  field_type = CartesianField::MAGNETIC;
+  type = CartesianField::MAGNETIC;
+} // ctor
+
+int FieldMapRPhiZ::getGlobalIndex(const int rhoBin, const int phiBin, const int zBin, const int nTreePhi) {
+
+  // Global index in the tree from rho, phi and z axes indexes, the tree has nTreePhi phi nodes
+
+  int myrBin = rhoBin;
+  int mypBin = phiBin;
+  int myzBin = zBin;
+  if (rhoOrdering == -1)
+    myrBin = nRho - myrBin - 1; // recalculate rho-axis index in case of high-to-low ordering
+  if (phiOrdering == -1)
+    mypBin = nTreePhi - mypBin - 1; // recalculate phi-axis index in case of high-to-low ordering
+  if (zOrdering == -1)
+    myzBin = nZ - myzBin - 1; // recalculate z-axis index in case of high-to-low ordering
+
+  int globalIndex = -1;
+  if (coorsOrder == 1)
+    globalIndex = myrBin + mypBin * (nRho) + myzBin * (nRho * nTreePhi); // RPZ coordinates ordering
+  else if (coorsOrder == 2)
+    globalIndex = myrBin + myzBin * (nRho) + mypBin * (nRho * nZ); // RZP coordinates ordering
+  else if (coorsOrder == 3)
+    globalIndex = mypBin + myrBin * (nTreePhi) + myzBin * (nTreePhi * nRho); // PRZ coordinates ordering
+  else if (coorsOrder == 4)
+    globalIndex = mypBin + myzBin * (nTreePhi) + myrBin * (nTreePhi * nZ); // PZR coordinates ordering
+  else if (coorsOrder == 5)
+    globalIndex = myzBin + myrBin * (nZ) + mypBin * (nZ * nRho); // ZRP coordinates ordering
+  else if (coorsOrder == 6)
+    globalIndex = myzBin + mypBin * (nZ) + myrBin * (nZ * nTreePhi); // ZPR coordinates ordering
+
+  return globalIndex;
+}
+
+void FieldMapRPhiZ::buildTables() {
+
+  rhoInvStep = 1.0 / rhoStep;
+  phiInvStep = 1.0 / phiStep;
+  zInvStep = 1.0 / zStep;
+  cosPhi.resize(nPhi + 1);
+  sinPhi.resize(nPhi + 1);
+  for (int i = 0; i < nPhi; i++) {
+    cosPhi[i] = std::cos(phiMin + i * phiStep);
+    sinPhi[i] = std::sin(phiMin + i * phiStep);
+  }
+  cosPhi[nPhi] = cosPhi[0];
+  sinPhi[nPhi] = sinPhi[0];
+}
+
+int FieldMapRPhiZ::findPhiBin(double x, double y, double& c0, double& c1) const {
+
+  const double u = (std::atan2(y, x) - phiMin) * phiInvStep;
+  int phiBin = int(std::floor(u)) % nPhi;
+  if (phiBin < 0)
+    phiBin += nPhi;
+  // atan2 and the node directions can disagree by rounding at the bin edges
+  for (const int shift : {0, 1, nPhi - 1}) {
+    const int bin = (phiBin + shift) % nPhi;
+    if (inPhiBin(bin, x, y, c0, c1))
+      return bin;
+  }
+  return phiBin;
+}
+
+void FieldMapRPhiZ::fieldComponents(const double* pos, double* globalField) {
+
+  // get position coordinates in our system
+  const double x = pos[0];
+  const double y = pos[1];
+  const double z = pos[2];
+  const double rho2 = x * x + y * y;
+
+  // Do nothing if rho and z point are outside fieldmap limits
+  if (not(z >= zMin && z <= zMax && rho2 >= rhoMin * rhoMin && rho2 <= rhoMax * rhoMax))
+    return;
+
+  const double rho = std::sqrt(rho2);
+
+  // Azimuthal bin and weight, first trying the bin of the previous lookup of this thread (which
+  // may come from another map, hence the check against nPhi). On the z axis phi = 0 is used
+  thread_local int lastPhiBin = 0;
+  int phiBin = 0;
+  double pd = 0.0;
+  double cosP = 1.0;
+  double sinP = 0.0;
+  if (rho > 0) {
+    double c0, c1;
+    phiBin = lastPhiBin;
+    if (not(phiBin < nPhi && inPhiBin(phiBin, x, y, c0, c1))) {
+      phiBin = findPhiBin(x, y, c0, c1);
+      lastPhiBin = phiBin;
+    }
+    pd = c0 / (c0 + c1);
+    cosP = x / rho;
+    sinP = y / rho;
+  }
+  const int phiBin1 = phiBin + 1 < nPhi ? phiBin + 1 : 0;
+
+  // Calculate the bins on the rho and z axis containing the point, protected against the maximum values
+  const double ru = (rho - rhoMin) * rhoInvStep;
+  const double zu = (z - zMin) * zInvStep;
+  const int rBin = std::min(int(ru), nRho - 2);
+  const int zBin = std::min(int(zu), nZ - 2);
+  const double rd = ru - rBin;
+  const double zd = zu - zBin;
+
+  const FieldValues_t* fieldNodes = fieldMap.data();
+  const int nRP = nRho * nPhi;
+  const FieldValues_t& B_r0p0z0 = fieldNodes[rBin + phiBin * nRho + zBin * nRP];
+  const FieldValues_t& B_r1p0z0 = fieldNodes[rBin + 1 + phiBin * nRho + zBin * nRP];
+  const FieldValues_t& B_r0p1z0 = fieldNodes[rBin + phiBin1 * nRho + zBin * nRP];
+  const FieldValues_t& B_r1p1z0 = fieldNodes[rBin + 1 + phiBin1 * nRho + zBin * nRP];
+  const FieldValues_t& B_r0p0z1 = fieldNodes[rBin + phiBin * nRho + (zBin + 1) * nRP];
+  const FieldValues_t& B_r1p0z1 = fieldNodes[rBin + 1 + phiBin * nRho + (zBin + 1) * nRP];
+  const FieldValues_t& B_r0p1z1 = fieldNodes[rBin + phiBin1 * nRho + (zBin + 1) * nRP];
+  const FieldValues_t& B_r1p1z1 = fieldNodes[rBin + 1 + phiBin1 * nRho + (zBin + 1) * nRP];
+
+  // field at (rho,phi,z) point is linear interpolation of fielmap values at bin corners
+  const double w000 = (1.0 - rd) * (1.0 - pd) * (1.0 - zd);
+  const double w100 = rd * (1.0 - pd) * (1.0 - zd);
+  const double w010 = (1.0 - rd) * pd * (1.0 - zd);
+  const double w110 = rd * pd * (1.0 - zd);
+  const double w001 = (1.0 - rd) * (1.0 - pd) * zd;
+  const double w101 = rd * (1.0 - pd) * zd;
+  const double w011 = (1.0 - rd) * pd * zd;
+  const double w111 = rd * pd * zd;
+
+  const double Brho = w000 * B_r0p0z0.Brho + w100 * B_r1p0z0.Brho + w010 * B_r0p1z0.Brho + w110 * B_r1p1z0.Brho +
+                      w001 * B_r0p0z1.Brho + w101 * B_r1p0z1.Brho + w011 * B_r0p1z1.Brho + w111 * B_r1p1z1.Brho;
+  const double Bphi = w000 * B_r0p0z0.Bphi + w100 * B_r1p0z0.Bphi + w010 * B_r0p1z0.Bphi + w110 * B_r1p1z0.Bphi +
+                      w001 * B_r0p0z1.Bphi + w101 * B_r1p0z1.Bphi + w011 * B_r0p1z1.Bphi + w111 * B_r1p1z1.Bphi;
+  const double Bz = w000 * B_r0p0z0.Bz + w100 * B_r1p0z0.Bz + w010 * B_r0p1z0.Bz + w110 * B_r1p1z0.Bz +
+                    w001 * B_r0p0z1.Bz + w101 * B_r1p0z1.Bz + w011 * B_r0p1z1.Bz + w111 * B_r1p1z1.Bz;
+
+  globalField[0] += Brho * cosP - Bphi * sinP;
+  globalField[1] += Brho * sinP + Bphi * cosP;
+  globalField[2] += Bz;
+}
+
+void FieldMapRPhiZ::fillFieldMapFromTree(const std::string& filename, double coorUnits, double phiUnits,
+                                         double BfieldUnits) {
+
+  TFile* file = TFile::Open(filename.c_str());
+  if (not file) {
+    std::stringstream error;
+    error << "FieldMapRPhiZ[ERROR]: File not found: " << filename;
+    throw std::runtime_error(error.str());
+  }
+
+  std::cout << std::endl;
+  std::cout << "Ntuple name:   " << ntupleName << std::endl;
+  std::cout << "rho  Var name: " << rhoVar << std::endl;
+  std::cout << "phi  Var name: " << phiVar << std::endl;
+  std::cout << "z    Var name: " << zVar << std::endl;
+  std::cout << "Brho Var name: " << BrhoVar << std::endl;
+  std::cout << "Bphi Var name: " << BphiVar << std::endl;
+  std::cout << "Bz   Var name: " << BzVar << std::endl;
+  std::cout << std::endl;
+
+  TTree* tree;
+  file->GetObject(ntupleName.c_str(), tree);
+  if (not tree) {
+    std::stringstream error;
+    error << "FieldMapRPhiZ[ERROR]: Tree " << ntupleName << " not found in file: " << filename;
+    throw std::runtime_error(error.str());
+  }
+
+  // Only read the branches in use, through the tree cache
+  tree->SetBranchStatus("*", false);
+  for (const std::string* var : {&rhoVar, &phiVar, &zVar, &BrhoVar, &BphiVar, &BzVar})
+    tree->SetBranchStatus(var->c_str(), true);
+  tree->SetCacheSize(treeCacheSize);
+  tree->AddBranchToCache("*", true);
+
+  // Set branch adresses
+  float rho, phi, z, Brho, Bphi, Bz;
+  checkBranch(tree->SetBranchAddress(rhoVar.c_str(), &rho));
+  checkBranch(tree->SetBranchAddress(phiVar.c_str(), &phi));
+  checkBranch(tree->SetBranchAddress(zVar.c_str(), &z));
+  checkBranch(tree->SetBranchAddress(BrhoVar.c_str(), &Brho));
+  checkBranch(tree->SetBranchAddress(BphiVar.c_str(), &Bphi));
+  checkBranch(tree->SetBranchAddress(BzVar.c_str(), &Bz));
+
+  // Read the tree entries sequentially, once. In this loop get,
+  //  - min, max and step-size values of fieldmap coordinates
+  //  - coordinates ordering
+  //  - the field values, in the order of the tree
+  const auto loadStart = std::chrono::steady_clock::now();
+  double phiMax = 0;
+  rhoStep = -1;
+  phiStep = -1;
+  zStep = -1;
+  rhoOrdering = 1;
+  phiOrdering = 1;
+  zOrdering = 1;
+  strCoorsOrder = std::string("");
+  const int treeEntries = tree->GetEntries();
+  std::vector<float> treeBrho(treeEntries), treeBphi(treeEntries), treeBz(treeEntries);
+  for (int i = 0; i < treeEntries; i++) {
+    tree->GetEntry(i);
+    treeBrho[i] = Brho;
+    treeBphi[i] = Bphi;
+    treeBz[i] = Bz;
+
+    if (i == 0) {
+      rhoMin = rho;
+      phiMin = phi;
+      zMin = z;
+    }
+    if (i == treeEntries - 1) {
+      rhoMax = rho;
+      phiMax = phi;
+      zMax = z;
+    }
+
+    if (rho != rhoMin && rhoStep < 0.0) {
+      rhoStep = TMath::Abs(rhoMin - rho);
+      strCoorsOrder += std::string("R");
+    }
+    if (phi != phiMin && phiStep < 0.0) {
+      phiStep = TMath::Abs(phiMin - phi);
+      strCoorsOrder += std::string("P");
+    }
+    if (z != zMin && zStep < 0.0) {
+      zStep = TMath::Abs(zMin - z);
+      strCoorsOrder += std::string("Z");
+    }
+  }
+
+  if (strCoorsOrder == TString("RPZ"))
+    coorsOrder = 1;
+  else if (strCoorsOrder == TString("RZP"))
+    coorsOrder = 2;
+  else if (strCoorsOrder == TString("PRZ"))
+    coorsOrder = 3;
+  else if (strCoorsOrder == TString("PZR"))
+    coorsOrder = 4;
+  else if (strCoorsOrder == TString("ZRP"))
+    coorsOrder = 5;
+  else if (strCoorsOrder == TString("ZPR"))
+    coorsOrder = 6;
+
+  const double steps[3] = {rhoStep, phiStep, zStep};
+  const char* names[3] = {"rho", "phi", "z"};
+  for (int k = 0; k < 3; k++) {
+    if (steps[k] < 0) {
+      std::stringstream error;
+      error << "FieldMapRPhiZ[ERROR]: All " << names[k] << " coordinates in n-tuple have the same value!!!";
+      throw std::runtime_error(error.str());
+    }
+  }
+  if (rhoMax < rhoMin) {
+    // rho variable is scanned from high-to-low
+    rhoOrdering = -1;
+    std::swap(rhoMin, rhoMax);
+  }
+  if (phiMax < phiMin) {
+    // phi variable is scanned from high-to-low
+    phiOrdering = -1;
+    std::swap(phiMin, phiMax);
+  }
+  if (zMax < zMin) {
+    // z variable is scanned from high-to-low
+    zOrdering = -1;
+    std::swap(zMin, zMax);
+  }
+
+  // Calculate number of bins in fieldmap
+  nRho = round(((rhoMax - rhoMin) / rhoStep) + 1);
+  const int nTreePhi = round(((phiMax - phiMin) / phiStep) + 1);
+  nZ = round(((zMax - zMin) / zStep) + 1);
+
+  // Set coordinates parameters units
+  rhoMin *= coorUnits;
+  rhoMax *= coorUnits;
+  rhoStep *= coorUnits;
+  phiMin *= phiUnits;
+  phiStep *= phiUnits;
+  zMin *= coorUnits;
+  zMax *= coorUnits;
+  zStep *= coorUnits;
+
+  const int elements = nRho * nTreePhi * nZ;
+  if (elements != treeEntries) {
+    std::stringstream error;
+    error << "FieldMapRPhiZ[ERROR]: Tree does not have the expected number of entries "
+          << "nRho*nPhi*nZ (" << nRho << "*" << nTreePhi << "*" << nZ << ") == " << elements
+          << "  tree entries == " << treeEntries;
+    throw std::runtime_error(error.str());
+  }
+
+  // The phi nodes cover a full turn, possibly with the last node repeating the first one
+  const double tolerance = 1e-3 * phiStep;
+  if (std::fabs(nTreePhi * phiStep - 2 * M_PI) < tolerance) {
+    nPhi = nTreePhi;
+  } else if (std::fabs((nTreePhi - 1) * phiStep - 2 * M_PI) < tolerance) {
+    nPhi = nTreePhi - 1;
+  } else {
+    std::stringstream error;
+    error << "FieldMapRPhiZ[ERROR]: The " << nTreePhi << " phi nodes with step " << phiStep / dd4hep::deg
+          << " deg do not cover a full turn, check phiUnits";
+    throw std::runtime_error(error.str());
+  }
+  if (nRho < 2 || nPhi < 3 || nZ < 2) {
+    std::stringstream error;
+    error << "FieldMapRPhiZ[ERROR]: At least 2 rho, 3 phi and 2 z nodes are needed, got " << nRho << ", " << nPhi
+          << " and " << nZ;
+    throw std::runtime_error(error.str());
+  }
+  phiStep = 2 * M_PI / nPhi;
+
+  // Fill the array with the Bfield values in the RPhiZ order, transposing in memory from the tree order
+  fieldMap.clear();
+  fieldMap.reserve(nRho * nPhi * nZ);
+  for (int iz = 0; iz < nZ; iz++) {
+    for (int ip = 0; ip < nPhi; ip++) {
+      for (int ir = 0; ir < nRho; ir++) {
+        const int i = getGlobalIndex(ir, ip, iz, nTreePhi);
+        fieldMap.push_back(FieldValues_t(double(treeBrho[i]) * bScale * BfieldUnits,
+                                         double(treeBphi[i]) * bScale * BfieldUnits,
+                                         double(treeBz[i]) * bScale * BfieldUnits));
+      }
+    }
+  }
+
+  file->Close();
+  delete file;
+
+  const std::chrono::duration<double> loadTime = std::chrono::steady_clock::now() - loadStart;
+  std::cout << "FieldMapRPhiZ: read " << treeEntries << " entries in " << loadTime.count() << " s" << std::endl;
+}
+
+static Ref_t create_FieldMap_RPhiZ(Detector&, dd4hep::xml::Handle_t handle) {
+  dd4hep::xml::Component xmlParameter(handle);
+  bool hasFilename = xmlParameter.hasAttr(_Unicode(filename));
+
+  if (!hasFilename) {
+    std::stringstream error;
+    error << "FieldMapRPhiZ[ERROR]: For a FieldMap field at least the filename xml attribute MUST be set.";
+    throw std::runtime_error(error.str());
+  }
+
+  std::string filename = xmlParameter.attr<std::string>(_Unicode(filename));
+  std::string ntupleName = xmlParameter.attr<std::string>(_Unicode(treeName));
+  std::string rhoVar = xmlParameter.attr<std::string>(_Unicode(rhoVarName));
+  std::string phiVar = xmlParameter.attr<std::string>(_Unicode(phiVarName));
+  std::string zVar = xmlParameter.attr<std::string>(_Unicode(zVarName));
+  std::string BrhoVar = xmlParameter.attr<std::string>(_Unicode(BrhoVarName));
+  std::string BphiVar = xmlParameter.attr<std::string>(_Unicode(BphiVarName));
+  std::string BzVar = xmlParameter.attr<std::string>(_Unicode(BzVarName));
+
+  double bScale = xmlParameter.attr<double>(_Unicode(bScale));
+
+  double coorUnits = xmlParameter.attr<double>(_Unicode(coorUnits));
+  double phiUnits = xmlParameter.attr<double>(_Unicode(phiUnits), dd4hep::rad);
+  double BfieldUnits = xmlParameter.attr<double>(_Unicode(BfieldUnits));
+
+  CartesianField obj;
+  FieldMapRPhiZ* ptr = new FieldMapRPhiZ();
+  ptr->bScale = bScale;
+  ptr->ntupleName = ntupleName;
+  ptr->rhoVar = rhoVar;
+  ptr->phiVar = phiVar;
+  ptr->zVar = zVar;
+  ptr->BrhoVar = BrhoVar;
+  ptr->BphiVar = BphiVar;
+  ptr->BzVar = BzVar;
+
+  // Read the entries form the file in this place
+  ptr->fillFieldMapFromTree(filename, coorUnits, phiUnits, BfieldUnits);
+  ptr->buildTables();
+
+  std::cout << "bScale      " << std::setw(13) << ptr->bScale << std::endl;
+  std::cout << "rhoMin      " << std::setw(13) << ptr->rhoMin / dd4hep::cm << " cm" << std::endl;
+  std::cout << "rhoMax      " << std::setw(13) << ptr->rhoMax / dd4hep::cm << " cm" << std::endl;
+  std::cout << "rhoStep     " << std::setw(13) << ptr->rhoStep / dd4hep::cm << " cm" << std::endl;
+  std::cout << "nRho        " << std::setw(13) << ptr->nRho << std::endl;
+  std::cout << "phiMin      " << std::setw(13) << ptr->phiMin / dd4hep::deg << " deg" << std::endl;
+  std::cout << "phiStep     " << std::setw(13) << ptr->phiStep / dd4hep::deg << " deg" << std::endl;
+  std::cout << "nPhi        " << std::setw(13) << ptr->nPhi << std::endl;
+  std::cout << "zMin        " << std::setw(13) << ptr->zMin / dd4hep::cm << " cm" << std::endl;
+  std::cout << "zMax        " << std::setw(13) << ptr->zMax / dd4hep::cm << " cm" << std::endl;
+  std::cout << "zStep       " << std::setw(13) << ptr->zStep / dd4hep::cm << " cm" << std::endl;
+  std::cout << "nZ          " << std::setw(13) << ptr->nZ << std::endl;
+  std::cout << "coorsOrder  " << std::setw(13) << ptr->strCoorsOrder << std::endl;
+
+  obj.assign(ptr, xmlParameter.nameStr(), xmlParameter.typeStr());
+
+  return obj;
+}
+DECLARE_XMLELEMENT(FieldRPhiZ, create_FieldMap_RPhiZ)
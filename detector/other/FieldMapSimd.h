@@ -0,0 +1,206 @@
+#ifndef FieldMap_Simd_h
+#define FieldMap_Simd_h 1
+//====================================================================
+//  SIMD kernels for the batch interpolation of FieldMapXYZ and FieldMapBrBz
+//--------------------------------------------------------------------
+//  The kernels of FieldMapSimdKernels.h are compiled for AVX-512 and
+//  AVX2 with target pragmas, whatever the -march of the build, and the
+//  instruction set is chosen at run time: AVX-512 if the CPU has it,
+//  otherwise AVX2. Without them, or on other architectures and
+//  compilers, the batch functions do no point and the callers use
+//  their scalar interpolation. FIELDMAP_SIMD=avx2 or FIELDMAP_SIMD=scalar
+//  in the environment restricts the choice, e.g. to test the AVX2
+//  kernels on an AVX-512 machine.
+//
+//  The kernels use reciprocal step-sizes and x/rho, y/rho for the
+//  azimuthal rotation, results agree with the scalar fieldComponents
+//  within a few ulp of the field magnitude (1e-12 relative is used in
+//  test/src/FieldMapBenchmark.cpp).
+//====================================================================
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define FIELDMAP_SIMD_X86 1
+#include <immintrin.h>
+#else
+#define FIELDMAP_SIMD_X86 0
+#endif
+
+namespace FieldMapSimd {
+
+/// Regular 3D grid with Bx, By, Bz triplets stored in XYZ order
+struct GridXYZ {
+  const double* nodes;
+  int nX, nY, nZ;
+  double xMin, xMax, xInvStep;
+  double yMin, yMax, yInvStep;
+  double zMin, zMax, zInvStep;
+};
+
+/// Regular (rho, z) grid with Br, Bz pairs stored in RZ order
+struct GridBrBz {
+  const double* nodes;
+  int nRho, nZ;
+  double rhoMin, rhoMax, rhoInvStep;
+  double zMin, zMax, zInvStep;
+};
+
+#if FIELDMAP_SIMD_X86
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx512f"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+#endif
+namespace avx512 {
+struct Lanes {
+  static constexpr int width = 8;
+  typedef __m512d V;
+  typedef __mmask8 M;
+  typedef __m256i I;
+  static V load(const double* p) { return _mm512_loadu_pd(p); }
+  static void store(double* p, V a) { _mm512_storeu_pd(p, a); }
+  static V set1(double a) { return _mm512_set1_pd(a); }
+  static V add(V a, V b) { return _mm512_add_pd(a, b); }
+  static V sub(V a, V b) { return _mm512_sub_pd(a, b); }
+  static V mul(V a, V b) { return _mm512_mul_pd(a, b); }
+  static V div(V a, V b) { return _mm512_div_pd(a, b); }
+  static V min(V a, V b) { return _mm512_min_pd(a, b); }
+  static V max(V a, V b) { return _mm512_max_pd(a, b); }
+  static V sqrt(V a) { return _mm512_sqrt_pd(a); }
+  static V floor(V a) { return _mm512_roundscale_pd(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+  static M ge(V a, V b) { return _mm512_cmp_pd_mask(a, b, _CMP_GE_OQ); }
+  static M le(V a, V b) { return _mm512_cmp_pd_mask(a, b, _CMP_LE_OQ); }
+  static M lt(V a, V b) { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+  static M eq(V a, V b) { return _mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ); }
+  static M both(M a, M b) { return a & b; }
+  static V select(M m, V a, V b) { return _mm512_mask_blend_pd(m, b, a); } // m ? a : b
+  static I index(V a) { return _mm512_cvttpd_epi32(a); }
+  static I offset(I a, int b) { return _mm256_add_epi32(a, _mm256_set1_epi32(b)); }
+  static V gather(const double* base, I idx) { return _mm512_i32gather_pd(idx, base, 8); }
+};
+
+#include "FieldMapSimdKernels.h"
+} // namespace avx512
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+namespace avx2 {
+struct Lanes {
+  static constexpr int width = 4;
+  typedef __m256d V;
+  typedef __m256d M;
+  typedef __m128i I;
+  static V load(const double* p) { return _mm256_loadu_pd(p); }
+  static void store(double* p, V a) { _mm256_storeu_pd(p, a); }
+  static V set1(double a) { return _mm256_set1_pd(a); }
+  static V add(V a, V b) { return _mm256_add_pd(a, b); }
+  static V sub(V a, V b) { return _mm256_sub_pd(a, b); }
+  static V mul(V a, V b) { return _mm256_mul_pd(a, b); }
+  static V div(V a, V b) { return _mm256_div_pd(a, b); }
+  static V min(V a, V b) { return _mm256_min_pd(a, b); }
+  static V max(V a, V b) { return _mm256_max_pd(a, b); }
+  static V sqrt(V a) { return _mm256_sqrt_pd(a); }
+  static V floor(V a) { return _mm256_floor_pd(a); }
+  static M ge(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_GE_OQ); }
+  static M le(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_LE_OQ); }
+  static M lt(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+  static M eq(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+  static M both(M a, M b) { return _mm256_and_pd(a, b); }
+  static V select(M m, V a, V b) { return _mm256_blendv_pd(b, a, m); } // m ? a : b
+  static I index(V a) { return _mm256_cvttpd_epi32(a); }
+  static I offset(I a, int b) { return _mm_add_epi32(a, _mm_set1_epi32(b)); }
+  static V gather(const double* base, I idx) { return _mm256_i32gather_pd(base, idx, 8); }
+};
+
+#include "FieldMapSimdKernels.h"
+} // namespace avx2
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#endif
+
+enum class Isa { Scalar, AVX2, AVX512 };
+
+/// Instruction set of the kernels: the best one of the CPU, unless restricted by FIELDMAP_SIMD
+inline Isa isa() {
+  static const Isa chosen = [] {
+    Isa cpu = Isa::Scalar;
+#if FIELDMAP_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+      cpu = Isa::AVX512;
+    else if (__builtin_cpu_supports("avx2"))
+      cpu = Isa::AVX2;
+#endif
+    const char* restriction = std::getenv("FIELDMAP_SIMD");
+    if (restriction != nullptr && std::strcmp(restriction, "scalar") == 0)
+      return Isa::Scalar;
+    if (restriction != nullptr && std::strcmp(restriction, "avx2") == 0 && cpu == Isa::AVX512)
+      return Isa::AVX2;
+    return cpu;
+  }();
+  return chosen;
+}
+
+inline const char* isaName() {
+  switch (isa()) {
+  case Isa::AVX512:
+    return "AVX-512";
+  case Isa::AVX2:
+    return "AVX2";
+  default:
+    return "scalar";
+  }
+}
+
+/// Trilinear interpolation of the first points of a batch, the field is added to bx, by, bz. Returns the number of
+/// points done, a multiple of the SIMD width, 0 without SIMD kernels
+inline std::size_t trilinearBatch(const GridXYZ& g, std::size_t n, const double* x, const double* y, const double* z,
+                                  double* bx, double* by, double* bz) {
+  switch (isa()) {
+#if FIELDMAP_SIMD_X86
+  case Isa::AVX512:
+    return avx512::trilinearBatch(g, n, x, y, z, bx, by, bz);
+  case Isa::AVX2:
+    return avx2::trilinearBatch(g, n, x, y, z, bx, by, bz);
+#endif
+  default:
+    return 0;
+  }
+}
+
+/// Bilinear (rho, z) interpolation of the first points of a batch, as trilinearBatch
+inline std::size_t bilinearBatch(const GridBrBz& g, std::size_t n, const double* x, const double* y, const double* z,
+                                 double* bx, double* by, double* bz) {
+  switch (isa()) {
+#if FIELDMAP_SIMD_X86
+  case Isa::AVX512:
+    return avx512::bilinearBatch(g, n, x, y, z, bx, by, bz);
+  case Isa::AVX2:
+    return avx2::bilinearBatch(g, n, x, y, z, bx, by, bz);
+#endif
+  default:
+    return 0;
+  }
+}
+
+} // namespace FieldMapSimd
+
+#endif // FieldMap_Simd_h
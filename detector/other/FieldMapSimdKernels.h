@@ -0,0 +1,134 @@
+//====================================================================
+//  SIMD kernels of FieldMapSimd.h for one instruction set
+//--------------------------------------------------------------------
+//  No include guard: included once per instruction set by
+//  FieldMapSimd.h, inside the namespace and the target region of the
+//  instruction set, which define Lanes.
+//====================================================================
+
+/// Bin and normalized coordinate inside the bin, lanes outside the map are moved to bin 0
+inline void binAndFraction(Lanes::M inside, Lanes::V u, int n, Lanes::V& bin, Lanes::V& frac) {
+  typedef Lanes L;
+  u = L::select(inside, u, L::set1(0.0));
+  bin = L::min(L::floor(u), L::set1(n - 2));
+  frac = L::sub(u, bin);
+}
+
+/// Trilinear interpolation at Lanes::width points, the field is added to bx, by, bz
+inline void trilinear(const GridXYZ& g, const double* x, const double* y, const double* z, double* bx, double* by,
+                      double* bz) {
+  typedef Lanes L;
+  const L::V vx = L::load(x);
+  const L::V vy = L::load(y);
+  const L::V vz = L::load(z);
+
+  const L::M inside =
+      L::both(L::both(L::both(L::ge(vx, L::set1(g.xMin)), L::le(vx, L::set1(g.xMax))),
+                      L::both(L::ge(vy, L::set1(g.yMin)), L::le(vy, L::set1(g.yMax)))),
+              L::both(L::ge(vz, L::set1(g.zMin)), L::le(vz, L::set1(g.zMax))));
+
+  L::V xBin, yBin, zBin, xd, yd, zd;
+  binAndFraction(inside, L::mul(L::sub(vx, L::set1(g.xMin)), L::set1(g.xInvStep)), g.nX, xBin, xd);
+  binAndFraction(inside, L::mul(L::sub(vy, L::set1(g.yMin)), L::set1(g.yInvStep)), g.nY, yBin, yd);
+  binAndFraction(inside, L::mul(L::sub(vz, L::set1(g.zMin)), L::set1(g.zInvStep)), g.nZ, zBin, zd);
+
+  // Index of the first double of the (xBin, yBin, zBin) node, and offsets to the other corners
+  const double nXY = double(g.nX) * g.nY;
+  const L::I i000 = L::index(L::mul(L::add(L::add(xBin, L::mul(yBin, L::set1(g.nX))), L::mul(zBin, L::set1(nXY))),
+                                    L::set1(3.0)));
+  const int dx = 3;
+  const int dy = 3 * g.nX;
+  const int dz = 3 * g.nX * g.nY;
+
+  const L::V one = L::set1(1.0);
+  const L::V wx[2] = {L::sub(one, xd), xd};
+  const L::V wy[2] = {L::sub(one, yd), yd};
+  const L::V wz[2] = {L::sub(one, zd), zd};
+
+  L::V B[3] = {L::set1(0.0), L::set1(0.0), L::set1(0.0)};
+  for (int c = 0; c < 8; c++) {
+    const int cx = c & 1;
+    const int cy = (c >> 1) & 1;
+    const int cz = c >> 2;
+    const L::I idx = L::offset(i000, cx * dx + cy * dy + cz * dz);
+    const L::V w = L::mul(L::mul(wx[cx], wy[cy]), wz[cz]);
+    for (int k = 0; k < 3; k++)
+      B[k] = L::add(B[k], L::mul(w, L::gather(g.nodes + k, idx)));
+  }
+
+  double* out[3] = {bx, by, bz};
+  for (int k = 0; k < 3; k++)
+    L::store(out[k], L::add(L::load(out[k]), L::select(inside, B[k], L::set1(0.0))));
+}
+
+/// Bilinear (rho, z) interpolation at Lanes::width points, the field is added to bx, by, bz.
+/// Same conventions as FieldMapBrBz::fieldComponents: mirrored in z, clamped to rhoMin and zMin
+inline void bilinear(const GridBrBz& g, const double* x, const double* y, const double* z, double* bx, double* by,
+                     double* bz) {
+  typedef Lanes L;
+  const L::V zero = L::set1(0.0);
+  const L::V vx = L::load(x);
+  const L::V vy = L::load(y);
+  const L::V vz = L::load(z);
+
+  const L::V rho = L::sqrt(L::add(L::mul(vx, vx), L::mul(vy, vy)));
+  const L::M negZ = L::lt(vz, zero);
+  const L::V r = L::max(rho, L::set1(g.rhoMin));
+  const L::V za = L::max(L::select(negZ, L::sub(zero, vz), vz), L::set1(g.zMin));
+
+  const L::M inside = L::both(L::le(r, L::set1(g.rhoMax)), L::le(za, L::set1(g.zMax)));
+
+  L::V rBin, zBin, rd, zd;
+  binAndFraction(inside, L::mul(L::sub(r, L::set1(g.rhoMin)), L::set1(g.rhoInvStep)), g.nRho, rBin, rd);
+  binAndFraction(inside, L::mul(L::sub(za, L::set1(g.zMin)), L::set1(g.zInvStep)), g.nZ, zBin, zd);
+
+  const L::I i00 = L::index(L::mul(L::add(rBin, L::mul(zBin, L::set1(g.nRho))), L::set1(2.0)));
+  const int dr = 2;
+  const int dz = 2 * g.nRho;
+
+  const L::V one = L::set1(1.0);
+  const L::V wr[2] = {L::sub(one, rd), rd};
+  const L::V wz[2] = {L::sub(one, zd), zd};
+
+  L::V Br = zero;
+  L::V Bz = zero;
+  for (int c = 0; c < 4; c++) {
+    const int cr = c & 1;
+    const int cz = c >> 1;
+    const L::I idx = L::offset(i00, cr * dr + cz * dz);
+    const L::V w = L::mul(wr[cr], wz[cz]);
+    Br = L::add(Br, L::mul(w, L::gather(g.nodes, idx)));
+    Bz = L::add(Bz, L::mul(w, L::gather(g.nodes + 1, idx)));
+  }
+
+  // sin(phi) = y/rho and cos(phi) = x/rho, phi = 0 on the z axis, and rotated by pi for z < 0
+  const L::M onAxis = L::eq(rho, zero);
+  const L::V invRho = L::div(one, L::select(onAxis, one, rho));
+  L::V sinPhi = L::select(onAxis, zero, L::mul(vy, invRho));
+  L::V cosPhi = L::select(onAxis, one, L::mul(vx, invRho));
+  sinPhi = L::select(negZ, L::sub(zero, sinPhi), sinPhi);
+  cosPhi = L::select(negZ, L::sub(zero, cosPhi), cosPhi);
+
+  Br = L::select(inside, Br, zero);
+  Bz = L::select(inside, Bz, zero);
+  L::store(bx, L::add(L::load(bx), L::mul(Br, sinPhi)));
+  L::store(by, L::add(L::load(by), L::mul(Br, cosPhi)));
+  L::store(bz, L::add(L::load(bz), Bz));
+}
+
+/// Kernels on the first points of a batch, by blocks of Lanes::width points, returns the number of points done
+inline std::size_t trilinearBatch(const GridXYZ& g, std::size_t n, const double* x, const double* y, const double* z,
+                                  double* bx, double* by, double* bz) {
+  std::size_t i = 0;
+  for (; i + Lanes::width <= n; i += Lanes::width)
+    trilinear(g, x + i, y + i, z + i, bx + i, by + i, bz + i);
+  return i;
+}
+
+inline std::size_t bilinearBatch(const GridBrBz& g, std::size_t n, const double* x, const double* y, const double* z,
+                                 double* bx, double* by, double* bz) {
+  std::size_t i = 0;
+  for (; i + Lanes::width <= n; i += Lanes::width)
+    bilinear(g, x + i, y + i, z + i, bx + i, by + i, bz + i);
+  return i;
+}
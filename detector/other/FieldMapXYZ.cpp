@@ -1,4 +1,6 @@
 #include "FieldMapXYZ.h"
+#include "FieldMapCache.h"
+#include "FieldMapSimd.h"
 
 #include <DD4hep/Version.h>
 #if DD4HEP_VERSION_GE(0, 24)
@@ -12,8 +14,14 @@
 #include <TFile.h>
 #include <TTree.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 #include <stdexcept>
 #include <string>
 
@@ -24,6 +32,9 @@ using dd4hep::Ref_t;
 DD4HEP_INSTANTIATE_HANDLE(FieldMapXYZ);
 
 namespace {
+// Size of the TTree cache used for the sequential read of the field map
+const long long treeCacheSize = 64 * 1024 * 1024;
+
 void checkBranch(int retCode) {
 
   if (retCode != 0) {
@@ -32,13 +43,281 @@ void checkBranch(int retCode) {
     throw std::runtime_error(error.str());
   }
 }
+
+// Mirror symmetries from a list like "mirrorX mirrorZ", with optional sign rules like mirrorXSigns="-++"
+void setSymmetry(FieldMapXYZ& map, dd4hep::xml::Component& xmlParameter) {
+
+  std::stringstream symmetry(xmlParameter.attr<std::string>(_Unicode(symmetry), std::string()));
+  const std::string axisNames[3] = {"mirrorX", "mirrorY", "mirrorZ"};
+  std::string declaration;
+  while (symmetry >> declaration) {
+    const int axis = std::find(axisNames, axisNames + 3, declaration) - axisNames;
+    if (axis == 3) {
+      std::stringstream error;
+      error << "FieldMapXYZ[ERROR]: Unknown symmetry " << declaration << ", use mirrorX, mirrorY and/or mirrorZ";
+      throw std::runtime_error(error.str());
+    }
+    map.mirror[axis] = true;
+    map.hasSymmetry = true;
+  }
+
+  const char* signsAttributes[3] = {_Unicode(mirrorXSigns), _Unicode(mirrorYSigns), _Unicode(mirrorZSigns)};
+  for (int axis = 0; axis < 3; axis++) {
+    if (not xmlParameter.hasAttr(signsAttributes[axis]))
+      continue;
+    const std::string signs = xmlParameter.attr<std::string>(signsAttributes[axis]);
+    if (signs.size() != 3 || signs.find_first_not_of("+-") != std::string::npos) {
+      std::stringstream error;
+      error << "FieldMapXYZ[ERROR]: " << axisNames[axis] << "Signs must be three of + or - for Bx, By and Bz, got "
+            << signs;
+      throw std::runtime_error(error.str());
+    }
+    for (int k = 0; k < 3; k++)
+      map.mirrorSigns[axis][k] = signs[k] == '-' ? -1.0 : 1.0;
+  }
+}
+
+// Use the cached field map if it is valid for the identification in header
+bool readCache(FieldMapXYZ& map, FieldMapCache::Header& header) {
+
+  const double* values = FieldMapCache::load(map.cacheFile, header, map.mappedRegion);
+  if (not values)
+    return false;
+
+  map.nX = header.nBins[0];
+  map.nY = header.nBins[1];
+  map.nZ = header.nBins[2];
+  map.xOrdering = header.ordering[0];
+  map.yOrdering = header.ordering[1];
+  map.zOrdering = header.ordering[2];
+  map.coorsOrder = header.coorsOrder;
+  map.strCoorsOrder = header.strCoorsOrder;
+  map.xMin = header.gridMin[0];
+  map.yMin = header.gridMin[1];
+  map.zMin = header.gridMin[2];
+  map.xMax = header.gridMax[0];
+  map.yMax = header.gridMax[1];
+  map.zMax = header.gridMax[2];
+  map.xStep = header.gridStep[0];
+  map.yStep = header.gridStep[1];
+  map.zStep = header.gridStep[2];
+
+  if (header.nValues != 3 * std::uint64_t(map.nX) * map.nY * map.nZ) {
+    map.mappedRegion.reset();
+    return false;
+  }
+  std::vector<FieldMapXYZ::FieldValues_t>().swap(map.fieldMap);
+  map.mappedFieldMap = reinterpret_cast<const FieldMapXYZ::FieldValues_t*>(values);
+  return true;
+}
+
+void writeCache(const FieldMapXYZ& map, FieldMapCache::Header header) {
+
+  header.nBins[0] = map.nX;
+  header.nBins[1] = map.nY;
+  header.nBins[2] = map.nZ;
+  header.ordering[0] = map.xOrdering;
+  header.ordering[1] = map.yOrdering;
+  header.ordering[2] = map.zOrdering;
+  header.coorsOrder = map.coorsOrder;
+  map.strCoorsOrder.copy(header.strCoorsOrder, sizeof(header.strCoorsOrder) - 1);
+  header.gridMin[0] = map.xMin;
+  header.gridMin[1] = map.yMin;
+  header.gridMin[2] = map.zMin;
+  header.gridMax[0] = map.xMax;
+  header.gridMax[1] = map.yMax;
+  header.gridMax[2] = map.zMax;
+  header.gridStep[0] = map.xStep;
+  header.gridStep[1] = map.yStep;
+  header.gridStep[2] = map.zStep;
+
+  FieldMapCache::store(map.cacheFile, header, reinterpret_cast<const double*>(map.fieldMap.data()),
+                       3 * map.fieldMap.size());
+}
+
+// Copy the 8 corners of every grid cell next to each other, component by component,
+// corner c is located at (xBin + (c & 1), yBin + ((c >> 1) & 1), zBin + (c >> 2))
+template <typename T> void fillPackedCells(const FieldMapXYZ& map, std::vector<T>& cells) {
+
+  const int nCellX = map.nX - 1;
+  const int nCellY = map.nY - 1;
+  const int nCellZ = map.nZ - 1;
+  cells.assign(std::size_t(nCellX) * nCellY * nCellZ * FieldMapXYZ::packedCellSize, T(0));
+
+  T* cell = cells.data();
+  for (int iz = 0; iz < nCellZ; iz++) {
+    for (int iy = 0; iy < nCellY; iy++) {
+      for (int ix = 0; ix < nCellX; ix++) {
+        for (int c = 0; c < 8; c++) {
+          const int jx = ix + (c & 1);
+          const int jy = iy + ((c >> 1) & 1);
+          const int jz = iz + (c >> 2);
+          const FieldMapXYZ::FieldValues_t& B = map.nodes()[jx + jy * map.nX + jz * map.nX * map.nY];
+          cell[c] = T(B.Bx);
+          cell[8 + c] = T(B.By);
+          cell[16 + c] = T(B.Bz);
+        }
+        cell += FieldMapXYZ::packedCellSize;
+      }
+    }
+  }
+}
+
+// Derivative along the axis of n nodes separated by stride, in units of the grid step: central differences
+// inside the map and second order one-sided differences on its edges
+void gridDerivative(const std::vector<double>& f, std::vector<double>& df, int n, std::size_t stride) {
+
+  df.resize(f.size());
+  for (std::size_t i = 0; i < f.size(); i++) {
+    const int bin = (i / stride) % n;
+    if (n == 2)
+      df[i] = bin == 0 ? f[i + stride] - f[i] : f[i] - f[i - stride];
+    else if (bin == 0)
+      df[i] = 0.5 * (-3.0 * f[i] + 4.0 * f[i + stride] - f[i + 2 * stride]);
+    else if (bin == n - 1)
+      df[i] = 0.5 * (3.0 * f[i] - 4.0 * f[i - stride] + f[i - 2 * stride]);
+    else
+      df[i] = 0.5 * (f[i + stride] - f[i - stride]);
+  }
+}
+
+// Value, first derivatives and mixed derivatives of each component at every grid node
+template <typename T> void fillHermiteNodes(const FieldMapXYZ& map, std::vector<T>& hermiteNodes) {
+
+  const std::size_t nNodes = std::size_t(map.nX) * map.nY * map.nZ;
+  const std::size_t strideY = map.nX;
+  const std::size_t strideZ = std::size_t(map.nX) * map.nY;
+  hermiteNodes.assign(nNodes * FieldMapXYZ::hermiteNodeSize, T(0));
+
+  const FieldMapXYZ::FieldValues_t* fieldNodes = map.nodes();
+  std::vector<double> d[8];
+  for (int k = 0; k < 3; k++) {
+    d[0].resize(nNodes);
+    for (std::size_t i = 0; i < nNodes; i++)
+      d[0][i] = k == 0 ? fieldNodes[i].Bx : (k == 1 ? fieldNodes[i].By : fieldNodes[i].Bz);
+    gridDerivative(d[0], d[1], map.nX, 1);
+    gridDerivative(d[0], d[2], map.nY, strideY);
+    gridDerivative(d[1], d[3], map.nY, strideY);
+    for (int j = 0; j < 4; j++)
+      gridDerivative(d[j], d[4 + j], map.nZ, strideZ);
+
+    for (std::size_t i = 0; i < nNodes; i++)
+      for (int j = 0; j < 8; j++)
+        hermiteNodes[i * FieldMapXYZ::hermiteNodeSize + 8 * k + j] = T(d[j][i]);
+  }
+}
+
+// Last cell used by the thread in a map: lower corner, upper corner within the map, field at the 8 corners (corner c
+// at x0 + (c & 1) * xStep, y0 + ((c >> 1) & 1) * yStep, z0 + (c >> 2) * zStep), and the lookups not yet flushed
+struct CellCacheXYZ {
+  std::uint64_t owner = 0; // cellCacheId of the map the cell belongs to, 0 if empty
+  double x0 = 0, y0 = 0, z0 = 0;
+  double x1 = -1, y1 = -1, z1 = -1;
+  double B[3][8];
+  std::uint64_t lookups = 0;
+  std::uint64_t hits = 0;
+};
+
+// Cell caches of the thread, one per map, so that maps queried alternately (e.g. the maps of a FieldComposite) keep
+// their cells. A map without a cache takes the one taken the longest ago, whose lookups are flushed to its owner
+const int cellCacheSlots = 8;
+// The caches of the thread are only released by a map destructor while alive: a map destroyed at exit, after the
+// thread_locals of the thread, or in a thread which never used a cache must not touch (or create) them
+thread_local bool cellCachesXYZAlive = false;
+struct CellCachesXYZ {
+  CellCacheXYZ cells[cellCacheSlots];
+  std::shared_ptr<FieldMapXYZ::CellCacheCounters> counters[cellCacheSlots]; // counters of the owners
+  int lastSlot = 0;                                                         // slot of the last lookup
+  int nextSlot = 0;                                                         // slot taken by the next map
+
+  void flush(int slot) {
+    if (counters[slot]) {
+      counters[slot]->lookups += cells[slot].lookups;
+      counters[slot]->hits += cells[slot].hits;
+    }
+    cells[slot].lookups = 0;
+    cells[slot].hits = 0;
+  }
+
+  CellCacheXYZ& cell(std::uint64_t owner, const std::shared_ptr<FieldMapXYZ::CellCacheCounters>& ownerCounters) {
+    if (cells[lastSlot].owner == owner)
+      return cells[lastSlot];
+    for (int slot = 0; slot < cellCacheSlots; slot++) {
+      if (cells[slot].owner == owner) {
+        lastSlot = slot;
+        return cells[slot];
+      }
+    }
+    lastSlot = nextSlot;
+    nextSlot = (nextSlot + 1) % cellCacheSlots;
+    flush(lastSlot);
+    cells[lastSlot] = CellCacheXYZ();
+    cells[lastSlot].owner = owner;
+    counters[lastSlot] = ownerCounters;
+    return cells[lastSlot];
+  }
+
+  void release(std::uint64_t owner) {
+    for (int slot = 0; slot < cellCacheSlots; slot++) {
+      if (cells[slot].owner == owner) {
+        flush(slot);
+        cells[slot] = CellCacheXYZ();
+        counters[slot].reset();
+      }
+    }
+  }
+
+  CellCachesXYZ() { cellCachesXYZAlive = true; }
+
+  ~CellCachesXYZ() {
+    cellCachesXYZAlive = false;
+    for (int slot = 0; slot < cellCacheSlots; slot++)
+      flush(slot);
+  }
+};
+thread_local CellCachesXYZ cellCachesXYZ;
+
+// Source of FieldMapXYZ::cellCacheId, a map allocated at the address of a deleted one must not reuse its cells
+std::atomic<std::uint64_t> nextCellCacheId(1);
+
+// Lookups between two updates of the shared counters of the map
+const std::uint64_t cacheFlushInterval = 4096;
+
+// Cubic Hermite basis at t in [0, 1]: value and slope at 0, value and slope at 1
+inline void hermiteBasis(double t, double* h) {
+  const double t2 = t * t;
+  const double t3 = t2 * t;
+  h[0] = 2.0 * t3 - 3.0 * t2 + 1.0;
+  h[1] = t3 - 2.0 * t2 + t;
+  h[2] = 3.0 * t2 - 2.0 * t3;
+  h[3] = t3 - t2;
+}
 } // namespace
 
-FieldMapXYZ::FieldMapXYZ() {
+FieldMapXYZ::FieldMapXYZ()
+    : mappedFieldMap(nullptr), floatStorage(false), usePackedCells(false), useCubic(false), useCellCache(false),
+      cellCacheId(nextCellCacheId++), cacheCounters(std::make_shared<CellCacheCounters>()), hasSymmetry(false),
+      mirror{false, false, false},
+      // Default signs are the ones of a solenoid-like field along z: Bx(-x) = -Bx(x), By(-y) = -By(y)
+      // and the radial components change sign in z, Bx(-z) = -Bx(z), By(-z) = -By(z)
+      mirrorSigns{{-1.0, 1.0, 1.0}, {1.0, -1.0, 1.0}, {-1.0, -1.0, 1.0}} {
   field_type = CartesianField::MAGNETIC;
   type = CartesianField::MAGNETIC;
 } // ctor
 
+FieldMapXYZ::~FieldMapXYZ() {
+
+  if (cellCachesXYZAlive)
+    cellCachesXYZ.release(cellCacheId);
+  const std::uint64_t cacheLookups = cacheCounters->lookups;
+  const std::uint64_t cacheHits = cacheCounters->hits;
+  if (useCellCache && cacheLookups > 0) {
+    std::cout << "FieldMapXYZ: " << cacheHits << " of " << cacheLookups << " lookups in the cached cell ("
+              << 100.0 * cacheHits / cacheLookups << "%), not counting the last " << cacheFlushInterval
+              << " or less lookups of the other threads" << std::endl;
+  }
+} // dtor
+
 int FieldMapXYZ::getGlobalIndex(const int xBin, const int yBin, const int zBin) {
 
   // Global index in fieldmap array from x, y and z axes indexes
@@ -70,11 +349,65 @@ int FieldMapXYZ::getGlobalIndex(const int xBin, const int yBin, const int zBin)
   return globalIndex;
 }
 
+/**
+    Field at the given position. With mirror symmetries the position is reflected into the
+    stored part of the map and the field components are flipped according to mirrorSigns
+ */
+void FieldMapXYZ::fieldComponents(const double* pos, double* globalField) {
+
+  if (not hasSymmetry) {
+    interpolate(pos, globalField);
+    return;
+  }
+
+  double mirroredPos[3] = {pos[0], pos[1], pos[2]};
+  double sign[3] = {1.0, 1.0, 1.0};
+  for (int axis = 0; axis < 3; axis++) {
+    if (mirror[axis] && mirroredPos[axis] < 0) {
+      mirroredPos[axis] = -mirroredPos[axis];
+      for (int k = 0; k < 3; k++)
+        sign[k] *= mirrorSigns[axis][k];
+    }
+  }
+
+  double field[3] = {0.0, 0.0, 0.0};
+  interpolate(mirroredPos, field);
+  globalField[0] += sign[0] * field[0];
+  globalField[1] += sign[1] * field[1];
+  globalField[2] += sign[2] * field[2];
+}
+
+/// Interpolation in the stored part of the map, from whichever storage is in use
+void FieldMapXYZ::interpolate(const double* pos, double* field) const {
+
+  if (usePackedCells) {
+    if (floatStorage)
+      packedFieldComponents(packedCellsFloat.data(), pos, field);
+    else
+      packedFieldComponents(packedCellsDouble.data(), pos, field);
+  } else if (useCubic) {
+    if (floatStorage)
+      hermiteFieldComponents(hermiteNodesFloat.data(), pos, field);
+    else
+      hermiteFieldComponents(hermiteNodesDouble.data(), pos, field);
+  } else if (useCellCache) {
+    if (floatStorage)
+      cachedFieldComponents(fieldMapFloat.data(), pos, field);
+    else
+      cachedFieldComponents(nodes(), pos, field);
+  } else if (floatStorage) {
+    nodeFieldComponents(fieldMapFloat.data(), pos, field);
+  } else {
+    nodeFieldComponents(nodes(), pos, field);
+  }
+}
+
 /**
     Use bileanar interpolation to calculate the field at the given position
     This uses large pieces from Mokka FieldX03
  */
-void FieldMapXYZ::fieldComponents(const double* pos, double* globalField) {
+template <typename Node>
+void FieldMapXYZ::nodeFieldComponents(const Node* fieldNodes, const double* pos, double* globalField) const {
 
   // get position coordinates in our system
   const double x = pos[0];
@@ -129,14 +462,14 @@ void FieldMapXYZ::fieldComponents(const double* pos, double* globalField) {
     yBin1 = nY - 1;
   if (zBin1 > nZ - 1)
     zBin1 = nZ - 1;
-  const FieldMapXYZ::FieldValues_t& B_x0y0z0 = fieldMap[xBin0 + yBin0 * (nX) + zBin0 * (nX * nY)];
-  const FieldMapXYZ::FieldValues_t& B_x1y0z0 = fieldMap[xBin1 + yBin0 * (nX) + zBin0 * (nX * nY)];
-  const FieldMapXYZ::FieldValues_t& B_x0y0z1 = fieldMap[xBin0 + yBin0 * (nX) + zBin1 * (nX * nY)];
-  const FieldMapXYZ::FieldValues_t& B_x1y0z1 = fieldMap[xBin1 + yBin0 * (nX) + zBin1 * (nX * nY)];
-  const FieldMapXYZ::FieldValues_t& B_x0y1z0 = fieldMap[xBin0 + yBin1 * (nX) + zBin0 * (nX * nY)];
-  const FieldMapXYZ::FieldValues_t& B_x1y1z0 = fieldMap[xBin1 + yBin1 * (nX) + zBin0 * (nX * nY)];
-  const FieldMapXYZ::FieldValues_t& B_x0y1z1 = fieldMap[xBin0 + yBin1 * (nX) + zBin1 * (nX * nY)];
-  const FieldMapXYZ::FieldValues_t& B_x1y1z1 = fieldMap[xBin1 + yBin1 * (nX) + zBin1 * (nX * nY)];
+  const Node& B_x0y0z0 = fieldNodes[xBin0 + yBin0 * (nX) + zBin0 * (nX * nY)];
+  const Node& B_x1y0z0 = fieldNodes[xBin1 + yBin0 * (nX) + zBin0 * (nX * nY)];
+  const Node& B_x0y0z1 = fieldNodes[xBin0 + yBin0 * (nX) + zBin1 * (nX * nY)];
+  const Node& B_x1y0z1 = fieldNodes[xBin1 + yBin0 * (nX) + zBin1 * (nX * nY)];
+  const Node& B_x0y1z0 = fieldNodes[xBin0 + yBin1 * (nX) + zBin0 * (nX * nY)];
+  const Node& B_x1y1z0 = fieldNodes[xBin1 + yBin1 * (nX) + zBin0 * (nX * nY)];
+  const Node& B_x0y1z1 = fieldNodes[xBin0 + yBin1 * (nX) + zBin1 * (nX * nY)];
+  const Node& B_x1y1z1 = fieldNodes[xBin1 + yBin1 * (nX) + zBin1 * (nX * nY)];
 
   // field at (x,y,z) point is linear interpolation of fielmap values at bin corners
   double B_00, B_01, B_10, B_11, B_0, B_1, B;
@@ -196,8 +529,298 @@ void FieldMapXYZ::fieldComponents(const double* pos, double* globalField) {
   return;
 }
 
+/**
+    Same interpolation as nodeFieldComponents, but the bins and the corner values are kept in a thread-local
+    cache and reused as long as the points stay in the same cell, as for the consecutive steps of a track.
+    Used with packedCells and interpolation="cubic" disabled
+ */
+template <typename Node>
+void FieldMapXYZ::cachedFieldComponents(const Node* fieldNodes, const double* pos, double* globalField) const {
+
+  const double x = pos[0];
+  const double y = pos[1];
+  const double z = pos[2];
+
+  CellCacheXYZ& cache = cellCachesXYZ.cell(cellCacheId, cacheCounters);
+  cache.lookups++;
+
+  if (x >= cache.x0 && x <= cache.x1 && y >= cache.y0 && y <= cache.y1 && z >= cache.z0 && z <= cache.z1) {
+    cache.hits++;
+  } else {
+    // Do nothing if the point is outside fieldmap limits
+    if (not(x >= xMin && x <= xMax && y >= yMin && y <= yMax && z >= zMin && z <= zMax))
+      return;
+
+    // Bins as in nodeFieldComponents
+    int xBin = int((x - xMin) / xStep);
+    int yBin = int((y - yMin) / yStep);
+    int zBin = int((z - zMin) / zStep);
+    if (xMin + xBin * xStep > x)
+      xBin -= 1;
+    if (yMin + yBin * yStep > y)
+      yBin -= 1;
+    if (zMin + zBin * zStep > z)
+      zBin -= 1;
+    cache.x0 = xMin + xBin * xStep;
+    cache.y0 = yMin + yBin * yStep;
+    cache.z0 = zMin + zBin * zStep;
+    cache.x1 = std::min(cache.x0 + xStep, xMax);
+    cache.y1 = std::min(cache.y0 + yStep, yMax);
+    cache.z1 = std::min(cache.z0 + zStep, zMax);
+
+    // Protection in case the sampled coordinate is exactly at maximum value of fieldmap
+    const int xBin1 = std::min(xBin + 1, nX - 1);
+    const int yBin1 = std::min(yBin + 1, nY - 1);
+    const int zBin1 = std::min(zBin + 1, nZ - 1);
+    const int xBins[2] = {xBin, xBin1};
+    const int yBins[2] = {yBin, yBin1};
+    const int zBins[2] = {zBin, zBin1};
+    for (int c = 0; c < 8; c++) {
+      const Node& B = fieldNodes[xBins[c & 1] + yBins[(c >> 1) & 1] * (nX) + zBins[c >> 2] * (nX * nY)];
+      cache.B[0][c] = B.Bx;
+      cache.B[1][c] = B.By;
+      cache.B[2][c] = B.Bz;
+    }
+  }
+
+  if (cache.lookups >= cacheFlushInterval) {
+    cacheCounters->lookups += cache.lookups;
+    cacheCounters->hits += cache.hits;
+    cache.lookups = 0;
+    cache.hits = 0;
+  }
+
+  // Get normalized coordinate of (x,y,z) point in bin
+  const double xd = (x - cache.x0) / xStep;
+  const double yd = (y - cache.y0) / yStep;
+  const double zd = (z - cache.z0) / zStep;
+
+  // field at (x,y,z) point is linear interpolation of fielmap values at bin corners
+  for (int k = 0; k < 3; k++) {
+    const double* B = cache.B[k];
+    const double B_00 = (1.0 - xd) * B[0] + xd * B[1];
+    const double B_01 = (1.0 - xd) * B[4] + xd * B[5];
+    const double B_10 = (1.0 - xd) * B[2] + xd * B[3];
+    const double B_11 = (1.0 - xd) * B[6] + xd * B[7];
+    const double B_0 = (1.0 - yd) * B_00 + yd * B_10;
+    const double B_1 = (1.0 - yd) * B_01 + yd * B_11;
+    globalField[k] += (1.0 - zd) * B_0 + zd * B_1;
+  }
+}
+
+/**
+    Trilinear interpolation using the packed cells: the bins are obtained with the reciprocal
+    step-sizes and the eight corners of the cell are read from one contiguous block.
+    Results agree with the fieldMap interpolation up to rounding (float rounding with floatStorage)
+ */
+template <typename T>
+void FieldMapXYZ::packedFieldComponents(const T* cells, const double* pos, double* globalField) const {
+
+  const double x = pos[0];
+  const double y = pos[1];
+  const double z = pos[2];
+
+  // Do nothing if the point is outside fieldmap limits
+  if (not(x >= xMin && x <= xMax && y >= yMin && y <= yMax && z >= zMin && z <= zMax)) {
+    return;
+  }
+
+  // Bins containing the point, the upper edge of the map belongs to the last cell
+  const double xu = (x - xMin) * xInvStep;
+  const double yu = (y - yMin) * yInvStep;
+  const double zu = (z - zMin) * zInvStep;
+  const int xBin = std::min(int(xu), nX - 2);
+  const int yBin = std::min(int(yu), nY - 2);
+  const int zBin = std::min(int(zu), nZ - 2);
+
+  // Normalized coordinate of the point in the cell
+  const double xd = xu - xBin;
+  const double yd = yu - yBin;
+  const double zd = zu - zBin;
+
+  const T* cell = cells + packedCellSize * (std::size_t(xBin) + std::size_t(yBin) * (nX - 1) +
+                                            std::size_t(zBin) * (nX - 1) * (nY - 1));
+
+  // Weights of the eight corners, same corner ordering as in the packed cells
+  const double w00 = (1.0 - yd) * (1.0 - zd);
+  const double w10 = yd * (1.0 - zd);
+  const double w01 = (1.0 - yd) * zd;
+  const double w11 = yd * zd;
+  const double w[8] = {(1.0 - xd) * w00, xd * w00, (1.0 - xd) * w10, xd * w10,
+                       (1.0 - xd) * w01, xd * w01, (1.0 - xd) * w11, xd * w11};
+
+  // Each component is the dot product of the weights with its eight corner values
+  for (int k = 0; k < 3; k++) {
+    const T* B = cell + 8 * k;
+    globalField[k] += (w[0] * B[0] + w[1] * B[1]) + (w[2] * B[2] + w[3] * B[3]) + (w[4] * B[4] + w[5] * B[5]) +
+                      (w[6] * B[6] + w[7] * B[7]);
+  }
+}
+
+/**
+    Tricubic Hermite interpolation: tensor product of the cubic Hermite basis in x, y and z, with the
+    value, the first derivatives and the mixed derivatives at the eight corners of the cell. The field
+    and its first derivatives are continuous across the cells
+ */
+template <typename T>
+void FieldMapXYZ::hermiteFieldComponents(const T* hermiteNodes, const double* pos, double* globalField) const {
+
+  const double x = pos[0];
+  const double y = pos[1];
+  const double z = pos[2];
+
+  // Do nothing if the point is outside fieldmap limits
+  if (not(x >= xMin && x <= xMax && y >= yMin && y <= yMax && z >= zMin && z <= zMax)) {
+    return;
+  }
+
+  // Bins containing the point, the upper edge of the map belongs to the last cell
+  const double xu = (x - xMin) * xInvStep;
+  const double yu = (y - yMin) * yInvStep;
+  const double zu = (z - zMin) * zInvStep;
+  const int xBin = std::min(int(xu), nX - 2);
+  const int yBin = std::min(int(yu), nY - 2);
+  const int zBin = std::min(int(zu), nZ - 2);
+
+  double hx[4], hy[4], hz[4];
+  hermiteBasis(xu - xBin, hx);
+  hermiteBasis(yu - yBin, hy);
+  hermiteBasis(zu - zBin, hz);
+
+  const std::size_t strideY = nX;
+  const std::size_t strideZ = std::size_t(nX) * nY;
+  const T* node000 = hermiteNodes + hermiteNodeSize * (std::size_t(xBin) + yBin * strideY + zBin * strideZ);
+
+  // Weight of derivative d at corner c, both with bits ordered x, y, z
+  double w[64];
+  for (int c = 0; c < 8; c++) {
+    const double* wx = hx + 2 * (c & 1);
+    const double* wy = hy + 2 * ((c >> 1) & 1);
+    const double* wz = hz + 2 * (c >> 2);
+    for (int d = 0; d < 8; d++)
+      w[8 * c + d] = wx[d & 1] * wy[(d >> 1) & 1] * wz[d >> 2];
+  }
+
+  // Each component is the dot product of the weights with the 8 values of its 8 corners
+  double B[3] = {0.0, 0.0, 0.0};
+  for (int c = 0; c < 8; c++) {
+    const T* node = node000 + hermiteNodeSize * ((c & 1) + ((c >> 1) & 1) * strideY + (c >> 2) * strideZ);
+    for (int k = 0; k < 3; k++) {
+      double sum = 0.0;
+      for (int d = 0; d < 8; d++)
+        sum += w[8 * c + d] * node[8 * k + d];
+      B[k] += sum;
+    }
+  }
+  globalField[0] += B[0];
+  globalField[1] += B[1];
+  globalField[2] += B[2];
+}
+
+/**
+    Batch version of fieldComponents, uses the SIMD kernels of FieldMapSimd.h when the CPU has
+    AVX2 or AVX-512 and the scalar interpolation for the remaining points and the other storages
+ */
+void FieldMapXYZ::batchFieldComponents(std::size_t n, const double* x, const double* y, const double* z, double* bx,
+                                       double* by, double* bz) {
+
+  static_assert(sizeof(FieldValues_t) == 3 * sizeof(double), "FieldValues_t must be a plain Bx, By, Bz triplet");
+
+  std::size_t i = 0;
+  // The kernels gather with 32-bit indices from the double precision points, without symmetries
+  if (not usePackedCells && not useCubic && not floatStorage && not hasSymmetry && 3.0 * nX * nY * nZ < 2147483647.0) {
+    const FieldMapSimd::GridXYZ grid = {reinterpret_cast<const double*>(nodes()),
+                                        nX,
+                                        nY,
+                                        nZ,
+                                        xMin,
+                                        xMax,
+                                        1.0 / xStep,
+                                        yMin,
+                                        yMax,
+                                        1.0 / yStep,
+                                        zMin,
+                                        zMax,
+                                        1.0 / zStep};
+    i = FieldMapSimd::trilinearBatch(grid, n, x, y, z, bx, by, bz);
+  }
+
+  for (; i < n; i++) {
+    const double pos[3] = {x[i], y[i], z[i]};
+    double field[3] = {bx[i], by[i], bz[i]};
+    FieldMapXYZ::fieldComponents(pos, field);
+    bx[i] = field[0];
+    by[i] = field[1];
+    bz[i] = field[2];
+  }
+}
+
+void FieldMapXYZ::buildPackedCells() {
+
+  xInvStep = 1.0 / xStep;
+  yInvStep = 1.0 / yStep;
+  zInvStep = 1.0 / zStep;
+
+  std::vector<float>().swap(packedCellsFloat);
+  std::vector<double>().swap(packedCellsDouble);
+  if (floatStorage)
+    fillPackedCells(*this, packedCellsFloat);
+  else
+    fillPackedCells(*this, packedCellsDouble);
+}
+
+void FieldMapXYZ::buildStorage() {
+
+  if (usePackedCells) {
+    buildPackedCells();
+  } else if (useCubic) {
+    buildHermiteNodes();
+  } else if (floatStorage) {
+    const FieldValues_t* fieldNodes = nodes();
+    const std::size_t nNodes = std::size_t(nX) * nY * nZ;
+    fieldMapFloat.resize(nNodes);
+    for (std::size_t i = 0; i < nNodes; i++)
+      fieldMapFloat[i] = {float(fieldNodes[i].Bx), float(fieldNodes[i].By), float(fieldNodes[i].Bz)};
+  }
+
+  // The double precision points are only needed by the lookups from fieldMap
+  if (usePackedCells || useCubic || floatStorage) {
+    std::vector<FieldValues_t>().swap(fieldMap);
+    mappedFieldMap = nullptr;
+    mappedRegion.reset();
+  }
+}
+
+void FieldMapXYZ::buildHermiteNodes() {
+
+  xInvStep = 1.0 / xStep;
+  yInvStep = 1.0 / yStep;
+  zInvStep = 1.0 / zStep;
+
+  std::vector<float>().swap(hermiteNodesFloat);
+  std::vector<double>().swap(hermiteNodesDouble);
+  if (floatStorage)
+    fillHermiteNodes(*this, hermiteNodesFloat);
+  else
+    fillHermiteNodes(*this, hermiteNodesDouble);
+}
+
+std::size_t FieldMapXYZ::storageBytes() const {
+  return fieldMap.capacity() * sizeof(FieldValues_t) + fieldMapFloat.capacity() * sizeof(FloatFieldValues_t) +
+         packedCellsFloat.capacity() * sizeof(float) + packedCellsDouble.capacity() * sizeof(double) +
+         hermiteNodesFloat.capacity() * sizeof(float) + hermiteNodesDouble.capacity() * sizeof(double);
+}
+
 void FieldMapXYZ::fillFieldMapFromTree(const std::string& filename, double coorUnits, double BfieldUnits) {
 
+  // Everything besides the source file which changes the content of the field map
+  std::stringstream cacheKey;
+  cacheKey << std::hexfloat << ntupleName << ":" << xVar << ":" << yVar << ":" << zVar << ":" << BxVar << ":" << ByVar
+           << ":" << BzVar << ":" << coorUnits << ":" << BfieldUnits << ":" << bScale;
+  FieldMapCache::Header cacheHeader = FieldMapCache::makeHeader(FieldMapCache::XYZ, filename, cacheKey.str());
+  if (not cacheFile.empty() && readCache(*this, cacheHeader))
+    return;
+
   TFile* file = TFile::Open(filename.c_str());
   if (not file) {
     std::stringstream error;
@@ -223,6 +846,13 @@ void FieldMapXYZ::fillFieldMapFromTree(const std::string& filename, double coorU
     throw std::runtime_error(error.str());
   }
 
+  // Only read the branches in use, through the tree cache
+  tree->SetBranchStatus("*", false);
+  for (const std::string* var : {&xVar, &yVar, &zVar, &BxVar, &ByVar, &BzVar})
+    tree->SetBranchStatus(var->c_str(), true);
+  tree->SetCacheSize(treeCacheSize);
+  tree->AddBranchToCache("*", true);
+
   // Set branch adresses
   float x, y, z, Bx, By, Bz;
   checkBranch(tree->SetBranchAddress(xVar.c_str(), &x));
@@ -232,9 +862,11 @@ void FieldMapXYZ::fillFieldMapFromTree(const std::string& filename, double coorU
   checkBranch(tree->SetBranchAddress(ByVar.c_str(), &By));
   checkBranch(tree->SetBranchAddress(BzVar.c_str(), &Bz));
 
-  // Loop over the tree entries. In this loop get,
+  // Read the tree entries sequentially, once. In this loop get,
   //  - min, max and step-size values of fieldmap coordinates
   //  - coordinates ordering
+  //  - the field values, in the order of the tree
+  const auto loadStart = std::chrono::steady_clock::now();
   xStep = -1;
   yStep = -1;
   zStep = -1;
@@ -243,9 +875,12 @@ void FieldMapXYZ::fillFieldMapFromTree(const std::string& filename, double coorU
   zOrdering = 1;
   strCoorsOrder = std::string("");
   const int treeEntries = tree->GetEntries();
-  fieldMap.reserve(treeEntries);
+  std::vector<float> treeBx(treeEntries), treeBy(treeEntries), treeBz(treeEntries);
   for (int i = 0; i < treeEntries; i++) {
     tree->GetEntry(i);
+    treeBx[i] = Bx;
+    treeBy[i] = By;
+    treeBz[i] = Bz;
 
     if (i == 0) {
       xMin = x;
@@ -346,19 +981,28 @@ void FieldMapXYZ::fillFieldMapFromTree(const std::string& filename, double coorU
     throw std::runtime_error(error.str());
   }
 
-  // Fill the array with the Bfield values in the XYZ order
+  // Fill the array with the Bfield values in the XYZ order, transposing in memory from the tree order
+  fieldMap.clear();
+  fieldMap.reserve(elements);
   for (int iz = 0; iz < nZ; iz++) {
     for (int iy = 0; iy < nY; iy++) {
       for (int ix = 0; ix < nX; ix++) {
-        tree->GetEntry(getGlobalIndex(ix, iy, iz));
-        fieldMap.push_back(FieldMapXYZ::FieldValues_t(
-            double(Bx) * bScale * BfieldUnits, double(By) * bScale * BfieldUnits, double(Bz) * bScale * BfieldUnits));
+        const int i = getGlobalIndex(ix, iy, iz);
+        fieldMap.push_back(FieldMapXYZ::FieldValues_t(double(treeBx[i]) * bScale * BfieldUnits,
+                                                      double(treeBy[i]) * bScale * BfieldUnits,
+                                                      double(treeBz[i]) * bScale * BfieldUnits));
       }
     }
   }
 
   file->Close();
   delete file;
+
+  const std::chrono::duration<double> loadTime = std::chrono::steady_clock::now() - loadStart;
+  std::cout << "FieldMapXYZ: read " << treeEntries << " entries in " << loadTime.count() << " s" << std::endl;
+
+  if (not cacheFile.empty())
+    writeCache(*this, cacheHeader);
 }
 
 static Ref_t create_FieldMap_XYZ(Detector&, dd4hep::xml::Handle_t handle) {
@@ -388,8 +1032,36 @@ static Ref_t create_FieldMap_XYZ(Detector&, dd4hep::xml::Handle_t handle) {
   double coorUnits = xmlParameter.attr<double>(_Unicode(coorUnits));
   double BfieldUnits = xmlParameter.attr<double>(_Unicode(BfieldUnits));
 
+  bool packedCells = xmlParameter.attr<bool>(_Unicode(packedCells), false);
+  bool cellCache = xmlParameter.attr<bool>(_Unicode(cellCache), false);
+  std::string interpolation = xmlParameter.attr<std::string>(_Unicode(interpolation), std::string("linear"));
+  if (interpolation != "linear" && interpolation != "cubic") {
+    std::stringstream error;
+    error << "FieldMapXYZ[ERROR]: Unknown interpolation " << interpolation << ", use linear or cubic";
+    throw std::runtime_error(error.str());
+  }
+  if (interpolation == "cubic" && packedCells) {
+    std::stringstream error;
+    error << "FieldMapXYZ[ERROR]: packedCells is only available with the linear interpolation";
+    throw std::runtime_error(error.str());
+  }
+  // The packed cells and the cubic interpolation do not go through the cell cache
+  if (cellCache && (packedCells || interpolation == "cubic")) {
+    std::stringstream error;
+    error << "FieldMapXYZ[ERROR]: cellCache is only available with the linear interpolation without packedCells";
+    throw std::runtime_error(error.str());
+  }
+  bool floatStorage = xmlParameter.attr<bool>(_Unicode(floatStorage), false);
+  std::string cacheFile = xmlParameter.attr<std::string>(_Unicode(cacheFile), std::string());
+
   CartesianField obj;
   FieldMapXYZ* ptr = new FieldMapXYZ();
+  setSymmetry(*ptr, xmlParameter);
+  ptr->usePackedCells = packedCells;
+  ptr->useCubic = interpolation == "cubic";
+  ptr->useCellCache = cellCache;
+  ptr->floatStorage = floatStorage;
+  ptr->cacheFile = cacheFile;
   ptr->xScale = xScale;
   ptr->yScale = yScale;
   ptr->zScale = zScale;
@@ -448,6 +1120,47 @@ static Ref_t create_FieldMap_XYZ(Detector&, dd4hep::xml::Handle_t handle) {
   ptr->zMax *= zScale;
   ptr->zStep *= zScale;
 
+  // With a mirror symmetry only the positive side is stored, the negative side is obtained by reflection
+  const double mins[3] = {ptr->xMin, ptr->yMin, ptr->zMin};
+  const int nBins[3] = {ptr->nX, ptr->nY, ptr->nZ};
+  const char axisNames[3] = {'x', 'y', 'z'};
+  std::size_t fullVolumeNodes = 1;
+  std::string strSymmetry;
+  for (int axis = 0; axis < 3; axis++) {
+    if (ptr->mirror[axis] && mins[axis] < 0) {
+      std::stringstream error;
+      error << "FieldMapXYZ[ERROR]: Mirror symmetry in " << axisNames[axis] << " needs a field map with "
+            << axisNames[axis] << " >= 0, found " << axisNames[axis] << "Min = " << mins[axis] / dd4hep::cm << " cm";
+      throw std::runtime_error(error.str());
+    }
+    // The mirrored map shares the plane at 0 if the map starts there
+    fullVolumeNodes *= ptr->mirror[axis] ? 2 * nBins[axis] - (mins[axis] == 0 ? 1 : 0) : nBins[axis];
+    if (ptr->mirror[axis]) {
+      strSymmetry += std::string(strSymmetry.empty() ? "mirror" : " mirror") + char(std::toupper(axisNames[axis]));
+      for (int k = 0; k < 3; k++)
+        strSymmetry += ptr->mirrorSigns[axis][k] < 0 ? "-" : "+";
+    }
+  }
+
+  ptr->buildStorage();
+
+  const double storageMB = ptr->storageBytes() / (1024. * 1024.);
+  const std::size_t mappedBytes =
+      ptr->mappedFieldMap ? std::size_t(ptr->nX) * ptr->nY * ptr->nZ * sizeof(FieldMapXYZ::FieldValues_t) : 0;
+  const double mappedMB = mappedBytes / (1024. * 1024.);
+  const double fullVolumeMB = fullVolumeNodes * sizeof(FieldMapXYZ::FieldValues_t) / (1024. * 1024.);
+
+  std::cout << "symmetry    " << std::setw(13) << (strSymmetry.empty() ? "none" : strSymmetry.c_str()) << std::endl;
+  std::cout << "interpolation" << std::setw(12) << interpolation << std::endl;
+  std::cout << "packedCells " << std::setw(13) << (ptr->usePackedCells ? "true" : "false") << std::endl;
+  std::cout << "cellCache   " << std::setw(13) << (ptr->useCellCache ? "true" : "false") << std::endl;
+  std::cout << "floatStorage" << std::setw(13) << (ptr->floatStorage ? "true" : "false") << std::endl;
+  std::cout << "cacheFile   " << std::setw(13) << (cacheFile.empty() ? "none" : cacheFile.c_str()) << std::endl;
+  std::cout << "storage     " << std::setw(13) << storageMB << " MB + " << mappedMB << " MB shared from cacheFile"
+            << std::endl;
+  std::cout << "saved       " << std::setw(13) << fullVolumeMB - storageMB - mappedMB
+            << " MB w.r.t. the full volume in double precision (" << fullVolumeMB << " MB)" << std::endl;
+
   obj.assign(ptr, xmlParameter.nameStr(), xmlParameter.typeStr());
 
   return obj;
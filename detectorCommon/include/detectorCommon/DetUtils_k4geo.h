@@ -21,6 +21,8 @@
 // CLHEP
 #include "CLHEP/Vector/ThreeVector.h"
 
+#include <span>
+
 /** Given a XML element with several daughters with the same name, e.g.
  <detector> <layer name="1" /> <layer name="2"> </detector>
  this method returns the first daughter of type nodeName whose attribute has a given value
@@ -80,6 +82,54 @@ namespace utils {
                                    const std::vector<bool>& aFieldCyclic = {false, false, false, false},
                                    bool aDiagonal = true);
 
+  /** Neighbours in many dimensions, as given by neighbours(), for many cells of the same readout.
+   *  The bit field elements of the fields and all the +-1 combinations of their values are found once when the
+   *  stencil is built, then the neighbours of each cell are written to a buffer of the caller without allocation.
+   *  The neighbours are the same and in the same order as the ones of neighbours().
+   */
+  class NeighbourStencil {
+  public:
+    /**  Build the stencil.
+     *   @param[in] aDecoder Handle to the bitfield decoder.
+     *   @param[in] aFieldNames Names of the fields for which neighbours are found.
+     *   @param[in] aFieldExtremes Minimal and maximal values for the fields.
+     *   @param[in] aFieldCyclic If the fields are cyclic.
+     *   @param[in] aDiagonal If diagonal neighbours should be included (all combinations of fields).
+     */
+    NeighbourStencil(const dd4hep::DDSegmentation::BitFieldCoder& aDecoder,
+                     const std::vector<std::string>& aFieldNames,
+                     const std::vector<std::pair<int, int>>& aFieldExtremes,
+                     const std::vector<bool>& aFieldCyclic = {false, false, false, false}, bool aDiagonal = true);
+
+    /**  Get neighbours of a cell.
+     *   @param[in] aCellId ID of cell.
+     *   @param[out] aNeighbours Buffer for the neighbours, of size at least maxNeighbours().
+     *   return Number of neighbours written to the buffer.
+     */
+    std::size_t neighbours(uint64_t aCellId, std::span<uint64_t> aNeighbours) const;
+
+    /// Maximal number of neighbours of a cell: 2 per field, or 3^(number of fields) - 1 with the diagonal ones
+    inline std::size_t maxNeighbours() const { return m_patternMasks.size(); }
+
+  private:
+    /// Maximal number of fields, as in a 64 bit cellID
+    static constexpr std::size_t kMaxFields = 64;
+    /// Change of one field in a neighbour
+    struct Step {
+      uint32_t field;
+      bool increase;
+    };
+    /// Bit field elements of the fields
+    std::vector<dd4hep::DDSegmentation::BitFieldElement> m_fields;
+    std::vector<std::pair<int, int>> m_fieldExtremes;
+    std::vector<bool> m_fieldCyclic;
+    /// For each neighbour pattern, the bits of the fields it changes
+    std::vector<uint64_t> m_patternMasks;
+    /// Steps of the patterns: the ones of the i-th pattern are m_steps[m_patternOffsets[i]..m_patternOffsets[i+1]-1]
+    std::vector<uint32_t> m_patternOffsets;
+    std::vector<Step> m_steps;
+  };
+
   /** Special version of the neighbours function for the readout with module and theta merged cells
    *  Compared to the standard version, it needs a reference to the segmentation class to
    *  access the number of merged cells per layer. The other parameters and return value are the same
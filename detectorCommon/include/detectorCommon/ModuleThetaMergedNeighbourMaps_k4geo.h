@@ -0,0 +1,65 @@
+#ifndef DETECTORCOMMON_MODULETHETAMERGEDNEIGHBOURMAPS_H
+#define DETECTORCOMMON_MODULETHETAMERGEDNEIGHBOURMAPS_H
+
+// k4geo
+#include "detectorSegmentations/CellNeighbourTable_k4geo.h"
+#include "detectorSegmentations/FCCSWGridModuleThetaMerged_k4geo.h"
+
+#include <array>
+#include <vector>
+
+/** Neighbour and crosstalk maps of all the cells of a readout with module and theta merged cells
+ *  (FCCSWGridModuleThetaMerged_k4geo), computed in parallel with neighbours_ModuleThetaMerged and
+ *  getNeighboursModuleThetaMerged. The cells of each layer are split in blocks of modules that are processed by a
+ *  pool of threads; the blocks are then put together in the order of the cells, with the neighbours of each cell
+ *  sorted by cellID, so that the maps do not depend on the number of threads.
+ */
+namespace det {
+namespace utils {
+
+  /** Get all the cells of the readout, ordered by layer, module and theta.
+   *   @param[in] aSeg Reference to the segmentation object.
+   *   @param[in] aVolumeId ID of a volume of the readout, for the fields other than layer, module and theta.
+   *   @param[in] aNumberOfCells For each layer, the number of merged modules, the number of merged theta cells and
+   *              the first theta ID, as returned by numberOfCells().
+   *   return Vector of cellIDs.
+   */
+  std::vector<uint64_t> cells_ModuleThetaMerged(const dd4hep::DDSegmentation::FCCSWGridModuleThetaMerged_k4geo& aSeg,
+                                                uint64_t aVolumeId,
+                                                const std::vector<std::array<uint, 3>>& aNumberOfCells);
+
+  /** Get the neighbours of all the cells of the readout, given by neighbours_ModuleThetaMerged.
+   *  The layers are 0 to aNumberOfCells.size() - 1, the modules 0 to aSeg.nModules() - 1 (cyclic).
+   *   @param[in] aSeg Reference to the segmentation object.
+   *   @param[in] aVolumeId ID of a volume of the readout, for the fields other than layer, module and theta.
+   *   @param[in] aNumberOfCells For each layer, as returned by numberOfCells().
+   *   @param[in] aDiagonal If diagonal neighbours should be included.
+   *   @param[in] aNumberOfThreads Number of threads, 0 for the number of hardware threads.
+   *   return Table of the neighbours of the cells of cells_ModuleThetaMerged().
+   */
+  dd4hep::DDSegmentation::CellNeighbourTable_k4geo
+  neighbourTable_ModuleThetaMerged(const dd4hep::DDSegmentation::FCCSWGridModuleThetaMerged_k4geo& aSeg,
+                                   uint64_t aVolumeId, const std::vector<std::array<uint, 3>>& aNumberOfCells,
+                                   bool aDiagonal = false, unsigned aNumberOfThreads = 0);
+
+  /** Get the crosstalk neighbours of all the cells of the readout and their crosstalk coefficients, given by
+   *  det::crosstalk::getNeighboursModuleThetaMerged.
+   *   @param[in] aSeg Reference to the segmentation object.
+   *   @param[in] aVolumeId ID of a volume of the readout, for the fields other than layer, module and theta.
+   *   @param[in] aNumberOfCells For each layer, as returned by numberOfCells().
+   *   @param[in] aNumberOfThreads Number of threads, 0 for the number of hardware threads.
+   *   @param[in] aXtalkCoefRadial radial crosstalk coefficient.
+   *   @param[in] aXtalkCoefTheta theta crosstalk coefficient.
+   *   @param[in] aXtalkCoefDiagonal diagonal crosstalk coefficient.
+   *   @param[in] aXtalkCoefTower crosstalk coefficient in the same theta tower.
+   *   return Table of the crosstalk neighbours of the cells of cells_ModuleThetaMerged(), weighted by the coefficients.
+   */
+  dd4hep::DDSegmentation::CellNeighbourTable_k4geo
+  crosstalkTable_ModuleThetaMerged(const dd4hep::DDSegmentation::FCCSWGridModuleThetaMerged_k4geo& aSeg,
+                                   uint64_t aVolumeId, const std::vector<std::array<uint, 3>>& aNumberOfCells,
+                                   unsigned aNumberOfThreads = 0, double aXtalkCoefRadial = 0.7e-2,
+                                   double aXtalkCoefTheta = 0.2e-2, double aXtalkCoefDiagonal = 0.04e-2,
+                                   double aXtalkCoefTower = 0.1e-2);
+} // namespace utils
+} // namespace det
+#endif /* DETECTORCOMMON_MODULETHETAMERGEDNEIGHBOURMAPS_H */
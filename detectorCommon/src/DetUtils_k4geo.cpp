@@ -17,6 +17,7 @@
 #endif
 
 #include <iostream>
+#include <stdexcept>
 
 #include <unordered_set>
 
@@ -81,7 +82,7 @@ namespace utils {
 
   std::vector<std::vector<int>> permutations(int K) {
     std::vector<std::vector<int>> indexes;
-    int N = pow(2, K); // number of permutations with repetition of 2 numbers (-1,1)
+    int N = 1 << K; // number of permutations with repetition of 2 numbers (-1,1)
     for (int i = 0; i < N; i++) {
       // permutation = binary representation of i
       std::vector<int> tmp;
@@ -90,7 +91,7 @@ namespace utils {
       // dec -> bin
       for (int j = 0; j < K; j++) {
         tmp[K - 1 - j] = -1 + 2 * (res % 2);
-        res = floor(res / 2);
+        res /= 2;
       }
       indexes.push_back(tmp);
     }
@@ -112,78 +113,101 @@ namespace utils {
                                    const std::vector<std::string>& aFieldNames,
                                    const std::vector<std::pair<int, int>>& aFieldExtremes, uint64_t aCellId,
                                    const std::vector<bool>& aFieldCyclic, bool aDiagonal) {
-    std::vector<uint64_t> neighbours;
-    dd4hep::DDSegmentation::CellID cID = aCellId;
+    const NeighbourStencil stencil(aDecoder, aFieldNames, aFieldExtremes, aFieldCyclic, aDiagonal);
+    std::vector<uint64_t> neighbours(stencil.maxNeighbours());
+    neighbours.resize(stencil.neighbours(aCellId, neighbours));
+    return neighbours;
+  }
+
+  NeighbourStencil::NeighbourStencil(const dd4hep::DDSegmentation::BitFieldCoder& aDecoder,
+                                     const std::vector<std::string>& aFieldNames,
+                                     const std::vector<std::pair<int, int>>& aFieldExtremes,
+                                     const std::vector<bool>& aFieldCyclic, bool aDiagonal)
+      : m_fieldExtremes(aFieldExtremes), m_fieldCyclic(aFieldNames.size(), false) {
+    if (aFieldNames.size() > kMaxFields || aFieldExtremes.size() < aFieldNames.size()) {
+      throw std::runtime_error("NeighbourStencil: at most 64 fields, each with its extremes, are supported");
+    }
+    m_fields.reserve(aFieldNames.size());
     for (uint itField = 0; itField < aFieldNames.size(); itField++) {
-      const auto& field = aFieldNames[itField];
-      // note: get(..) returns a FieldID i.e. a int64_t
-      // while CellID (used previously) is a uint64_t
-      // similarly, the second argument of set(..)
-      // is signed (FieldID) rather than unsigned (CellID)
-      int id = aDecoder.get(cID, field);
-      if (aFieldCyclic[itField]) {
-        aDecoder[field].set(cID, cyclicNeighbour(id - 1, aFieldExtremes[itField]));
-        neighbours.emplace_back(cID);
-        aDecoder[field].set(cID, cyclicNeighbour(id + 1, aFieldExtremes[itField]));
-        neighbours.emplace_back(cID);
-      } else {
-        if (id > aFieldExtremes[itField].first) {
-          aDecoder[field].set(cID, id - 1);
-          neighbours.emplace_back(cID);
-        }
-        if (id < aFieldExtremes[itField].second) {
-          aDecoder[field].set(cID, id + 1);
-          neighbours.emplace_back(cID);
-        }
+      m_fields.push_back(aDecoder[aFieldNames[itField]]);
+      m_fieldCyclic[itField] = itField < aFieldCyclic.size() && aFieldCyclic[itField];
+    }
+    // a pattern changes each of the fields of aIndexes by -1 or +1: 2 * nFields patterns of one field, or all the
+    // 3^nFields - 1 non-zero changes with the diagonals, in which each field changes 2 * 3^(nFields - 1) times
+    const std::size_t nFields = m_fields.size();
+    std::size_t nPatterns = 2 * nFields, nSteps = 2 * nFields;
+    if (aDiagonal && nFields > 0) {
+      for (std::size_t i = 1; i < nFields; i++)
+        nSteps *= 3;
+      nPatterns = 3 * nSteps / (2 * nFields) - 1;
+    }
+    m_patternMasks.reserve(nPatterns);
+    m_patternOffsets.reserve(nPatterns + 1);
+    m_steps.reserve(nSteps);
+    m_patternOffsets.push_back(0);
+    auto addPattern = [this](std::span<const uint> aIndexes, std::span<const int> aSteps) {
+      uint64_t mask = 0;
+      for (uint iField = 0; iField < aIndexes.size(); iField++) {
+        mask |= m_fields[aIndexes[iField]].mask();
+        m_steps.push_back({aIndexes[iField], aSteps[iField] > 0});
       }
-      aDecoder[field].set(cID, id);
+      m_patternMasks.push_back(mask);
+      m_patternOffsets.push_back(m_steps.size());
+    };
+    // same order as the loops of the original neighbours function: first each field alone, then the diagonals
+    const int decrease[1] = {-1}, increase[1] = {1};
+    for (uint itField = 0; itField < m_fields.size(); itField++) {
+      addPattern({&itField, 1}, decrease);
+      addPattern({&itField, 1}, increase);
     }
     if (aDiagonal) {
-      std::vector<int> fieldIds; // initial IDs
-      fieldIds.assign(aFieldNames.size(), 0);
-      // for each field get current Id
-      for (uint iField = 0; iField < aFieldNames.size(); iField++) {
-        const auto& field = aFieldNames[iField];
-        fieldIds[iField] = aDecoder.get(cID, field);
-      }
-      for (uint iLength = aFieldNames.size(); iLength > 1; iLength--) {
-        // get all combinations for a given length
-        const auto& indexes = combinations(aFieldNames.size(), iLength);
-        for (uint iComb = 0; iComb < indexes.size(); iComb++) {
-          // for current combination get all permutations of +- 1 operation on IDs
-          const auto& calculation = permutations(iLength);
-          // do the increase/decrease of bitfield
-          for (uint iCalc = 0; iCalc < calculation.size(); iCalc++) {
-            // set new Ids for each field combination
-            bool add = true;
-            for (uint iField = 0; iField < indexes[iComb].size(); iField++) {
-              if (aFieldCyclic[indexes[iComb][iField]]) {
-                aDecoder[aFieldNames[indexes[iComb][iField]]].set(
-                    cID, cyclicNeighbour(fieldIds[indexes[iComb][iField]] + calculation[iCalc][iField],
-                                         aFieldExtremes[indexes[iComb][iField]]));
-              } else if ((calculation[iCalc][iField] > 0 &&
-                          fieldIds[indexes[iComb][iField]] < aFieldExtremes[indexes[iComb][iField]].second) ||
-                         (calculation[iCalc][iField] < 0 &&
-                          fieldIds[indexes[iComb][iField]] > aFieldExtremes[indexes[iComb][iField]].first)) {
-                aDecoder[aFieldNames[indexes[iComb][iField]]].set(cID, fieldIds[indexes[iComb][iField]] +
-                                                                           calculation[iCalc][iField]);
-              } else {
-                add = false;
-              }
-            }
-            // add new cellId to neighbours (unless it's beyond extrema)
-            if (add) {
-              neighbours.emplace_back(cID);
-            }
-            // reset ids
-            for (uint iField = 0; iField < indexes[iComb].size(); iField++) {
-              aDecoder[aFieldNames[indexes[iComb][iField]]].set(cID, fieldIds[indexes[iComb][iField]]);
-            }
+      for (uint iLength = m_fields.size(); iLength > 1; iLength--) {
+        const auto& calculation = permutations(iLength);
+        for (const auto& indexes : combinations(m_fields.size(), iLength)) {
+          for (const auto& steps : calculation) {
+            addPattern(indexes, steps);
           }
         }
       }
     }
-    return neighbours;
+  }
+
+  std::size_t NeighbourStencil::neighbours(uint64_t aCellId, std::span<uint64_t> aNeighbours) const {
+    // bits of each field decreased ([0]) and increased ([1]) by one, if not beyond the extremes
+    uint64_t bits[kMaxFields][2];
+    bool valid[kMaxFields][2];
+    for (uint itField = 0; itField < m_fields.size(); itField++) {
+      const int id = m_fields[itField].value(aCellId);
+      for (int increase = 0; increase < 2; increase++) {
+        int neighbourId = id - 1 + 2 * increase;
+        if (m_fieldCyclic[itField]) {
+          neighbourId = cyclicNeighbour(neighbourId, m_fieldExtremes[itField]);
+          valid[itField][increase] = true;
+        } else {
+          valid[itField][increase] =
+              increase ? id < m_fieldExtremes[itField].second : id > m_fieldExtremes[itField].first;
+        }
+        bits[itField][increase] = 0;
+        if (valid[itField][increase]) {
+          m_fields[itField].set(bits[itField][increase], neighbourId);
+        }
+      }
+    }
+    std::size_t nNeighbours = 0;
+    for (std::size_t iPattern = 0; iPattern < m_patternMasks.size(); iPattern++) {
+      uint64_t cID = aCellId & ~m_patternMasks[iPattern];
+      bool add = true;
+      for (uint32_t iStep = m_patternOffsets[iPattern]; iStep < m_patternOffsets[iPattern + 1]; iStep++) {
+        const Step& step = m_steps[iStep];
+        add = add && valid[step.field][step.increase];
+        cID |= bits[step.field][step.increase];
+      }
+      // add new cellId to neighbours (unless it's beyond extrema)
+      if (add) {
+        aNeighbours[nNeighbours++] = cID;
+      }
+    }
+    return nNeighbours;
   }
 
   // use it for module-theta merged readout (FCCSWGridModuleThetaMerged_k4geo)
@@ -0,0 +1,142 @@
+//==========================================================================
+//
+// Neighbour and crosstalk maps of a module-theta merged readout
+//
+// Writes the neighbours (and optionally the crosstalk neighbours and
+// coefficients) of all the cells of a readout segmented with
+// FCCSWGridModuleThetaMerged_k4geo, e.g. the ALLEGRO ECal barrel, to
+// binary files that can be read back with CellNeighbourTable_k4geo
+//
+//==========================================================================
+
+#include "detectorCommon/DetUtils_k4geo.h"
+#include "detectorCommon/ModuleThetaMergedNeighbourMaps_k4geo.h"
+
+#include <DD4hep/Detector.h>
+#include <DD4hep/Factories.h>
+#include <DD4hep/Printout.h>
+#include <DD4hep/VolumeManager.h>
+
+#include <array>
+#include <chrono>
+#include <string>
+#include <vector>
+
+using dd4hep::PrintLevel;
+
+namespace {
+
+void usage() {
+  dd4hep::printout(PrintLevel::ALWAYS, "ModuleThetaMergedNeighbourMaps",
+                   "Usage: geoPluginRun -input <compact.xml> -plugin k4geo_ModuleThetaMergedNeighbourMaps \n"
+                   "         -readout <name>     readout with the FCCSWGridModuleThetaMerged_k4geo segmentation \n"
+                   "         [-output <prefix>]  files <prefix>_neighbours.bin and <prefix>_crosstalk.bin, \n"
+                   "                             by default the readout name \n"
+                   "         [-threads <n>]      number of threads, by default the number of hardware threads \n"
+                   "         [-diagonal]         include the diagonal neighbours \n"
+                   "         [-crosstalk]        also write the crosstalk neighbours and coefficients \n"
+                   "         [-xtalk <radial> <theta> <diagonal> <tower>]  crosstalk coefficients");
+}
+
+/** Plugin writing the neighbour and crosstalk maps of a module-theta merged readout
+ *
+ * The cells of each layer are the ones given by det::utils::numberOfCells for the volume of the layer, the
+ * neighbours are found with det::utils::neighbours_ModuleThetaMerged and the crosstalk neighbours with
+ * det::crosstalk::getNeighboursModuleThetaMerged, in parallel (see ModuleThetaMergedNeighbourMaps_k4geo.h)
+ */
+static long createNeighbourMaps(dd4hep::Detector& description, int argc, char** argv) {
+  const std::string LOG_SOURCE("ModuleThetaMergedNeighbourMaps");
+
+  std::string readoutName, output;
+  unsigned nThreads = 0;
+  bool diagonal = false, crosstalk = false;
+  double xtalkCoefs[4] = {0.7e-2, 0.2e-2, 0.04e-2, 0.1e-2};
+  for (int i = 0; i < argc; ++i) {
+    const std::string arg(argv[i]);
+    if (arg == "-readout" && i + 1 < argc) {
+      readoutName = argv[++i];
+    } else if (arg == "-output" && i + 1 < argc) {
+      output = argv[++i];
+    } else if (arg == "-threads" && i + 1 < argc) {
+      nThreads = std::stoul(argv[++i]);
+    } else if (arg == "-diagonal") {
+      diagonal = true;
+    } else if (arg == "-crosstalk") {
+      crosstalk = true;
+    } else if (arg == "-xtalk" && i + 4 < argc) {
+      for (auto& coef : xtalkCoefs)
+        coef = dd4hep::_toDouble(argv[++i]);
+    } else {
+      dd4hep::printout(PrintLevel::ERROR, LOG_SOURCE, "Unknown argument: %s", argv[i]);
+      usage();
+      return 0;
+    }
+  }
+  if (readoutName.empty()) {
+    usage();
+    return 0;
+  }
+  if (output.empty())
+    output = readoutName;
+
+  dd4hep::Readout readout = description.readout(readoutName);
+  const auto* segmentation = dynamic_cast<const dd4hep::DDSegmentation::FCCSWGridModuleThetaMerged_k4geo*>(
+      readout.segmentation().segmentation());
+  if (segmentation == nullptr) {
+    dd4hep::printout(PrintLevel::ERROR, LOG_SOURCE, "Readout %s is not segmented with FCCSWGridModuleThetaMerged_k4geo",
+                     readoutName.c_str());
+    return 0;
+  }
+  // the system ID is the one of the detector with this readout
+  int systemID = -1;
+  for (const auto& [name, handle] : description.sensitiveDetectors()) {
+    if (dd4hep::SensitiveDetector(handle).readout().name() == readoutName)
+      systemID = description.detector(name).id();
+  }
+  if (systemID < 0) {
+    dd4hep::printout(PrintLevel::ERROR, LOG_SOURCE, "No detector with readout %s", readoutName.c_str());
+    return 0;
+  }
+
+  // number of cells of each layer, from the volumes of the layers
+  dd4hep::VolumeManager::getVolumeManager(description);
+  const auto* decoder = segmentation->decoder();
+  dd4hep::VolumeID volumeId = 0;
+  decoder->set(volumeId, "system", systemID);
+  std::vector<std::array<uint, 3>> numberOfCells;
+  for (int layer = 0; layer < segmentation->nLayers(); layer++) {
+    decoder->set(volumeId, segmentation->fieldNameLayer(), layer);
+    numberOfCells.push_back(det::utils::numberOfCells(volumeId, *segmentation));
+    dd4hep::printout(PrintLevel::DEBUG, LOG_SOURCE, "layer %d: %u modules, %u theta cells from theta ID %u", layer,
+                     numberOfCells.back()[0], numberOfCells.back()[1], numberOfCells.back()[2]);
+  }
+  decoder->set(volumeId, segmentation->fieldNameLayer(), 0);
+
+  auto start = std::chrono::steady_clock::now();
+  const auto neighbours =
+      det::utils::neighbourTable_ModuleThetaMerged(*segmentation, volumeId, numberOfCells, diagonal, nThreads);
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  if (!neighbours.write(output + "_neighbours.bin"))
+    return 0;
+  dd4hep::printout(PrintLevel::INFO, LOG_SOURCE, "%zu cells, %zu neighbours in %.2f s, written to %s",
+                   neighbours.numberOfCells(), neighbours.numberOfNeighbours(), seconds,
+                   (output + "_neighbours.bin").c_str());
+
+  if (crosstalk) {
+    start = std::chrono::steady_clock::now();
+    const auto xtalkNeighbours =
+        det::utils::crosstalkTable_ModuleThetaMerged(*segmentation, volumeId, numberOfCells, nThreads, xtalkCoefs[0],
+                                                     xtalkCoefs[1], xtalkCoefs[2], xtalkCoefs[3]);
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (!xtalkNeighbours.write(output + "_crosstalk.bin"))
+      return 0;
+    dd4hep::printout(PrintLevel::INFO, LOG_SOURCE, "%zu cells, %zu crosstalk neighbours in %.2f s, written to %s",
+                     xtalkNeighbours.numberOfCells(), xtalkNeighbours.numberOfNeighbours(), seconds,
+                     (output + "_crosstalk.bin").c_str());
+  }
+  return 1;
+}
+
+} // namespace
+
+DECLARE_APPLY(k4geo_ModuleThetaMergedNeighbourMaps, ::createNeighbourMaps)
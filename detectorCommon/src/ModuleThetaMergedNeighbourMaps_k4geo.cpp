@@ -0,0 +1,161 @@
+#include "detectorCommon/ModuleThetaMergedNeighbourMaps_k4geo.h"
+
+#include "detectorCommon/DetUtils_k4geo.h"
+#include "detectorCommon/xtalk_neighbors_moduleThetaMergedSegmentation.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <thread>
+
+using dd4hep::DDSegmentation::CellNeighbourTable_k4geo;
+using dd4hep::DDSegmentation::FCCSWGridModuleThetaMerged_k4geo;
+
+namespace det {
+namespace utils {
+
+  namespace {
+    /// number of merged modules of a layer processed at once by a thread
+    constexpr uint kModulesPerTask = 32;
+
+    /// block of cells processed by a thread: all the theta cells of some modules of a layer
+    struct Task {
+      uint layer;
+      uint firstModule;
+      uint endModule;
+    };
+
+    std::vector<Task> makeTasks(const std::vector<std::array<uint, 3>>& aNumberOfCells) {
+      std::vector<Task> tasks;
+      for (uint layer = 0; layer < aNumberOfCells.size(); layer++) {
+        for (uint module = 0; module < aNumberOfCells[layer][0]; module += kModulesPerTask) {
+          tasks.push_back({layer, module, std::min(module + kModulesPerTask, aNumberOfCells[layer][0])});
+        }
+      }
+      return tasks;
+    }
+
+    std::vector<uint64_t> taskCells(const FCCSWGridModuleThetaMerged_k4geo& aSeg, uint64_t aVolumeId,
+                                    const std::vector<std::array<uint, 3>>& aNumberOfCells, const Task& aTask) {
+      const auto* decoder = aSeg.decoder();
+      const auto& [nModules, nThetaCells, minThetaID] = aNumberOfCells[aTask.layer];
+      std::vector<uint64_t> cells;
+      cells.reserve((aTask.endModule - aTask.firstModule) * nThetaCells);
+      dd4hep::DDSegmentation::CellID cID = aVolumeId;
+      decoder->set(cID, aSeg.fieldNameLayer(), aTask.layer);
+      for (uint module = aTask.firstModule; module < aTask.endModule; module++) {
+        decoder->set(cID, aSeg.fieldNameModule(), module * aSeg.mergedModules(aTask.layer));
+        for (uint theta = 0; theta < nThetaCells; theta++) {
+          decoder->set(cID, aSeg.fieldNameTheta(), minThetaID + theta * aSeg.mergedThetaCells(aTask.layer));
+          cells.push_back(cID);
+        }
+      }
+      return cells;
+    }
+
+    /// Minimal and maximal values of the layer, module and theta fields in each layer
+    std::vector<std::vector<std::pair<int, int>>>
+    fieldExtremes(const FCCSWGridModuleThetaMerged_k4geo& aSeg,
+                  const std::vector<std::array<uint, 3>>& aNumberOfCells) {
+      std::vector<std::vector<std::pair<int, int>>> extremes;
+      for (uint layer = 0; layer < aNumberOfCells.size(); layer++) {
+        const auto& [nModules, nThetaCells, minThetaID] = aNumberOfCells[layer];
+        const int maxThetaID = int(minThetaID) + (int(nThetaCells) - 1) * aSeg.mergedThetaCells(layer);
+        extremes.push_back(
+            {{0, int(aNumberOfCells.size()) - 1}, {0, aSeg.nModules() - 1}, {int(minThetaID), maxThetaID}});
+      }
+      return extremes;
+    }
+
+    /// Fill the table of each task with a pool of threads, then put them together in the order of the tasks
+    CellNeighbourTable_k4geo
+    runTasks(const std::vector<Task>& aTasks, unsigned aNumberOfThreads,
+             const std::function<void(const Task&, CellNeighbourTable_k4geo&)>& aFillTable) {
+      std::vector<CellNeighbourTable_k4geo> tables(aTasks.size());
+      std::atomic<std::size_t> nextTask{0};
+      std::exception_ptr exception;
+      std::atomic<bool> failed{false};
+      auto work = [&]() {
+        try {
+          for (std::size_t i = nextTask++; i < aTasks.size() && !failed; i = nextTask++)
+            aFillTable(aTasks[i], tables[i]);
+        } catch (...) {
+          if (!failed.exchange(true))
+            exception = std::current_exception();
+        }
+      };
+      unsigned nThreads = aNumberOfThreads > 0 ? aNumberOfThreads : std::thread::hardware_concurrency();
+      nThreads = std::max(1u, std::min<unsigned>(nThreads, aTasks.size()));
+      std::vector<std::thread> threads;
+      for (unsigned i = 1; i < nThreads; i++)
+        threads.emplace_back(work);
+      work();
+      for (auto& thread : threads)
+        thread.join();
+      if (exception)
+        std::rethrow_exception(exception);
+
+      CellNeighbourTable_k4geo table;
+      for (auto& part : tables) {
+        table.append(part);
+        part = CellNeighbourTable_k4geo();
+      }
+      return table;
+    }
+  } // namespace
+
+  std::vector<uint64_t> cells_ModuleThetaMerged(const FCCSWGridModuleThetaMerged_k4geo& aSeg, uint64_t aVolumeId,
+                                                const std::vector<std::array<uint, 3>>& aNumberOfCells) {
+    std::vector<uint64_t> cells;
+    for (const auto& task : makeTasks(aNumberOfCells)) {
+      const auto part = taskCells(aSeg, aVolumeId, aNumberOfCells, task);
+      cells.insert(cells.end(), part.begin(), part.end());
+    }
+    return cells;
+  }
+
+  CellNeighbourTable_k4geo neighbourTable_ModuleThetaMerged(const FCCSWGridModuleThetaMerged_k4geo& aSeg,
+                                                            uint64_t aVolumeId,
+                                                            const std::vector<std::array<uint, 3>>& aNumberOfCells,
+                                                            bool aDiagonal, unsigned aNumberOfThreads) {
+    const std::vector<std::string> fieldNames = {aSeg.fieldNameLayer(), aSeg.fieldNameModule(),
+                                                 aSeg.fieldNameTheta()};
+    const auto extremes = fieldExtremes(aSeg, aNumberOfCells);
+    return runTasks(makeTasks(aNumberOfCells), aNumberOfThreads,
+                    [&](const Task& aTask, CellNeighbourTable_k4geo& aTable) {
+                      aTable.build(taskCells(aSeg, aVolumeId, aNumberOfCells, aTask), [&](const uint64_t& cID) {
+                        auto cellNeighbours = neighbours_ModuleThetaMerged(
+                            aSeg, *aSeg.decoder(), fieldNames, extremes[aTask.layer], cID, aDiagonal);
+                        // neighbours_ModuleThetaMerged removes the duplicates with a hash set
+                        std::sort(cellNeighbours.begin(), cellNeighbours.end());
+                        return cellNeighbours;
+                      });
+                    });
+  }
+
+  CellNeighbourTable_k4geo crosstalkTable_ModuleThetaMerged(const FCCSWGridModuleThetaMerged_k4geo& aSeg,
+                                                            uint64_t aVolumeId,
+                                                            const std::vector<std::array<uint, 3>>& aNumberOfCells,
+                                                            unsigned aNumberOfThreads, double aXtalkCoefRadial,
+                                                            double aXtalkCoefTheta, double aXtalkCoefDiagonal,
+                                                            double aXtalkCoefTower) {
+    const std::vector<std::string> fieldNames = {aSeg.fieldNameLayer(), aSeg.fieldNameModule(),
+                                                 aSeg.fieldNameTheta()};
+    const auto extremes = fieldExtremes(aSeg, aNumberOfCells);
+    return runTasks(makeTasks(aNumberOfCells), aNumberOfThreads,
+                    [&](const Task& aTask, CellNeighbourTable_k4geo& aTable) {
+                      aTable.build(taskCells(aSeg, aVolumeId, aNumberOfCells, aTask), [&](const uint64_t& cID) {
+                        auto cellNeighbours = det::crosstalk::getNeighboursModuleThetaMerged(
+                            aSeg, *aSeg.decoder(), fieldNames, extremes, cID, aXtalkCoefRadial, aXtalkCoefTheta,
+                            aXtalkCoefDiagonal, aXtalkCoefTower);
+                        // the duplicates are already removed, keeping the first coefficient
+                        std::sort(cellNeighbours.begin(), cellNeighbours.end(),
+                                  [](const auto& a, const auto& b) { return a.first < b.first; });
+                        return cellNeighbours;
+                      });
+                    });
+  }
+
+} // namespace utils
+} // namespace det
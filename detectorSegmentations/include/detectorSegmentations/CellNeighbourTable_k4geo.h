@@ -0,0 +1,129 @@
+#ifndef DETECTORSEGMENTATIONS_CELLNEIGHBOURTABLE_K4GEO_H
+#define DETECTORSEGMENTATIONS_CELLNEIGHBOURTABLE_K4GEO_H
+
+#include "DDSegmentation/Segmentation.h"
+
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/** CellNeighbourTable_k4geo Detector/detectorSegmentations/detectorSegmentations/CellNeighbourTable_k4geo.h
+ * CellNeighbourTable_k4geo.h
+ *
+ *  Neighbours of all the cells of a readout, computed once with the neighbours function of the segmentation.
+ *  They are stored in compressed sparse row format: the neighbours of the i-th cell are the elements
+ *  m_offsets[i] to m_offsets[i + 1] - 1 of m_neighbours, and the position of each cell in the table is found
+ *  with a hash map, so that the neighbours of a cell are looked up in constant time and without allocation.
+ *  Optionally, each neighbour has a weight, e.g. the cross-talk coefficient between the two cells.
+ *  The table can be written to and read back from a binary file (in the byte order of the machine).
+ *
+ */
+
+namespace dd4hep {
+namespace DDSegmentation {
+  class CellNeighbourTable_k4geo {
+  public:
+    /// Neighbours of a cell, as a range in the table
+    class Range {
+    public:
+      Range() = default;
+      Range(const uint64_t* aBegin, const uint64_t* aEnd) : m_begin(aBegin), m_end(aEnd) {}
+      const uint64_t* begin() const { return m_begin; }
+      const uint64_t* end() const { return m_end; }
+      std::size_t size() const { return m_end - m_begin; }
+      bool empty() const { return m_begin == m_end; }
+
+    private:
+      const uint64_t* m_begin = nullptr;
+      const uint64_t* m_end = nullptr;
+    };
+
+    /// Function returning the neighbours of a cell
+    typedef std::function<std::vector<uint64_t>(const CellID&)> NeighbourFunction;
+    /// Function returning the neighbours of a cell and their weights
+    typedef std::function<std::vector<std::pair<uint64_t, double>>(const CellID&)> WeightedNeighbourFunction;
+
+    /// default constructor, empty table
+    CellNeighbourTable_k4geo() = default;
+
+    /**  Fill the table, replacing its content.
+     *   @param[in] aCells IDs of all the cells of the readout.
+     *   @param[in] aNeighbours function returning the neighbours of a cell, called once per cell.
+     */
+    void build(const std::vector<CellID>& aCells, const NeighbourFunction& aNeighbours);
+
+    /**  Fill the table with neighbours and their weights, replacing its content.
+     *   @param[in] aCells IDs of all the cells of the readout.
+     *   @param[in] aNeighbours function returning the neighbours of a cell and their weights, called once per cell.
+     */
+    void build(const std::vector<CellID>& aCells, const WeightedNeighbourFunction& aNeighbours);
+
+    /**  Add the cells of another table after the ones of this table, e.g. to fill a table in parts.
+     *   @param[in] aTable table with other cells, with weights if this one has weights (unless it is empty).
+     *   return False if a cell is in both tables or only one has weights, this table is then unchanged.
+     */
+    bool append(const CellNeighbourTable_k4geo& aTable);
+
+    /**  Get the neighbours of a cell.
+     *   @param[in] aCellId ID of a cell.
+     *   return Range of the neighbours, empty if the cell is not in the table (see contains()).
+     */
+    Range neighbours(const CellID& aCellID) const;
+
+    /**  Get the weights of the neighbours of a cell.
+     *   @param[in] aCellId ID of a cell.
+     *   return Weights in the order of neighbours(), empty if the table has no weights or does not contain the cell.
+     */
+    std::span<const double> weights(const CellID& aCellID) const;
+
+    /// True if the neighbours have weights
+    inline bool hasWeights() const { return m_hasWeights; }
+
+    /// True if the cell is in the table
+    inline bool contains(const CellID& aCellID) const { return m_index.count(aCellID) > 0; }
+
+    /// IDs of all the cells, in the order of the table
+    inline const std::vector<CellID>& cells() const { return m_cells; }
+
+    /// Number of cells in the table
+    inline std::size_t numberOfCells() const { return m_cells.size(); }
+
+    /// Total number of neighbours in the table
+    inline std::size_t numberOfNeighbours() const { return m_neighbours.size(); }
+
+    /**  Write the table to a binary file.
+     *   @param[in] aFileName name of the file.
+     *   return False if the file could not be written.
+     */
+    bool write(const std::string& aFileName) const;
+
+    /**  Read the table from a binary file written by write(), replacing its content.
+     *   @param[in] aFileName name of the file.
+     *   return False if the file could not be read, the table is then empty.
+     */
+    bool read(const std::string& aFileName);
+
+  private:
+    /// Fill the position of each cell in the table
+    void fillIndex();
+    /// Empty the table
+    void clear();
+
+    /// IDs of the cells
+    std::vector<CellID> m_cells;
+    /// start of the neighbours of each cell in m_neighbours, and their end for the last cell
+    std::vector<uint64_t> m_offsets = std::vector<uint64_t>(1, 0);
+    /// neighbours of all the cells
+    std::vector<uint64_t> m_neighbours;
+    /// weights of the neighbours, if any
+    std::vector<double> m_weights;
+    bool m_hasWeights = false;
+    /// position of each cell in m_cells
+    std::unordered_map<CellID, uint32_t> m_index;
+  };
+} // namespace DDSegmentation
+} // namespace dd4hep
+#endif /* DETECTORSEGMENTATIONS_CELLNEIGHBOURTABLE_K4GEO_H */
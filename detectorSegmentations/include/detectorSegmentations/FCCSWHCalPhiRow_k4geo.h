@@ -4,6 +4,10 @@
 #include "DDSegmentation/Segmentation.h"
 #include "DDSegmentation/SegmentationUtil.h"
 #include "TVector3.h"
+#include "detectorSegmentations/CellNeighbourTable_k4geo.h"
+
+#include <memory>
+#include <mutex>
 
 /** FCCSWHCalPhiRow_k4geo Detector/detectorSegmentations/detectorSegmentations/FCCSWHCalPhiRow_k4geo.h
  * FCCSWHCalPhiRow_k4geo.h
@@ -48,16 +52,45 @@ namespace DDSegmentation {
     /**  Find neighbours of the cell
      *   Definition of neighbours is explained on slide 7:
      * https://indico.cern.ch/event/1475808/contributions/6219554/attachments/2966253/5218774/FCC_FullSim_HCal_slides.pdf
+     *   They are taken from the neighbour table if one is set and contains the cell.
      *   @param[in] aCellId ID of a cell.
      *   return vector of neighbour cellIDs.
      */
     std::vector<uint64_t> neighbours(const CellID& cID) const;
 
-    /**  Calculate layer radii and edges in z-axis.
+    /**  Get the IDs of all the cells: all the cell indexes of each layer, in each phi bin.
+     *   The "type" field is set to zero for the Endcap as in cellID().
+     *   @param[in] aVolumeID ID of a volume of the readout, for the other fields (e.g. system).
+     *   return vector of cellIDs.
+     */
+    std::vector<uint64_t> cellIDs(const VolumeID& aVolumeID) const;
+
+    /**  Compute the neighbours of all the cells, to be stored to a file or used with setNeighbourTable().
+     *   @param[in] aVolumeID ID of a volume of the readout, for the other fields (e.g. system).
+     *   return the neighbour table.
+     */
+    std::shared_ptr<CellNeighbourTable_k4geo> makeNeighbourTable(const VolumeID& aVolumeID) const;
+
+    /**  Set the neighbour table used by neighbours() for the cells it contains, e.g. read from a file.
+     *   Not to be changed while the segmentation is in use.
+     *   @param[in] aTable the neighbour table, nullptr to compute the neighbours again.
+     */
+    inline void setNeighbourTable(std::shared_ptr<const CellNeighbourTable_k4geo> aTable) { m_neighbourTable = aTable; }
+
+    /**  Get the neighbour table used by neighbours().
+     *   return the neighbour table, nullptr if none is set.
+     */
+    inline const CellNeighbourTable_k4geo* neighbourTable() const { return m_neighbourTable.get(); }
+
+    /**  Calculate layer radii and edges in z-axis, then define cell indexes in each layer using defineCellIndexes().
      *    Following member variables are calculated:
      *      m_radii
      *      m_layerEdges
      *      m_layerDepth
+     *      m_cellIndexes (updated through defineCellIndexes())
+     *      m_cellEdges (updated through defineCellIndexes())
+     *    They are calculated once, by the first call from any thread (the other threads wait for it),
+     *    and are not modified afterwards, so that the segmentation can be used from several threads.
      */
     void calculateLayerRadii() const;
 
@@ -117,8 +150,7 @@ namespace DDSegmentation {
     /**  Get the vector of cell indexes in a given layer.
      */
     inline std::vector<int> cellIndexes(const uint layer) const {
-      if (m_radii.empty())
-        calculateLayerRadii();
+      calculateLayerRadii();
       if (!m_cellIndexes.empty())
         return m_cellIndexes[layer];
       else
@@ -254,6 +286,8 @@ namespace DDSegmentation {
     }
 
   protected:
+    /// z-min and z-max of a cell in a layer, (0, 0) if the layer has no such cell
+    const std::pair<double, double>& cellEdges(const uint layer, const int idx) const;
     /// the number of bins in phi
     int m_phiBins;
     /// the coordinate offset in phi
@@ -288,8 +322,18 @@ namespace DDSegmentation {
     mutable std::vector<double> m_layerDepth;
     /// cell indexes in each layer
     mutable std::vector<std::vector<int>> m_cellIndexes;
-    /// z-min and z-max of each cell in each layer
-    mutable std::vector<std::unordered_map<int, std::pair<double, double>>> m_cellEdges;
+    /// z-min and z-max of each cell in each layer, in the order of m_cellIndexes
+    mutable std::vector<std::vector<std::pair<double, double>>> m_cellEdges;
+    /// set once the layer radii and cells are calculated
+    mutable std::once_flag m_layersCalculated;
+    /// precomputed neighbours of the cells
+    std::shared_ptr<const CellNeighbourTable_k4geo> m_neighbourTable;
+
+  private:
+    /// Calculate the layer radii and cells, called once by calculateLayerRadii()
+    void fillLayerTables() const;
+    /// Calculate the neighbours of the cell, see neighbours()
+    std::vector<uint64_t> calculateNeighbours(const CellID& cID) const;
   };
 } // namespace DDSegmentation
 } // namespace dd4hep
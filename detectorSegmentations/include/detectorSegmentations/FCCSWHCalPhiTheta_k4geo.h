@@ -2,8 +2,12 @@
 #define DETECTORSEGMENTATIONS_HCALPHITHETA_K4GEO_H
 
 // FCCSW
+#include "detectorSegmentations/CellNeighbourTable_k4geo.h"
 #include "detectorSegmentations/GridTheta_k4geo.h"
 
+#include <memory>
+#include <mutex>
+
 /** FCCSWHCalPhiTheta_k4geo Detector/detectorSegmentations/detectorSegmentations/FCCSWHCalPhiTheta_k4geo.h
  * FCCSWHCalPhiTheta_k4geo.h
  *
@@ -46,12 +50,42 @@ namespace DDSegmentation {
     /**  Find neighbours of the cell.
      *   Definition of neighbours is explained on slide 9:
      * https://indico.cern.ch/event/1475808/contributions/6219554/attachments/2966253/5218774/FCC_FullSim_HCal_slides.pdf
+     *   They are taken from the neighbour table if one is set for aDiagonal and contains the cell.
      *   @param[in] aCellId ID of a cell.
      *   @param[in] aDiagonal if true, will include neighbours from diagonal positions in the next and previous layers.
      *   return vector of neighbour cellIDs.
      */
     std::vector<uint64_t> neighbours(const CellID& cID, bool aDiagonal) const;
 
+    /**  Get the IDs of all the cells: all the theta bins of each layer, in each phi bin.
+     *   The "row" field (and the "type" field for the Endcap) is set to zero as in cellID().
+     *   @param[in] aVolumeID ID of a volume of the readout, for the other fields (e.g. system).
+     *   return vector of cellIDs.
+     */
+    std::vector<uint64_t> cellIDs(const VolumeID& aVolumeID) const;
+
+    /**  Compute the neighbours of all the cells, to be stored to a file or used with setNeighbourTable().
+     *   @param[in] aVolumeID ID of a volume of the readout, for the other fields (e.g. system).
+     *   @param[in] aDiagonal if true, will include neighbours from diagonal positions in the next and previous layers.
+     *   return the neighbour table.
+     */
+    std::shared_ptr<CellNeighbourTable_k4geo> makeNeighbourTable(const VolumeID& aVolumeID, bool aDiagonal) const;
+
+    /**  Set the neighbour table used by neighbours(), e.g. read from a file. It is used for the cells it contains
+     *   if neighbours() is called with the same aDiagonal. Not to be changed while the segmentation is in use.
+     *   @param[in] aTable the neighbour table, nullptr to compute the neighbours again.
+     *   @param[in] aDiagonal whether the table includes the diagonal neighbours.
+     */
+    inline void setNeighbourTable(std::shared_ptr<const CellNeighbourTable_k4geo> aTable, bool aDiagonal) {
+      m_neighbourTable = aTable;
+      m_neighbourTableDiagonal = aDiagonal;
+    }
+
+    /**  Get the neighbour table used by neighbours().
+     *   return the neighbour table, nullptr if none is set.
+     */
+    inline const CellNeighbourTable_k4geo* neighbourTable() const { return m_neighbourTable.get(); }
+
     /**  Calculate layer radii and edges in z-axis, then define cell edges in each layer using defineCellEdges().
      *    Following member variables are calculated:
      *      m_radii
@@ -59,6 +93,8 @@ namespace DDSegmentation {
      *      m_layerDepth
      *      m_thetaBins (updated through defineCellEdges())
      *      m_cellEdges (updated through defineCellEdges())
+     *    They are calculated once, by the first call from any thread (the other threads wait for it),
+     *    and are not modified afterwards, so that the segmentation can be used from several threads.
      */
     void defineCellsInRZplan() const;
 
@@ -94,8 +130,7 @@ namespace DDSegmentation {
     /**  Get the vector of theta bins (cells) in a given layer.
      */
     inline std::vector<int> thetaBins(const uint layer) const {
-      if (m_radii.empty())
-        defineCellsInRZplan();
+      defineCellsInRZplan();
       if (!m_thetaBins.empty())
         return m_thetaBins[layer];
       else
@@ -210,6 +245,8 @@ namespace DDSegmentation {
   protected:
     /// determine the azimuthal angle phi based on the current cell ID
     double phi() const;
+    /// z-min and z-max of a cell (theta bin) in a layer, (0, 0) if the layer has no such cell
+    const std::pair<double, double>& cellEdges(const uint layer, const int bin) const;
     /// the number of bins in phi
     int m_phiBins;
     /// the coordinate offset in phi
@@ -238,8 +275,20 @@ namespace DDSegmentation {
     mutable std::vector<double> m_layerDepth;
     /// theta bins (cells) in each layer
     mutable std::vector<std::vector<int>> m_thetaBins;
-    /// z-min and z-max of each cell (theta bin) in each layer
-    mutable std::vector<std::unordered_map<int, std::pair<double, double>>> m_cellEdges;
+    /// z-min and z-max of each cell (theta bin) in each layer, in the order of m_thetaBins (decreasing z)
+    mutable std::vector<std::vector<std::pair<double, double>>> m_cellEdges;
+    /// set once the cells are defined in the R-z plan
+    mutable std::once_flag m_cellsDefined;
+    /// precomputed neighbours of the cells
+    std::shared_ptr<const CellNeighbourTable_k4geo> m_neighbourTable;
+    /// whether the neighbour table includes the diagonal neighbours
+    bool m_neighbourTableDiagonal = false;
+
+  private:
+    /// Calculate the cells in the R-z plan, called once by defineCellsInRZplan()
+    void calculateCellsInRZplan() const;
+    /// Calculate the neighbours of the cell, see neighbours()
+    std::vector<uint64_t> calculateNeighbours(const CellID& cID, bool aDiagonal) const;
   };
 } // namespace DDSegmentation
 } // namespace dd4hep
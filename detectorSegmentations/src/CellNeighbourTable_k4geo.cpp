@@ -0,0 +1,158 @@
+#include "detectorSegmentations/CellNeighbourTable_k4geo.h"
+#include "DD4hep/Printout.h"
+
+#include <cstring>
+#include <fstream>
+
+namespace dd4hep {
+namespace DDSegmentation {
+
+  namespace {
+    /// identifies the binary files of the neighbour tables, and their format version
+    const char kFileTag[8] = {'K', '4', 'G', 'N', 'B', 'R', 'S', '2'};
+
+    template <typename T>
+    void writeArray(std::ofstream& file, const std::vector<T>& array) {
+      file.write(reinterpret_cast<const char*>(array.data()), array.size() * sizeof(T));
+    }
+
+    template <typename T>
+    bool readArray(std::ifstream& file, std::vector<T>& array, uint64_t size) {
+      array.resize(size);
+      return bool(file.read(reinterpret_cast<char*>(array.data()), size * sizeof(T)));
+    }
+  } // namespace
+
+  void CellNeighbourTable_k4geo::build(const std::vector<CellID>& aCells, const NeighbourFunction& aNeighbours) {
+    clear();
+    m_cells = aCells;
+    m_offsets.reserve(m_cells.size() + 1);
+    for (const auto& cID : m_cells) {
+      const std::vector<uint64_t> cellNeighbours = aNeighbours(cID);
+      m_neighbours.insert(m_neighbours.end(), cellNeighbours.begin(), cellNeighbours.end());
+      m_offsets.push_back(m_neighbours.size());
+    }
+    fillIndex();
+  }
+
+  void CellNeighbourTable_k4geo::build(const std::vector<CellID>& aCells,
+                                       const WeightedNeighbourFunction& aNeighbours) {
+    clear();
+    m_hasWeights = true;
+    m_cells = aCells;
+    m_offsets.reserve(m_cells.size() + 1);
+    for (const auto& cID : m_cells) {
+      for (const auto& [neighbour, weight] : aNeighbours(cID)) {
+        m_neighbours.push_back(neighbour);
+        m_weights.push_back(weight);
+      }
+      m_offsets.push_back(m_neighbours.size());
+    }
+    fillIndex();
+  }
+
+  bool CellNeighbourTable_k4geo::append(const CellNeighbourTable_k4geo& aTable) {
+    bool ok = m_cells.empty() || aTable.m_cells.empty() || m_hasWeights == aTable.m_hasWeights;
+    for (std::size_t i = 0; ok && i < aTable.m_cells.size(); i++)
+      ok = !contains(aTable.m_cells[i]);
+    if (!ok) {
+      dd4hep::printout(dd4hep::ERROR, "CellNeighbourTable_k4geo",
+                       "Could not append a neighbour table with common cells or different weights");
+      return false;
+    }
+    if (m_cells.empty())
+      m_hasWeights = aTable.m_hasWeights;
+    const uint64_t shift = m_neighbours.size();
+    m_index.reserve(m_cells.size() + aTable.m_cells.size());
+    for (std::size_t i = 0; i < aTable.m_cells.size(); i++) {
+      m_index.emplace(aTable.m_cells[i], m_cells.size());
+      m_cells.push_back(aTable.m_cells[i]);
+      m_offsets.push_back(shift + aTable.m_offsets[i + 1]);
+    }
+    m_neighbours.insert(m_neighbours.end(), aTable.m_neighbours.begin(), aTable.m_neighbours.end());
+    m_weights.insert(m_weights.end(), aTable.m_weights.begin(), aTable.m_weights.end());
+    return true;
+  }
+
+  CellNeighbourTable_k4geo::Range CellNeighbourTable_k4geo::neighbours(const CellID& aCellID) const {
+    const auto it = m_index.find(aCellID);
+    if (it == m_index.end())
+      return Range();
+    return Range(m_neighbours.data() + m_offsets[it->second], m_neighbours.data() + m_offsets[it->second + 1]);
+  }
+
+  std::span<const double> CellNeighbourTable_k4geo::weights(const CellID& aCellID) const {
+    const auto it = m_index.find(aCellID);
+    if (!m_hasWeights || it == m_index.end())
+      return {};
+    return {m_weights.data() + m_offsets[it->second], m_weights.data() + m_offsets[it->second + 1]};
+  }
+
+  bool CellNeighbourTable_k4geo::write(const std::string& aFileName) const {
+    std::ofstream file(aFileName, std::ios::binary | std::ios::trunc);
+    const uint64_t sizes[3] = {m_cells.size(), m_neighbours.size(), m_hasWeights};
+    file.write(kFileTag, sizeof(kFileTag));
+    file.write(reinterpret_cast<const char*>(sizes), sizeof(sizes));
+    writeArray(file, m_cells);
+    writeArray(file, m_offsets);
+    writeArray(file, m_neighbours);
+    writeArray(file, m_weights);
+    if (!file) {
+      dd4hep::printout(dd4hep::ERROR, "CellNeighbourTable_k4geo", "Could not write the neighbour table to %s",
+                       aFileName.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  bool CellNeighbourTable_k4geo::read(const std::string& aFileName) {
+    clear();
+    std::ifstream file(aFileName, std::ios::binary);
+    char tag[sizeof(kFileTag)] = {};
+    uint64_t sizes[3] = {0, 0, 0};
+    bool ok = file.read(tag, sizeof(tag)) && std::memcmp(tag, kFileTag, sizeof(kFileTag)) == 0 &&
+              file.read(reinterpret_cast<char*>(sizes), sizeof(sizes));
+    // check the size of the file before allocating the arrays
+    if (ok) {
+      const auto start = file.tellg();
+      file.seekg(0, std::ios::end);
+      const uint64_t remaining = file.tellg() - start;
+      file.seekg(start);
+      m_hasWeights = sizes[2] == 1;
+      ok = sizes[0] < remaining && sizes[1] < remaining && sizes[2] <= 1 &&
+           remaining == (2 * sizes[0] + 1 + sizes[1]) * sizeof(uint64_t) + m_hasWeights * sizes[1] * sizeof(double);
+    }
+    ok = ok && readArray(file, m_cells, sizes[0]) && readArray(file, m_offsets, sizes[0] + 1) &&
+         readArray(file, m_neighbours, sizes[1]) && readArray(file, m_weights, m_hasWeights * sizes[1]) &&
+         m_offsets[0] == 0;
+    // the offsets must point into the neighbours
+    for (std::size_t i = 0; ok && i < m_cells.size(); i++)
+      ok = m_offsets[i] <= m_offsets[i + 1] && m_offsets[i + 1] <= m_neighbours.size();
+    if (!ok) {
+      dd4hep::printout(dd4hep::ERROR, "CellNeighbourTable_k4geo", "Could not read a neighbour table from %s",
+                       aFileName.c_str());
+      clear();
+      return false;
+    }
+    fillIndex();
+    return true;
+  }
+
+  void CellNeighbourTable_k4geo::fillIndex() {
+    m_index.clear();
+    m_index.reserve(m_cells.size());
+    for (uint32_t i = 0; i < m_cells.size(); i++)
+      m_index.emplace(m_cells[i], i);
+  }
+
+  void CellNeighbourTable_k4geo::clear() {
+    m_cells.clear();
+    m_offsets.assign(1, 0);
+    m_neighbours.clear();
+    m_weights.clear();
+    m_hasWeights = false;
+    m_index.clear();
+  }
+
+} // namespace DDSegmentation
+} // namespace dd4hep
@@ -53,8 +53,7 @@ namespace DDSegmentation {
   Vector3D FCCSWHCalPhiRow_k4geo::position(const CellID& cID) const {
     uint layer = _decoder->get(cID, m_layerID);
 
-    if (m_radii.empty())
-      calculateLayerRadii();
+    calculateLayerRadii();
     if (m_radii.empty() || m_layerEdges.empty()) {
       dd4hep::printout(dd4hep::ERROR, "FCCSWHCalPhiRow_k4geo", "Could not calculate layer radii!");
       return Vector3D(0., 0., 0.);
@@ -76,6 +75,10 @@ namespace DDSegmentation {
   }
 
   void FCCSWHCalPhiRow_k4geo::calculateLayerRadii() const {
+    std::call_once(m_layersCalculated, &FCCSWHCalPhiRow_k4geo::fillLayerTables, this);
+  }
+
+  void FCCSWHCalPhiRow_k4geo::fillLayerTables() const {
     if (m_radii.empty()) {
       // check if all necessary variables are available
       if (m_detLayout == -1 || m_offsetZ.empty() || m_widthZ.empty() || m_offsetR.empty() || m_numLayers.empty() ||
@@ -184,8 +187,8 @@ namespace DDSegmentation {
       while ((minLayerZ + (irow + 1) * m_dz_row) < (maxLayerZ + 0.0001)) {
         // define the cell index
         int idx = floor(irow / m_gridSizeRow[layer]) + 1;
-        // add the index if it is not already there
-        if (std::find(m_cellIndexes[layer].begin(), m_cellIndexes[layer].end(), idx) == m_cellIndexes[layer].end())
+        // add the index if it is not already there (the indexes only increase with the row)
+        if (m_cellIndexes[layer].empty() || m_cellIndexes[layer].back() != idx)
           m_cellIndexes[layer].push_back(idx);
         irow++;
       }
@@ -196,14 +199,14 @@ namespace DDSegmentation {
         while ((minLayerZ + (irow + 1) * m_dz_row) < (maxLayerZ + 0.0001)) {
           // define the cell index with negative sign
           int idx = -(floor(irow / m_gridSizeRow[layer]) + 1);
-          // add the index if it is not already there
-          if (std::find(m_cellIndexes[layer].begin(), m_cellIndexes[layer].end(), idx) == m_cellIndexes[layer].end())
+          // add the index if it is not already there (the indexes only decrease with the row)
+          if (m_cellIndexes[layer].empty() || m_cellIndexes[layer].back() != idx)
             m_cellIndexes[layer].push_back(idx);
           irow++;
         }
       }
 
-      // find edges of each cell in the given layer along z axis
+      // find edges of each cell in the given layer along z axis, in the order of m_cellIndexes
       for (auto idx : m_cellIndexes[layer]) {
         // calculate z-coordinates of the cell edges
         double z1 = minLayerZ + (idx - 1) * m_dz_row * m_gridSizeRow[layer]; // lower edge
@@ -215,7 +218,7 @@ namespace DDSegmentation {
           z2 = -minLayerZ + (idx + 1) * m_dz_row * m_gridSizeRow[layer]; // upper edge
         }
 
-        m_cellEdges[layer][idx] = std::make_pair(z1, z2);
+        m_cellEdges[layer].push_back(std::make_pair(z1, z2));
       }
 
       dd4hep::printout(dd4hep::DEBUG, "FCCSWHCalPhiRow_k4geo", "Number of cells in layer %d: %d", layer,
@@ -254,6 +257,15 @@ namespace DDSegmentation {
     return cID;
   }
 
+  /// z-min and z-max of a cell, the indexes of a layer being 1, 2, ..., N (then -1, -2, ..., -N for the Endcap)
+  const std::pair<double, double>& FCCSWHCalPhiRow_k4geo::cellEdges(const uint layer, const int idx) const {
+    static const std::pair<double, double> noCell(0., 0.);
+    const auto& edges = m_cellEdges[layer];
+    const std::size_t nPositive = m_detLayout == 1 ? edges.size() / 2 : edges.size();
+    const std::size_t i = idx > 0 ? idx - 1 : nPositive - idx - 1;
+    return idx == 0 || i >= edges.size() ? noCell : edges[i];
+  }
+
   /// determine the azimuthal angle phi based on the cell ID
   double FCCSWHCalPhiRow_k4geo::phi(const CellID& cID) const {
     CellID phiValue = _decoder->get(cID, m_phiID);
@@ -265,8 +277,7 @@ namespace DDSegmentation {
 
     std::vector<std::pair<uint, uint>> minMaxLayerId;
 
-    if (m_radii.empty())
-      calculateLayerRadii();
+    calculateLayerRadii();
     if (m_radii.empty())
       return minMaxLayerId;
 
@@ -294,12 +305,49 @@ namespace DDSegmentation {
     return minMaxLayerId;
   }
 
-  /// Calculates the neighbours of the given cell ID and adds them to the list of neighbours
+  /// Get the neighbours of the given cell ID from the neighbour table, or calculate them
   std::vector<uint64_t> FCCSWHCalPhiRow_k4geo::neighbours(const CellID& cID) const {
+    if (m_neighbourTable && m_neighbourTable->contains(cID)) {
+      const auto cellNeighbours = m_neighbourTable->neighbours(cID);
+      return std::vector<uint64_t>(cellNeighbours.begin(), cellNeighbours.end());
+    }
+    return calculateNeighbours(cID);
+  }
+
+  /// Get the IDs of all the cells
+  std::vector<uint64_t> FCCSWHCalPhiRow_k4geo::cellIDs(const VolumeID& aVolumeID) const {
+    std::vector<uint64_t> cells;
+
+    calculateLayerRadii();
+    CellID cID = aVolumeID;
+    if (m_detLayout == 1)
+      _decoder->set(cID, "type", 0);
+
+    for (uint layer = 0; layer < m_cellIndexes.size(); layer++) {
+      _decoder->set(cID, m_layerID, layer);
+      for (auto idx : m_cellIndexes[layer]) {
+        _decoder->set(cID, m_rowID, idx);
+        for (int phiBin = 0; phiBin < m_phiBins; phiBin++) {
+          _decoder->set(cID, m_phiID, phiBin);
+          cells.push_back(cID);
+        }
+      }
+    }
+    return cells;
+  }
+
+  /// Calculate the neighbours of all the cells
+  std::shared_ptr<CellNeighbourTable_k4geo> FCCSWHCalPhiRow_k4geo::makeNeighbourTable(const VolumeID& aVolumeID) const {
+    auto table = std::make_shared<CellNeighbourTable_k4geo>();
+    table->build(cellIDs(aVolumeID), [this](const CellID& cID) { return calculateNeighbours(cID); });
+    return table;
+  }
+
+  /// Calculates the neighbours of the given cell ID and adds them to the list of neighbours
+  std::vector<uint64_t> FCCSWHCalPhiRow_k4geo::calculateNeighbours(const CellID& cID) const {
     std::vector<uint64_t> cellNeighbours;
 
-    if (m_radii.empty())
-      calculateLayerRadii();
+    calculateLayerRadii();
     if (m_cellIndexes.empty())
       return cellNeighbours;
 
@@ -597,13 +645,12 @@ namespace DDSegmentation {
     // get the layer index
     uint layer = _decoder->get(cID, m_layerID);
 
-    if (m_radii.empty())
-      calculateLayerRadii();
+    calculateLayerRadii();
     if (m_cellEdges.empty())
       return cTheta;
 
-    double zlow = m_cellEdges[layer][idx].first;
-    double zhigh = m_cellEdges[layer][idx].second;
+    double zlow = cellEdges(layer, idx).first;
+    double zhigh = cellEdges(layer, idx).second;
 
     double Rmin = m_radii[layer] - 0.5 * m_layerDepth[layer];
     double Rmax = m_radii[layer] + 0.5 * m_layerDepth[layer];
@@ -628,8 +675,7 @@ namespace DDSegmentation {
     // get the first layerId in the Barrel or in the last part of the Endcap
     uint layer = minMaxLayerId[minMaxLayerId.size() - 1].first;
 
-    if (m_radii.empty())
-      calculateLayerRadii();
+    calculateLayerRadii();
     if (m_cellEdges.empty())
       return 0;
 
@@ -637,7 +683,7 @@ namespace DDSegmentation {
     int idx = abs(m_cellIndexes[layer].back());
 
     // get the z-coordinate of the right-hand edge of the last cell
-    double zhigh = m_cellEdges[layer][idx].second;
+    double zhigh = cellEdges(layer, idx).second;
 
     // get the inner radius of the first layer
     double Rmin = m_radii[layer] - 0.5 * m_layerDepth[layer];
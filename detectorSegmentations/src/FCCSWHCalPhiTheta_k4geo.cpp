@@ -1,6 +1,8 @@
 #include "detectorSegmentations/FCCSWHCalPhiTheta_k4geo.h"
 #include "DD4hep/Printout.h"
 
+#include <algorithm>
+
 namespace dd4hep {
 namespace DDSegmentation {
 
@@ -61,13 +63,12 @@ namespace DDSegmentation {
     double zpos = 0.;
     double radius = 1.0;
 
-    if (m_radii.empty())
-      defineCellsInRZplan();
+    defineCellsInRZplan();
     if (!m_radii.empty())
       radius = m_radii[layer];
     if (!m_cellEdges.empty())
-      zpos = m_cellEdges[layer][thetaID].first +
-             (m_cellEdges[layer][thetaID].second - m_cellEdges[layer][thetaID].first) * 0.5;
+      zpos = cellEdges(layer, thetaID).first +
+             (cellEdges(layer, thetaID).second - cellEdges(layer, thetaID).first) * 0.5;
 
     auto pos = positionFromRThetaPhi(radius, theta(cID), phi(cID));
 
@@ -76,6 +77,10 @@ namespace DDSegmentation {
   }
 
   void FCCSWHCalPhiTheta_k4geo::defineCellsInRZplan() const {
+    std::call_once(m_cellsDefined, &FCCSWHCalPhiTheta_k4geo::calculateCellsInRZplan, this);
+  }
+
+  void FCCSWHCalPhiTheta_k4geo::calculateCellsInRZplan() const {
     if (m_radii.empty()) {
       // check if all necessary variables are available
       if (m_detLayout == -1 || m_offsetZ.empty() || m_widthZ.empty() || m_offsetR.empty() || m_numLayers.empty() ||
@@ -172,10 +177,10 @@ namespace DDSegmentation {
         ibin++;
       }
 
-      // find edges of each cell (theta bin) in the given layer
+      // find edges of each cell (theta bin) in the given layer, in the order of m_thetaBins
       auto prevBin = m_thetaBins[layer][0];
       // set the upper edge of the first cell in the given layer (starting from positive z part)
-      m_cellEdges[layer][prevBin] = std::make_pair(0., m_layerEdges[layer].second);
+      m_cellEdges[layer].push_back(std::make_pair(0., m_layerEdges[layer].second));
       for (auto bin : m_thetaBins[layer]) {
         if (bin != prevBin) {
           double z1 = m_radii[layer] * std::cos(m_offsetTheta + bin * m_gridSizeTheta) /
@@ -183,14 +188,14 @@ namespace DDSegmentation {
           double z2 = m_radii[layer] * std::cos(m_offsetTheta + prevBin * m_gridSizeTheta) /
                       std::sin(m_offsetTheta + prevBin * m_gridSizeTheta);
           // set the lower edge of the prevBin cell
-          m_cellEdges[layer][prevBin].first = z1 + 0.5 * (z2 - z1);
+          m_cellEdges[layer].back().first = z1 + 0.5 * (z2 - z1);
           // set the upper edge of current bin cell
-          m_cellEdges[layer][bin] = std::make_pair(0., m_cellEdges[layer][prevBin].first);
+          m_cellEdges[layer].push_back(std::make_pair(0., m_cellEdges[layer].back().first));
           prevBin = bin;
         }
       }
       // set the lower edge of the last cell in the given layer
-      m_cellEdges[layer][prevBin].first = m_layerEdges[layer].first;
+      m_cellEdges[layer].back().first = m_layerEdges[layer].first;
 
       // for the EndCap, do it again but for negative z part
       if (m_detLayout == 1) {
@@ -210,7 +215,7 @@ namespace DDSegmentation {
         prevBin = thetaBins[0];
 
         // set the upper edge of the first cell in the given layer at negative z part
-        m_cellEdges[layer][prevBin] = std::make_pair(0., -m_layerEdges[layer].first);
+        m_cellEdges[layer].push_back(std::make_pair(0., -m_layerEdges[layer].first));
         for (auto bin : thetaBins) {
           if (bin != prevBin) {
             double z1 = m_radii[layer] * std::cos(m_offsetTheta + bin * m_gridSizeTheta) /
@@ -218,21 +223,21 @@ namespace DDSegmentation {
             double z2 = m_radii[layer] * std::cos(m_offsetTheta + prevBin * m_gridSizeTheta) /
                         std::sin(m_offsetTheta + prevBin * m_gridSizeTheta);
             // set the lower edge of the prevBin cell
-            m_cellEdges[layer][prevBin].first = z1 + 0.5 * (z2 - z1);
+            m_cellEdges[layer].back().first = z1 + 0.5 * (z2 - z1);
             // set the upper edge of current bin cell
-            m_cellEdges[layer][bin] = std::make_pair(0., m_cellEdges[layer][prevBin].first);
+            m_cellEdges[layer].push_back(std::make_pair(0., m_cellEdges[layer].back().first));
             prevBin = bin;
           }
         }
         // set the lower edge of the last cell in the given layer
-        m_cellEdges[layer][prevBin].first = (-m_layerEdges[layer].second);
+        m_cellEdges[layer].back().first = (-m_layerEdges[layer].second);
       } // negative-z endcap
 
       dd4hep::printout(dd4hep::DEBUG, "FCCSWHCalPhiTheta_k4geo", "Number of cells in layer %d: %d", layer,
                        m_thetaBins[layer].size());
-      for (auto bin : m_thetaBins[layer])
+      for (uint i = 0; i < m_thetaBins[layer].size(); i++)
         dd4hep::printout(dd4hep::DEBUG, "FCCSWHCalPhiTheta_k4geo", "Layer %d cell theta bin: %d, edges: %.2f - %.2f cm",
-                         layer, bin, m_cellEdges[layer][bin]);
+                         layer, m_thetaBins[layer][i], m_cellEdges[layer][i].first, m_cellEdges[layer][i].second);
     }
   }
 
@@ -257,21 +262,23 @@ namespace DDSegmentation {
     uint layer = _decoder->get(vID, m_layerID);
 
     // define cell boundaries in R-z plan
-    if (m_radii.empty())
-      defineCellsInRZplan();
+    defineCellsInRZplan();
 
     // check if the cells are defined for the given layer
     if (m_thetaBins[layer].empty())
       dd4hep::printout(dd4hep::ERROR, "FCCSWHCalPhiTheta_k4geo", "No cells are defined for layer %d", layer);
 
-    // find the cell (theta bin) corresponding to the hit and return the cellID
-    for (auto bin : m_thetaBins[layer]) {
-      double posz = globalPosition.z();
-      if (posz > m_cellEdges[layer][bin].first && posz < m_cellEdges[layer][bin].second) {
-        _decoder->set(cID, m_thetaID, bin);
-        _decoder->set(cID, m_phiID, positionToBin(lPhi, 2 * M_PI / (double)m_phiBins, m_offsetPhi));
-        return cID;
-      }
+    // find the cell (theta bin) corresponding to the hit and return the cellID:
+    // the cells are ordered by decreasing z, the candidate is the first one with the lower edge below the hit
+    const auto& edges = m_cellEdges[layer];
+    const double posz = globalPosition.z();
+    const auto cell = std::partition_point(edges.begin(), edges.end(), [posz](const std::pair<double, double>& edge) {
+      return edge.first >= posz;
+    });
+    if (cell != edges.end() && posz > cell->first && posz < cell->second) {
+      _decoder->set(cID, m_thetaID, m_thetaBins[layer][cell - edges.begin()]);
+      _decoder->set(cID, m_phiID, positionToBin(lPhi, 2 * M_PI / (double)m_phiBins, m_offsetPhi));
+      return cID;
     }
 
     dd4hep::printout(dd4hep::WARNING, "FCCSWHCalPhiTheta_k4geo", "The hit is outside the defined range of the layer %d",
@@ -282,6 +289,14 @@ namespace DDSegmentation {
     return cID;
   }
 
+  /// z-min and z-max of a cell, the theta bins of a layer being in increasing order
+  const std::pair<double, double>& FCCSWHCalPhiTheta_k4geo::cellEdges(const uint layer, const int bin) const {
+    static const std::pair<double, double> noCell(0., 0.);
+    const auto& bins = m_thetaBins[layer];
+    const auto it = std::lower_bound(bins.begin(), bins.end(), bin);
+    return it == bins.end() || *it != bin ? noCell : m_cellEdges[layer][it - bins.begin()];
+  }
+
   /// determine the azimuthal angle phi based on the cell ID
   double FCCSWHCalPhiTheta_k4geo::phi(const CellID& cID) const {
     CellID phiValue = _decoder->get(cID, m_phiID);
@@ -292,8 +307,7 @@ namespace DDSegmentation {
   std::vector<std::pair<uint, uint>> FCCSWHCalPhiTheta_k4geo::getMinMaxLayerId() const {
     std::vector<std::pair<uint, uint>> minMaxLayerId;
 
-    if (m_radii.empty())
-      defineCellsInRZplan();
+    defineCellsInRZplan();
     if (m_radii.empty())
       return minMaxLayerId;
 
@@ -321,12 +335,52 @@ namespace DDSegmentation {
     return minMaxLayerId;
   }
 
-  /// Calculates the neighbours of the given cell ID and adds them to the list of neighbours
+  /// Get the neighbours of the given cell ID from the neighbour table, or calculate them
   std::vector<uint64_t> FCCSWHCalPhiTheta_k4geo::neighbours(const CellID& cID, bool aDiagonal) const {
+    if (m_neighbourTable && aDiagonal == m_neighbourTableDiagonal && m_neighbourTable->contains(cID)) {
+      const auto cellNeighbours = m_neighbourTable->neighbours(cID);
+      return std::vector<uint64_t>(cellNeighbours.begin(), cellNeighbours.end());
+    }
+    return calculateNeighbours(cID, aDiagonal);
+  }
+
+  /// Get the IDs of all the cells
+  std::vector<uint64_t> FCCSWHCalPhiTheta_k4geo::cellIDs(const VolumeID& aVolumeID) const {
+    std::vector<uint64_t> cells;
+
+    defineCellsInRZplan();
+    CellID cID = aVolumeID;
+    _decoder->set(cID, "row", 0);
+    if (m_detLayout == 1)
+      _decoder->set(cID, "type", 0);
+
+    for (uint layer = 0; layer < m_thetaBins.size(); layer++) {
+      _decoder->set(cID, m_layerID, layer);
+      for (auto bin : m_thetaBins[layer]) {
+        _decoder->set(cID, m_thetaID, bin);
+        for (int phiBin = 0; phiBin < m_phiBins; phiBin++) {
+          _decoder->set(cID, m_phiID, phiBin);
+          cells.push_back(cID);
+        }
+      }
+    }
+    return cells;
+  }
+
+  /// Calculate the neighbours of all the cells
+  std::shared_ptr<CellNeighbourTable_k4geo> FCCSWHCalPhiTheta_k4geo::makeNeighbourTable(const VolumeID& aVolumeID,
+                                                                                       bool aDiagonal) const {
+    auto table = std::make_shared<CellNeighbourTable_k4geo>();
+    table->build(cellIDs(aVolumeID),
+                 [this, aDiagonal](const CellID& cID) { return calculateNeighbours(cID, aDiagonal); });
+    return table;
+  }
+
+  /// Calculates the neighbours of the given cell ID and adds them to the list of neighbours
+  std::vector<uint64_t> FCCSWHCalPhiTheta_k4geo::calculateNeighbours(const CellID& cID, bool aDiagonal) const {
     std::vector<uint64_t> cellNeighbours;
 
-    if (m_radii.empty())
-      defineCellsInRZplan();
+    defineCellsInRZplan();
     if (m_thetaBins.empty())
       return cellNeighbours;
 
@@ -407,8 +461,8 @@ namespace DDSegmentation {
 
     // deal with the Barrel
     if (m_detLayout == 0) {
-      double currentCellZmin = m_cellEdges[currentLayerId][currentCellThetaBin].first;
-      double currentCellZmax = m_cellEdges[currentLayerId][currentCellThetaBin].second;
+      double currentCellZmin = cellEdges(currentLayerId, currentCellThetaBin).first;
+      double currentCellZmax = cellEdges(currentLayerId, currentCellThetaBin).second;
 
       // if this is not the first layer then look for neighbours in the previous layer
       if (currentLayerId > minLayerId) {
@@ -428,7 +482,7 @@ namespace DDSegmentation {
           if (aDiagonal && currentCellThetaBin > (m_thetaBins[prevLayerId].front() + 1)) {
             // add the previous layer cell from the prev to prev theta bin if it overlaps with the current cell in
             // z-coordinate
-            double zmin = m_cellEdges[prevLayerId][currentCellThetaBin - 2].first;
+            double zmin = cellEdges(prevLayerId, currentCellThetaBin - 2).first;
             if (zmin <= currentCellZmax) {
               // add the previous layer cell from the prev to prev theta bin
               _decoder->set(nID, m_thetaID, currentCellThetaBin - 2);
@@ -444,7 +498,7 @@ namespace DDSegmentation {
           if (aDiagonal && currentCellThetaBin < (m_thetaBins[prevLayerId].back() - 1)) {
             // add the previous layer cell from the next to next theta bin if it overlaps with the current cell in
             // z-coordinate
-            double zmax = m_cellEdges[prevLayerId][currentCellThetaBin + 2].second;
+            double zmax = cellEdges(prevLayerId, currentCellThetaBin + 2).second;
             if (zmax >= currentCellZmin) {
               // add the previous layer cell from the next to next theta bin
               _decoder->set(nID, m_thetaID, currentCellThetaBin + 2);
@@ -473,7 +527,7 @@ namespace DDSegmentation {
           if (aDiagonal) {
             // add the next layer cell from the next-to-next theta bin if it overlaps with the current cell in
             // z-coordinate
-            double zmax = m_cellEdges[nextLayerId][currentCellThetaBin + 2].second;
+            double zmax = cellEdges(nextLayerId, currentCellThetaBin + 2).second;
             if (zmax >= currentCellZmin) {
               // add the next layer cell from the next to next theta bin
               _decoder->set(nID, m_thetaID, currentCellThetaBin + 2);
@@ -490,7 +544,7 @@ namespace DDSegmentation {
           if (aDiagonal) {
             // add the next layer cell from the prev to prev theta bin if it overlaps with the current cell in
             // z-coordinate
-            double zmin = m_cellEdges[nextLayerId][currentCellThetaBin - 2].first;
+            double zmin = cellEdges(nextLayerId, currentCellThetaBin - 2).first;
             if (zmin <= currentCellZmax) {
               // add the next layer cell from the prev to prev theta bin
               _decoder->set(nID, m_thetaID, currentCellThetaBin - 2);
@@ -503,8 +557,8 @@ namespace DDSegmentation {
 
     // Endcap
     if (m_detLayout == 1) {
-      double currentCellZmin = m_cellEdges[currentLayerId][currentCellThetaBin].first;
-      double currentCellZmax = m_cellEdges[currentLayerId][currentCellThetaBin].second;
+      double currentCellZmin = cellEdges(currentLayerId, currentCellThetaBin).first;
+      double currentCellZmax = cellEdges(currentLayerId, currentCellThetaBin).second;
 
       // if this is not the first layer then look for neighbours in the previous layer
       if (currentLayerId > minLayerId) {
@@ -512,9 +566,10 @@ namespace DDSegmentation {
         int prevLayerId = currentLayerId - 1;
         _decoder->set(nID, m_layerID, prevLayerId);
         // find the ones that share at least part of a border with the current cell
-        for (auto bin : m_thetaBins[prevLayerId]) {
-          double zmin = m_cellEdges[prevLayerId][bin].first;
-          double zmax = m_cellEdges[prevLayerId][bin].second;
+        for (uint i = 0; i < m_thetaBins[prevLayerId].size(); i++) {
+          int bin = m_thetaBins[prevLayerId][i];
+          double zmin = m_cellEdges[prevLayerId][i].first;
+          double zmax = m_cellEdges[prevLayerId][i].second;
 
           // if the cID is in the positive-z side
           if (theta(cID) < M_PI / 2.) {
@@ -550,9 +605,10 @@ namespace DDSegmentation {
         int nextLayerId = currentLayerId + 1;
         _decoder->set(nID, m_layerID, nextLayerId);
         // find the ones that share at least part of a border with the current cell
-        for (auto bin : m_thetaBins[nextLayerId]) {
-          double zmin = m_cellEdges[nextLayerId][bin].first;
-          double zmax = m_cellEdges[nextLayerId][bin].second;
+        for (uint i = 0; i < m_thetaBins[nextLayerId].size(); i++) {
+          int bin = m_thetaBins[nextLayerId][i];
+          double zmin = m_cellEdges[nextLayerId][i].first;
+          double zmax = m_cellEdges[nextLayerId][i].second;
           // if the cID is in the positive-z side
           if (theta(cID) < M_PI / 2.) {
             if ((zmin >= currentCellZmin && zmin <= currentCellZmax) ||
@@ -742,13 +798,12 @@ namespace DDSegmentation {
     // get the layer index
     uint layer = _decoder->get(cID, m_layerID);
 
-    if (m_radii.empty())
-      defineCellsInRZplan();
+    defineCellsInRZplan();
     if (m_cellEdges.empty())
       return cTheta;
 
-    double zlow = m_cellEdges[layer][idx].first;
-    double zhigh = m_cellEdges[layer][idx].second;
+    double zlow = cellEdges(layer, idx).first;
+    double zhigh = cellEdges(layer, idx).second;
 
     double Rmin = m_radii[layer] - 0.5 * m_layerDepth[layer];
     double Rmax = m_radii[layer] + 0.5 * m_layerDepth[layer];
@@ -457,6 +457,13 @@ def Geant4Output2EDM4hep_DRC_plugin(dd4hepSimulation):
     evt_root.Control = True
     output = dd4hepSimulation.outputFile
     evt_root.Output = output
+    # store the DRC time series from their first to their last non-empty bin only. The run summary gives the
+    # output file size and the time spent writing the frames, to compare with the dense time series
+    # evt_root.SparseTimeSeries = True
+    # write the frames in a dedicated thread in MT mode, with up to WriterQueueSize frames queued. The run
+    # summary gives the events/s and the time spent writing the frames, to compare both modes per number of threads
+    # evt_root.WriterThread = True
+    # evt_root.WriterQueueSize = 16
     evt_root.enableUI()
     Kernel().eventAction().add(evt_root)
     return None
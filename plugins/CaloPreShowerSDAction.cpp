@@ -1,6 +1,8 @@
 #include "DD4hep/Version.h"
 #include "DDG4/Geant4SensDetAction.inl"
 
+#include "Geant4HitLookup.h"
+
 #if DD4HEP_VERSION_GE(1, 21)
 #define GEANT4_CONST_STEP const
 #else
@@ -88,23 +90,23 @@ namespace sim {
     Geant4HitCollection* coll = (layer == m_userData._firstLayerNumber ? collection(m_userData._preShowerCollectionID)
                                                                        : collection(m_collectionID));
 
-    Hit* hit = coll->find<Hit>(CellIDCompare<Hit>(cell));
-    if (h.totalEnergy() < std::numeric_limits<double>::epsilon()) {
+    if (h.totalEnergy() < std::numeric_limits<double>::epsilon())
       return true;
-    } else if (!hit) {
+
+    Hit* hit = findOrCreateHit<Hit>(coll, cell, [&]() {
       Geant4TouchableHandler handler(step);
       DDSegmentation::Vector3D pos = m_segmentation.position(cell);
       Position global = h.localToGlobal(pos);
-      hit = new Hit(global);
-      hit->cellID = cell;
-      coll->add(hit);
+      Hit* newHit = new Hit(global);
+      newHit->cellID = cell;
       printM2("%s> CREATE hit with deposit:%e MeV  Pos:%8.2f %8.2f %8.2f  %s", c_name(), contrib.deposit, pos.X, pos.Y,
               pos.Z, handler.path().c_str());
-      if (0 == hit->cellID) { // for debugging only!
-        hit->cellID = cellID(step);
+      if (0 == newHit->cellID) { // for debugging only!
+        newHit->cellID = cellID(step);
         except("+++ Invalid CELL ID for hit!");
       }
-    }
+      return newHit;
+    });
     hit->truth.push_back(contrib);
     hit->energyDeposit += contrib.deposit;
     mark(step);
@@ -0,0 +1,86 @@
+#ifndef DRCaloBinning_h
+#define DRCaloBinning_h 1
+
+#include <CLHEP/Units/PhysicalConstants.h>
+#include <CLHEP/Units/SystemOfUnits.h>
+#include <G4Types.hh>
+
+#include <vector>
+
+/// Namespace for the AIDA detector description toolkit
+namespace dd4hep {
+
+/// Namespace for the Geant4 based simulation part of the AIDA detector description toolkit
+namespace sim {
+
+  /*
+   *  Wavelength and time binning of the optical photons counted by the dual-readout calorimeter SiPMs
+   *
+   *  Bin 0 is the underflow and fWavBin + 1 (fTimeBin + 1) the overflow. The bin edges are computed
+   *  once, with the same single precision arithmetic as the edges of the former linear scans. A bin
+   *  is guessed from the uniform wavelength (time) step-size and corrected against the edges, so it
+   *  is identical to the bin of the scans.
+   */
+  struct DRCaloBinning {
+  public:
+    G4int fWavBin;
+    G4int fTimeBin;
+    G4float fWavlenStart;
+    G4float fWavlenEnd;
+    G4float fTimeStart;
+    G4float fTimeEnd;
+    G4float fWavlenStep;
+    G4float fTimeStep;
+
+    std::vector<G4double> fEnergyEdges; // photon energy at the wavelength edges, from fWavlenStart down to fWavlenEnd
+    std::vector<G4double> fTimeEdges;   // time edges, from fTimeStart up to fTimeEnd
+
+  public:
+    DRCaloBinning(G4int wavBin, G4int timeBin, G4float wavlenStart, G4float wavlenEnd, G4float timeStart,
+                  G4float timeEnd)
+        : fWavBin(wavBin), fTimeBin(timeBin), fWavlenStart(wavlenStart), fWavlenEnd(wavlenEnd), fTimeStart(timeStart),
+          fTimeEnd(timeEnd) {
+      fWavlenStep = (fWavlenStart - fWavlenEnd) / (float)fWavBin;
+      fTimeStep = (fTimeEnd - fTimeStart) / (float)fTimeBin;
+
+      fEnergyEdges.resize(fWavBin + 1);
+      for (int i = 0; i < fWavBin + 1; i++)
+        fEnergyEdges[i] = wavToE((fWavlenStart - static_cast<float>(i) * fWavlenStep) * CLHEP::nm);
+      fTimeEdges.resize(fTimeBin + 1);
+      for (int i = 0; i < fTimeBin + 1; i++)
+        fTimeEdges[i] = (fTimeStart + static_cast<float>(i) * fTimeStep) * CLHEP::ns;
+    }
+
+    G4double wavToE(G4double wav) const { return CLHEP::h_Planck * CLHEP::c_light / wav; }
+
+    /// Wavelength bin of a photon of energy en, 0 for the shortest and fWavBin + 1 for the longest wavelengths
+    int findWavBin(G4double en) const {
+      // guess from the wavelength of the photon, then move to the first energy edge above en
+      const double u = (fWavlenStart - wavToE(en) / CLHEP::nm) / fWavlenStep;
+      int i = u > 0. ? (u < fWavBin ? int(u) + 1 : fWavBin + 1) : 0;
+      while (i > 0 && en < fEnergyEdges[i - 1])
+        i--;
+      while (i < fWavBin + 1 && not(en < fEnergyEdges[i]))
+        i++;
+
+      return fWavBin + 1 - i;
+    }
+
+    /// Time bin of stepTime, 0 before fTimeStart and fTimeBin + 1 after fTimeEnd
+    int findTimeBin(G4double stepTime) const {
+      // guess from the uniform step-size, then move to the first edge above stepTime
+      const double u = (stepTime / CLHEP::ns - fTimeStart) / fTimeStep;
+      int i = u > 0. ? (u < fTimeBin ? int(u) + 1 : fTimeBin + 1) : 0;
+      while (i > 0 && stepTime < fTimeEdges[i - 1])
+        i--;
+      while (i < fTimeBin + 1 && not(stepTime < fTimeEdges[i]))
+        i++;
+
+      return i;
+    }
+  }; // struct DRCaloBinning
+
+} // namespace sim
+} // namespace dd4hep
+
+#endif // DRCaloBinning_h
@@ -13,6 +13,8 @@
 #include <G4ProcessManager.hh>
 #include <G4Tubs.hh>
 
+#include "Geant4OpticalProcessLookup.h"
+
 struct FastFiberData {
 public:
   FastFiberData(G4int id, G4double en, G4double globTime, G4double path, G4ThreeVector pos, G4ThreeVector mom,
@@ -270,24 +272,11 @@ public:
   }
 
   void setPostStepProc(const G4Track* track) {
-    G4ProcessManager* pm = track->GetDefinition()->GetProcessManager();
-    auto postStepProcessVector = pm->GetPostStepProcessVector();
-
-    for (unsigned int np = 0; np < postStepProcessVector->entries(); np++) {
-      auto theProcess = (*postStepProcessVector)[np];
-
-      auto theType = theProcess->GetProcessType();
+    const G4ParticleDefinition* particle = track->GetDefinition();
 
-      if (theType != fOptical)
-        continue;
-
-      if (theProcess->GetProcessSubType() == G4OpProcessSubType::fOpBoundary)
-        pOpBoundaryProc = dynamic_cast<G4OpBoundaryProcess*>(theProcess);
-      else if (theProcess->GetProcessSubType() == G4OpProcessSubType::fOpAbsorption)
-        pOpAbsorption = dynamic_cast<G4OpAbsorption*>(theProcess);
-      else if (theProcess->GetProcessSubType() == G4OpProcessSubType::fOpWLS)
-        pOpWLS = dynamic_cast<G4OpWLS*>(theProcess);
-    }
+    pOpBoundaryProc = dd4hep::sim::findOpBoundaryProcess(particle);
+    pOpAbsorption = dd4hep::sim::findOpticalProcess<G4OpAbsorption>(particle, fOpAbsorption);
+    pOpWLS = dd4hep::sim::findOpticalProcess<G4OpWLS>(particle, fOpWLS);
 
     fProcAssigned = true;
 
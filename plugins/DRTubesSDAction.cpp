@@ -28,6 +28,9 @@
 
 // Includers from project files
 #include "DRTubesSglHpr.hh"
+#include "DRTubesVolID.hh"
+#include "Geant4HitLookup.h"
+#include "Geant4OpticalProcessLookup.h"
 
 // #define DRTubesSDDebug
 
@@ -40,6 +43,15 @@ namespace sim {
     DRTubesSDData() = default;
     ~DRTubesSDData() = default;
 
+    // Methods
+    //
+  public:
+    // The optical boundary process of this worker thread, looked up once per run
+    // instead of scanning the optical photon processes at each step
+    void beginRun(const G4Run* /*run*/) {
+      opBoundaryProcess = findOpBoundaryProcess(G4OpticalPhoton::Definition());
+    }
+
     // Fields
     //
   public:
@@ -49,6 +61,10 @@ namespace sim {
     int collection_scin_left;
     int collection_drbt_cher;
     int collection_drbt_scin;
+    // VolumeID composition for the endcap and barrel fibers, the descriptors are parsed once
+    DRTubesVolID endcapVolID{"system:5,stave:10,tower:6,air:1,col:16,row:16,clad:1,core:1,cherenkov:1"};
+    DRTubesVolID barrelVolID{"system:5,stave:10,tower:-8,air:6,col:-16,row:16,clad:1,core:1,cherenkov:1"};
+    G4OpBoundaryProcess* opBoundaryProcess = nullptr;
   };
 } // namespace sim
 } // namespace dd4hep
@@ -61,6 +77,7 @@ namespace sim {
   template <>
   void Geant4SensitiveAction<DRTubesSDData>::initialize() {
     m_userData.sensitive = this;
+    runAction().callAtBegin(&m_userData, &DRTubesSDData::beginRun);
   }
 
   // Function template specialization of Geant4SensitiveAction class.
@@ -164,16 +181,8 @@ namespace sim {
       auto TowerID = static_cast<unsigned int>(aStep->GetPreStepPoint()->GetTouchable()->GetCopyNumber(3));
       auto StaveID = static_cast<unsigned int>(aStep->GetPreStepPoint()->GetTouchable()->GetCopyNumber(4));
 
-      BitFieldCoder bc("system:5,stave:10,tower:6,air:1,col:16,row:16,clad:1,core:1,cherenkov:1");
-      bc.set(VolID, "system", 25); // this number is set in DectDimensions_IDEA_o2_v01.xml
-      bc.set(VolID, "stave", StaveID);
-      bc.set(VolID, "tower", TowerID);
-      bc.set(VolID, "air", 0);
-      bc.set(VolID, "col", ColumnID);
-      bc.set(VolID, "row", RowID);
-      bc.set(VolID, "clad", 1);
-      bc.set(VolID, "core", CoreID);
-      bc.set(VolID, "cherenkov", CherenkovID);
+      // system 25 is set in DectDimensions_IDEA_o2_v01.xml
+      VolID = m_userData.endcapVolID.Compose(25, StaveID, TowerID, 0, ColumnID, RowID, 1, CoreID, CherenkovID);
 
       /* If you want to compare the 64-bits VolID created here
        * with the original DD4hep volumeID:
@@ -183,7 +192,8 @@ namespace sim {
        * in the steering file (instead of using RegexSD)
        * 3. Uncomment the code below */
       // clang-format off
-    /*std::cout<<"Volume id, created "<<VolID<<" and DD4hep original "<<volumeID(aStep)<<std::endl;
+    /*BitFieldCoder bc("system:5,stave:10,tower:6,air:1,col:16,row:16,clad:1,core:1,cherenkov:1");
+    std::cout<<"Volume id, created "<<VolID<<" and DD4hep original "<<volumeID(aStep)<<std::endl;
     std::cout<<"system id, created "<<25<<" and DD4hep original "<<bc.get(volumeID(aStep),"system")<<std::endl;
     std::cout<<"stave id, created "<<StaveID<<" and DD4hep original "<<bc.get(volumeID(aStep),"stave")<<std::endl;
     std::cout<<"tower id, created "<<TowerID<<" and DD4hep original "<<bc.get(volumeID(aStep),"tower")<<std::endl;
@@ -212,16 +222,8 @@ namespace sim {
       auto TowerID = static_cast<int>(aStep->GetPreStepPoint()->GetTouchable()->GetCopyNumber(4));
       auto StaveID = static_cast<unsigned int>(aStep->GetPreStepPoint()->GetTouchable()->GetCopyNumber(5));
 
-      BitFieldCoder bcbarrel("system:5,stave:10,tower:-8,air:6,col:-16,row:16,clad:1,core:1,cherenkov:1");
-      bcbarrel.set(VolID, "system", 28); // this number is set in DectDimensions_IDEA_o2_v01.xml
-      bcbarrel.set(VolID, "stave", StaveID);
-      bcbarrel.set(VolID, "tower", TowerID);
-      bcbarrel.set(VolID, "air", 63);
-      bcbarrel.set(VolID, "col", ColumnID);
-      bcbarrel.set(VolID, "row", RowID);
-      bcbarrel.set(VolID, "clad", 1);
-      bcbarrel.set(VolID, "core", CoreID);
-      bcbarrel.set(VolID, "cherenkov", CherenkovID);
+      // system 28 is set in DectDimensions_IDEA_o2_v01.xml
+      VolID = m_userData.barrelVolID.Compose(28, StaveID, TowerID, 63, ColumnID, RowID, 1, CoreID, CherenkovID);
 
       /* If you want to compare the 64-bits VolID created here
        * with the original DD4hep volumeID:
@@ -231,7 +233,8 @@ namespace sim {
        * in the steering file (instead of using RegexSD)
        * 3. Uncomment the code below */
       // clang-format off
-    /*std::cout<<"Volume id, created "<<VolID<<" and DD4hep original "<<volumeID(aStep)<<std::endl;
+    /*BitFieldCoder bcbarrel("system:5,stave:10,tower:-8,air:6,col:-16,row:16,clad:1,core:1,cherenkov:1");
+    std::cout<<"Volume id, created "<<VolID<<" and DD4hep original "<<volumeID(aStep)<<std::endl;
     std::cout<<"system id, created "<<28<<" and DD4hep original "<<bcbarrel.get(volumeID(aStep),"system")<<std::endl;
     std::cout<<"stave id, created "<<StaveID<<" and DD4hep original "<<bcbarrel.get(volumeID(aStep),"stave")<<std::endl;
     std::cout<<"tower id, created "<<TowerID<<" and DD4hep original "<<bcbarrel.get(volumeID(aStep),"tower")<<std::endl;
@@ -265,28 +268,15 @@ namespace sim {
       // calculate the signal in terms of Cherenkov photo-electrons
       if (aStep->GetTrack()->GetParticleDefinition() == G4OpticalPhoton::Definition()) {
         G4OpBoundaryProcessStatus theStatus = Undefined;
-        G4ProcessManager* OpManager = G4OpticalPhoton::OpticalPhoton()->GetProcessManager();
-
-        if (OpManager) {
-          G4int MAXofPostStepLoops = OpManager->GetPostStepProcessVector()->entries();
-          G4ProcessVector* fPostStepDoItVector = OpManager->GetPostStepProcessVector(typeDoIt);
-
-          for (G4int i = 0; i < MAXofPostStepLoops; i++) {
-            G4VProcess* fCurrentProcess = (*fPostStepDoItVector)[i];
-            G4OpBoundaryProcess* fOpProcess = dynamic_cast<G4OpBoundaryProcess*>(fCurrentProcess);
-            if (fOpProcess) {
-              theStatus = fOpProcess->GetStatus();
-              break;
-            }
-          }
-        }
+        if (m_userData.opBoundaryProcess)
+          theStatus = m_userData.opBoundaryProcess->GetStatus();
 
         switch (theStatus) {
         case TotalInternalReflection: {
           // Kill Cherenkov photons inside fibers travelling towards the inner tip
-          if (!DRTubesSglHpr::IsReflectedForward(aStep))
+          G4double distance_to_sipm = 0.;
+          if (!DRTubesSglHpr::IsReflectedForward(aStep, distance_to_sipm))
             return true;
-          G4double distance_to_sipm = DRTubesSglHpr::GetDistanceToSiPM(aStep);
           G4int c_signal = DRTubesSglHpr::SmearCSignal();
           signalhit = DRTubesSglHpr::AttenuateCSignal(c_signal, distance_to_sipm);
           if (signalhit == 0)
@@ -307,7 +297,7 @@ namespace sim {
     // We are going to create an hit per each fiber with a signal above 0
     // Each fiber is identified with a unique volID
     //
-    Geant4Calorimeter::Hit* hit = coll->findByKey<Geant4Calorimeter::Hit>(VolID); // the hit
+    Geant4Calorimeter::Hit* hit = findHit<Geant4Calorimeter::Hit>(coll, VolID); // the hit
     if (!hit) { // if the hit does not exist yet, create it
       hit = new Geant4Calorimeter::Hit();
       hit->cellID = VolID; // this should be assigned only once
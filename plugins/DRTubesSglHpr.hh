@@ -14,10 +14,14 @@
 // Includers from Geant4
 //
 #include "G4Tubs.hh"
+#include "Randomize.hh"
 #include "globals.hh"
 
+#include "CLHEP/Random/RandBinomial.h"
 #include "CLHEP/Units/SystemOfUnits.h"
 
+#include <unordered_map>
+
 class DRTubesSglHpr {
 public:
   DRTubesSglHpr() = delete;
@@ -28,6 +32,10 @@ private:
   static constexpr G4double fk_B = 0.126; // Birks constant
   static constexpr G4double fSAttenuationLength = 1000.0 * CLHEP::m;
   static constexpr G4double fCAttenuationLength = 1000.0 * CLHEP::m;
+  // Up to this number of photons survival is drawn photon by photon
+  static constexpr G4int fMaxPerPhotonDraws = 2;
+  // Below this mean number of lost photons the binomial is sampled by inversion
+  static constexpr G4double fMaxInversionLoss = 10.;
 
 public:
   // Methods
@@ -58,11 +66,22 @@ public:
   // poissonian light fluctuations.
   static G4int SmearCSignal() { return G4Poisson(0.177); }
 
+  // Half length of the fiber (G4Tubs) logical volume
+  //
+  // The solid is cast once per logical volume and thread, the last volume
+  // seen is checked first as consecutive steps are mostly in the same fiber.
+  // The geometry must not be rebuilt while the cache is in use.
+  inline static G4double GetFiberHalfLength(const G4LogicalVolume* volume);
+
   // Calculate distance from step in fiber to SiPM
   inline static G4double GetDistanceToSiPM(const G4Step* step, bool prestep);
   static G4double GetDistanceToSiPM(const G4Step* step) { return GetDistanceToSiPM(step, true); }
 
   // Calculate how many photons survived after light attenuation
+  //
+  // The survivors are binomially distributed, sampled with one random number instead of
+  // one per photon (except for a few photons). An attenuation length of DBL_MAX (or a
+  // distance of 0) disables the attenuation, without drawing any random number.
   inline static G4int AttenuateHelper(const G4int& signal, const G4double& distance,
                                       const G4double& attenuation_length);
 
@@ -77,27 +96,47 @@ public:
 
   inline static G4ThreeVector CalculateFiberPosition(const G4Step* step);
 
-  // Check if photon is travelling towards SiPM
-  inline static bool IsReflectedForward(const G4Step* step);
+  // Check if photon is travelling towards SiPM, the pre-step distance to the SiPM
+  // is returned in PreStepDistance
+  inline static bool IsReflectedForward(const G4Step* step, G4double& PreStepDistance);
+  static bool IsReflectedForward(const G4Step* step) {
+    G4double PreStepDistance;
+    return IsReflectedForward(step, PreStepDistance);
+  }
 
   // Print step info for debugging purposes
   inline static void PrintStepInfo(const G4Step* aStep);
 };
 
+inline G4double DRTubesSglHpr::GetFiberHalfLength(const G4LogicalVolume* volume) {
+  thread_local const G4LogicalVolume* lastVolume = nullptr;
+  thread_local G4double lastHalfLength = 0.;
+  if (volume == lastVolume)
+    return lastHalfLength;
+
+  thread_local std::unordered_map<const G4LogicalVolume*, G4double> halfLengths;
+  auto it = halfLengths.find(volume);
+  if (it == halfLengths.end()) {
+    // Get the solid associated with the logical volume
+    G4Tubs* solid = dynamic_cast<G4Tubs*>(volume->GetSolid());
+    it = halfLengths.emplace(volume, solid->GetZHalfLength()).first;
+  }
+  lastVolume = volume;
+  lastHalfLength = it->second;
+  return lastHalfLength;
+}
+
 inline G4double DRTubesSglHpr::GetDistanceToSiPM(const G4Step* step, bool prestep) {
   // Get the pre-step point
   const G4StepPoint* StepPoint = prestep ? step->GetPreStepPoint() : step->GetPostStepPoint();
+  const G4VTouchable* touchable = StepPoint->GetTouchable();
   // Get the global position of the step point
   G4ThreeVector globalPos = StepPoint->GetPosition();
   // Get the local position of the step point in the current volume's coordinate system
-  G4ThreeVector localPos = StepPoint->GetTouchableHandle()->GetHistory()->GetTopTransform().TransformPoint(globalPos);
+  G4ThreeVector localPos = touchable->GetHistory()->GetTopTransform().TransformPoint(globalPos);
 
-  // Get the logical volume of the current step
-  G4LogicalVolume* currentVolume = StepPoint->GetTouchableHandle()->GetVolume()->GetLogicalVolume();
-  // Get the solid associated with the logical volume
-  G4Tubs* solid = dynamic_cast<G4Tubs*>(currentVolume->GetSolid());
   // Get the dimensions of the solid (size of the volume)
-  G4double size = solid->GetZHalfLength();
+  G4double size = GetFiberHalfLength(touchable->GetVolume()->GetLogicalVolume());
 
   G4double distance_to_sipm = size - localPos.z();
   return distance_to_sipm;
@@ -107,28 +146,53 @@ inline G4int DRTubesSglHpr::AttenuateHelper(const G4int& signal, const G4double&
                                             const G4double& attenuation_length) {
   double probability_of_survival = exp(-distance / attenuation_length);
 
-  G4int survived_photons = 0;
-  for (int i = 0; i < signal; i++) {
-    // Simulate drawing between 0 and 1 with probability x of getting 1
-    if (G4UniformRand() <= probability_of_survival)
-      survived_photons++;
+  if (signal <= 0)
+    return 0;
+  // Survival is certain, as in a draw per photon
+  if (probability_of_survival >= 1.)
+    return signal;
+
+  // A few photons, typically the single Cherenkov photo-electron: one draw per photon is the cheapest
+  if (signal <= fMaxPerPhotonDraws) {
+    G4int survived_photons = 0;
+    for (int i = 0; i < signal; i++) {
+      // Simulate drawing between 0 and 1 with probability x of getting 1
+      if (G4UniformRand() <= probability_of_survival)
+        survived_photons++;
+    }
+    return survived_photons;
+  }
+
+  // Few lost photons on average (the usual case, the fibers are much shorter than the attenuation
+  // length): invert the cumulative distribution of the number of lost photons, starting from 0
+  const double probability_of_loss = 1. - probability_of_survival;
+  if (signal * probability_of_loss < fMaxInversionLoss) {
+    const double ratio = probability_of_loss / probability_of_survival;
+    double probability = exp(-signal * distance / attenuation_length); // no photon lost
+    double rand = G4UniformRand();
+    G4int lost_photons = 0;
+    while (rand > probability && lost_photons < signal) {
+      rand -= probability;
+      probability *= ratio * (signal - lost_photons) / (lost_photons + 1);
+      lost_photons++;
+    }
+    return signal - lost_photons;
   }
-  return survived_photons;
+
+  return static_cast<G4int>(CLHEP::RandBinomial::shoot(G4Random::getTheEngine(), signal, probability_of_survival));
 }
 
 inline G4ThreeVector DRTubesSglHpr::CalculateFiberPosition(const G4Step* step) {
-  G4TouchableHandle theTouchable = step->GetPreStepPoint()->GetTouchableHandle();
+  const G4VTouchable* theTouchable = step->GetPreStepPoint()->GetTouchable();
   G4ThreeVector origin(0., 0., 0.);
   G4ThreeVector zdir(0., 0., 1.);
-  G4ThreeVector vectPos = theTouchable->GetHistory()->GetTopTransform().Inverse().TransformPoint(origin);
-  G4ThreeVector direction = theTouchable->GetHistory()->GetTopTransform().Inverse().TransformAxis(zdir);
+  // The local to global transform, inverted once for the position and the axis
+  const G4AffineTransform localToGlobal = theTouchable->GetHistory()->GetTopTransform().Inverse();
+  G4ThreeVector vectPos = localToGlobal.TransformPoint(origin);
+  G4ThreeVector direction = localToGlobal.TransformAxis(zdir);
 
-  // Get the logical volume of the current step
-  G4LogicalVolume* currentVolume = step->GetPreStepPoint()->GetTouchableHandle()->GetVolume()->GetLogicalVolume();
-  // Get the solid associated with the logical volume
-  G4Tubs* solid = dynamic_cast<G4Tubs*>(currentVolume->GetSolid());
   // Get the dimensions of the solid (size of the volume)
-  G4double size = solid->GetZHalfLength();
+  G4double size = GetFiberHalfLength(theTouchable->GetVolume()->GetLogicalVolume());
   G4double lengthfiber = size * 2.;
   G4ThreeVector Halffibervect = direction * lengthfiber / 2;
   // Fibre tip position
@@ -144,9 +208,20 @@ inline G4ThreeVector DRTubesSglHpr::CalculateFiberPosition(const G4Step* step) {
 // it might travel towards the SiPM or the inner finer tip.
 // As we do not consider reflections at the inner fiber tip
 // photons travelling backwards should be killed.
-inline bool DRTubesSglHpr::IsReflectedForward(const G4Step* step) {
-  double PreStepDistance = GetDistanceToSiPM(step, true);
-  double PostStepDistance = GetDistanceToSiPM(step, false);
+inline bool DRTubesSglHpr::IsReflectedForward(const G4Step* step, G4double& PreStepDistance) {
+  const G4VTouchable* PreTouchable = step->GetPreStepPoint()->GetTouchable();
+  const G4VTouchable* PostTouchable = step->GetPostStepPoint()->GetTouchable();
+  // Fast path for a step ending in the same fiber: the touchable is shared by both
+  // step points, its transform and half length are looked up once
+  if (PreTouchable != PostTouchable) {
+    PreStepDistance = GetDistanceToSiPM(step, true);
+    double PostStepDistance = GetDistanceToSiPM(step, false);
+    return PostStepDistance < PreStepDistance;
+  }
+  const G4AffineTransform& GlobalToLocal = PreTouchable->GetHistory()->GetTopTransform();
+  G4double size = GetFiberHalfLength(PreTouchable->GetVolume()->GetLogicalVolume());
+  PreStepDistance = size - GlobalToLocal.TransformPoint(step->GetPreStepPoint()->GetPosition()).z();
+  double PostStepDistance = size - GlobalToLocal.TransformPoint(step->GetPostStepPoint()->GetPosition()).z();
   bool IsReflectedForward = (PostStepDistance < PreStepDistance) ? true : false;
   return IsReflectedForward;
 }
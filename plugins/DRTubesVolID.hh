@@ -0,0 +1,56 @@
+//**************************************************************************
+// \file DRTubesVolID.hh
+// \brief:  definition of DRTubesVolID class
+// \start date: 16 October 2026
+//**************************************************************************
+
+// Header-only utility class to compose the 64-bits VolumeIDs of the
+// DREndcapTubes and DRBarrelTubes fibers in the DRTubesSDAction
+
+#ifndef DRTubesVolID_h
+#define DRTubesVolID_h 1
+
+// Includers from DD4HEP
+//
+#include "DDSegmentation/BitFieldCoder.h"
+
+#include <string>
+
+class DRTubesVolID {
+public:
+  // The descriptor is parsed once, the fields are composed with the
+  // shifts and masks of its BitFieldElements. The descriptor must have
+  // the fields system, stave, tower, air, col, row, clad, core and cherenkov
+  explicit DRTubesVolID(const std::string& descriptor) {
+    const dd4hep::DDSegmentation::BitFieldCoder coder(descriptor);
+    const char* names[kNFields] = {"system", "stave", "tower", "air", "col", "row", "clad", "core", "cherenkov"};
+    for (int i = 0; i < kNFields; i++) {
+      const dd4hep::DDSegmentation::BitFieldElement& element = coder[names[i]];
+      fOffsets[i] = element.offset();
+      fMasks[i] = element.mask();
+    }
+  }
+
+  // Same VolumeID as setting the fields one by one with the BitFieldCoder
+  // of the descriptor, for values in the range of their field
+  dd4hep::DDSegmentation::CellID Compose(long long system, long long stave, long long tower, long long air,
+                                         long long col, long long row, long long clad, long long core,
+                                         long long cherenkov) const {
+    const long long values[kNFields] = {system, stave, tower, air, col, row, clad, core, cherenkov};
+    dd4hep::DDSegmentation::CellID VolID = 0;
+    for (int i = 0; i < kNFields; i++)
+      VolID |= (static_cast<dd4hep::DDSegmentation::CellID>(values[i]) << fOffsets[i]) & fMasks[i];
+    return VolID;
+  }
+
+private:
+  // Fields
+  //
+  static constexpr int kNFields = 9;
+  unsigned fOffsets[kNFields];
+  dd4hep::DDSegmentation::CellID fMasks[kNFields];
+};
+
+#endif // DRTubesVolID_h
+
+//**************************************************************************
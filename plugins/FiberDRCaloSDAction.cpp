@@ -7,8 +7,10 @@
 #include "G4OpticalPhoton.hh"
 // k4geo Framework include files
 
+#include "DRCaloBinning.h"
 #include "DRCaloFastSimModel.h"
 #include "FiberDRCaloSDAction.h"
+#include "Geant4HitLookup.h"
 
 // Geant4 include files
 #include "G4HCofThisEvent.hh"
@@ -44,47 +46,14 @@ namespace sim {
    *  \ingroup DD4HEP_SIMULATION
    */
 
-  struct DRCData {
+  struct DRCData : public DRCaloBinning {
   public:
     bool skipScint = true;
+    bool denseHistograms = false; // count the photons of the hits in contiguous arrays instead of maps
     DRCFiberModel fastfiber;
 
-    G4int fWavBin;
-    G4int fTimeBin;
-    G4float fWavlenStart;
-    G4float fWavlenEnd;
-    G4float fTimeStart;
-    G4float fTimeEnd;
-    G4float fWavlenStep;
-    G4float fTimeStep;
-
   public:
-    G4double wavToE(G4double wav) const { return CLHEP::h_Planck * CLHEP::c_light / wav; }
-
-    int findWavBin(G4double en) const {
-      int i = 0;
-      for (; i < fWavBin + 1; i++) {
-        if (en < wavToE((fWavlenStart - static_cast<float>(i) * fWavlenStep) * CLHEP::nm))
-          break;
-      }
-
-      return fWavBin + 1 - i;
-    }
-
-    int findTimeBin(G4double stepTime) const {
-      int i = 0;
-      for (; i < fTimeBin + 1; i++) {
-        if (stepTime < ((fTimeStart + static_cast<float>(i) * fTimeStep) * CLHEP::ns))
-          break;
-      }
-
-      return i;
-    }
-
-    DRCData() : fWavBin(120), fTimeBin(650), fWavlenStart(900.), fWavlenEnd(300.), fTimeStart(5.), fTimeEnd(70.) {
-      fWavlenStep = (fWavlenStart - fWavlenEnd) / (float)fWavBin;
-      fTimeStep = (fTimeEnd - fTimeStart) / (float)fTimeBin;
-    }
+    DRCData() : DRCaloBinning(120, 650, 900., 300., 5., 70.) {}
   }; // struct DRCData
 
   template <>
@@ -92,6 +61,7 @@ namespace sim {
                                                         Detector& desc)
       : Geant4Sensitive(ctxt, nam, det, desc), m_collectionName(), m_collectionID(0) {
     declareProperty("skipScint", m_userData.skipScint = true);
+    declareProperty("DenseHistograms", m_userData.denseHistograms = false);
     declareProperty("ReadoutName", m_readoutName);
     declareProperty("CollectionName", m_collectionName);
     initialize();
@@ -226,20 +196,19 @@ namespace sim {
         G4double energy = step->GetTrack()->GetTotalEnergy();
 
         // default hit (optical photon count)
-        Geant4DRCalorimeter::Hit* drHit =
-            coll->find<Geant4DRCalorimeter::Hit>(CellIDCompare<Geant4DRCalorimeter::Hit>(cID));
-
-        if (!drHit) {
-          drHit = new Geant4DRCalorimeter::Hit(m_userData.fWavlenStep, m_userData.fTimeStep);
-          drHit->cellID = cID;
-          drHit->position = m_segmentation->position(cID) * CLHEP::mm / dd4hep::mm; // segmentation gives dd4hep unit
-          drHit->SetSiPMnum(cID);
-          drHit->SetTimeStart(m_userData.fTimeStart);
-          drHit->SetTimeEnd(m_userData.fTimeEnd);
-          drHit->SetWavlenMax(m_userData.fWavlenStart);
-          drHit->SetWavlenMin(m_userData.fWavlenEnd);
-          coll->add(cID, drHit);
-        }
+        Geant4DRCalorimeter::Hit* drHit = findOrCreateHit<Geant4DRCalorimeter::Hit>(coll, cID, [&]() {
+          auto* newHit = new Geant4DRCalorimeter::Hit(m_userData.fWavlenStep, m_userData.fTimeStep);
+          newHit->cellID = cID;
+          newHit->position = m_segmentation->position(cID) * CLHEP::mm / dd4hep::mm; // segmentation gives dd4hep unit
+          newHit->SetSiPMnum(cID);
+          newHit->SetTimeStart(m_userData.fTimeStart);
+          newHit->SetTimeEnd(m_userData.fTimeEnd);
+          newHit->SetWavlenMax(m_userData.fWavlenStart);
+          newHit->SetWavlenMin(m_userData.fWavlenEnd);
+          if (m_userData.denseHistograms)
+            newHit->UseDenseHistograms(m_userData.fWavBin, m_userData.fTimeBin);
+          return newHit;
+        });
 
         // everything should be in the G4 unit
         // (approximate) timing at the end of the fiber
@@ -268,17 +237,14 @@ namespace sim {
 
         // copy-paste of the dd4hep scintillation calorimeter SD
         Geant4HitCollection* coll_scint = collection(m_collectionID + 1);
-        Geant4Calorimeter::Hit* caloHit =
-            coll_scint->find<Geant4Calorimeter::Hit>(CellIDCompare<Geant4Calorimeter::Hit>(cID));
+        Geant4Calorimeter::Hit* caloHit = findOrCreateHit<Geant4Calorimeter::Hit>(coll_scint, cID, [&]() {
+          auto* newHit = new Geant4Calorimeter::Hit(glob);
+          newHit->cellID = cID;
+          newHit->position = m_segmentation->position(cID) * CLHEP::mm / dd4hep::mm; // segmentation gives dd4hep unit
+          return newHit;
+        });
         HitContribution contrib = Geant4Calorimeter::Hit::extractContribution(step, true);
 
-        if (!caloHit) {
-          caloHit = new Geant4Calorimeter::Hit(glob);
-          caloHit->cellID = cID;
-          caloHit->position = m_segmentation->position(cID) * CLHEP::mm / dd4hep::mm; // segmentation gives dd4hep unit
-          coll_scint->add(cID, caloHit);
-        }
-
         caloHit->truth.emplace_back(contrib);
         caloHit->energyDeposit += contrib.deposit;
 
@@ -311,22 +277,23 @@ namespace sim {
                             global.z() * dd4hep::millimeter / CLHEP::millimeter);
 
       auto cID = m_segmentation->cellID(loc, glob, volID); // This returns cID corresponding to SiPM Wafer
-      Hit* hit = coll->find<Hit>(CellIDCompare<Hit>(cID));
 
       G4double hitTime = step->GetPostStepPoint()->GetGlobalTime();
       G4double energy = step->GetTrack()->GetTotalEnergy();
 
-      if (!hit) {
-        hit = new Geant4DRCalorimeter::Hit(m_userData.fWavlenStep, m_userData.fTimeStep);
-        hit->cellID = cID;
-        hit->position = m_segmentation->position(cID) * CLHEP::mm / dd4hep::mm; // segmentation gives dd4hep unit
-        hit->SetSiPMnum(cID);
-        hit->SetTimeStart(m_userData.fTimeStart);
-        hit->SetTimeEnd(m_userData.fTimeEnd);
-        hit->SetWavlenMax(m_userData.fWavlenStart);
-        hit->SetWavlenMin(m_userData.fWavlenEnd);
-        coll->add(cID, hit);
-      }
+      Hit* hit = findOrCreateHit<Hit>(coll, cID, [&]() {
+        auto* newHit = new Geant4DRCalorimeter::Hit(m_userData.fWavlenStep, m_userData.fTimeStep);
+        newHit->cellID = cID;
+        newHit->position = m_segmentation->position(cID) * CLHEP::mm / dd4hep::mm; // segmentation gives dd4hep unit
+        newHit->SetSiPMnum(cID);
+        newHit->SetTimeStart(m_userData.fTimeStart);
+        newHit->SetTimeEnd(m_userData.fTimeEnd);
+        newHit->SetWavlenMax(m_userData.fWavlenStart);
+        newHit->SetWavlenMin(m_userData.fWavlenEnd);
+        if (m_userData.denseHistograms)
+          newHit->UseDenseHistograms(m_userData.fWavBin, m_userData.fTimeBin);
+        return newHit;
+      });
 
       hit->photonCount();
       int wavBin = m_userData.findWavBin(energy);
@@ -10,6 +10,7 @@
 #include <G4Types.hh>
 
 #include <map>
+#include <vector>
 
 #if DD4HEP_VERSION_GE(1, 21)
 #define GEANT4_CONST_STEP const
@@ -30,6 +31,7 @@ namespace sim {
       typedef Geant4HitData base_t;
       typedef std::map<int, int> DRsimTimeStruct;
       typedef std::map<int, int> DRsimWavlenSpectrum;
+      typedef std::vector<int> DRsimCounts;
 
       /// Hit position
       ROOT::Math::XYZVector position;
@@ -50,6 +52,8 @@ namespace sim {
         fPhotons = right.fPhotons;
         fWavlenSpectrum = right.fWavlenSpectrum;
         fTimeStruct = right.fTimeStruct;
+        fWavlenCounts = right.fWavlenCounts;
+        fTimeCounts = right.fTimeCounts;
         mWavSampling = right.mWavSampling;
         mTimeSampling = right.mTimeSampling;
       }
@@ -59,6 +63,8 @@ namespace sim {
         fPhotons = right.fPhotons;
         fWavlenSpectrum = right.fWavlenSpectrum;
         fTimeStruct = right.fTimeStruct;
+        fWavlenCounts = right.fWavlenCounts;
+        fTimeCounts = right.fTimeCounts;
         mWavSampling = right.mWavSampling;
         mTimeSampling = right.mTimeSampling;
         return *this;
@@ -80,7 +86,19 @@ namespace sim {
       void SetSiPMnum(dd4hep::DDSegmentation::CellID n) { fSiPMnum = n; }
       const dd4hep::DDSegmentation::CellID& GetSiPMnum() const { return fSiPMnum; }
 
+      /// Count the photons in contiguous arrays of nWavBin + 2 and nTimeBin + 2 bins (with under- and overflow)
+      /// instead of the maps, to be called before the first photon is counted
+      void UseDenseHistograms(int nWavBin, int nTimeBin) {
+        fWavlenCounts.assign(nWavBin + 2, 0);
+        fTimeCounts.assign(nTimeBin + 2, 0);
+      }
+      bool HasDenseHistograms() const { return not fTimeCounts.empty(); }
+
       void CountWavlenSpectrum(int ibin) {
+        if (not fWavlenCounts.empty()) {
+          fWavlenCounts[ibin]++;
+          return;
+        }
         auto it = fWavlenSpectrum.find(ibin);
 
         if (it == fWavlenSpectrum.end())
@@ -88,9 +106,16 @@ namespace sim {
         else
           it->second++;
       };
+      /// Wavelength spectrum of the map representation, empty with dense histograms
       const DRsimWavlenSpectrum& GetWavlenSpectrum() const { return fWavlenSpectrum; }
+      /// Wavelength spectrum of the dense representation, empty with maps
+      const DRsimCounts& GetWavlenCounts() const { return fWavlenCounts; }
 
       void CountTimeStruct(int ibin) {
+        if (not fTimeCounts.empty()) {
+          fTimeCounts[ibin]++;
+          return;
+        }
         auto it = fTimeStruct.find(ibin);
 
         if (it == fTimeStruct.end())
@@ -98,7 +123,10 @@ namespace sim {
         else
           it->second++;
       };
+      /// Time structure of the map representation, empty with dense histograms
       const DRsimTimeStruct& GetTimeStruct() const { return fTimeStruct; }
+      /// Time structure of the dense representation, empty with maps
+      const DRsimCounts& GetTimeCounts() const { return fTimeCounts; }
 
       float GetSamplingTime() const { return mTimeSampling; }
       float GetSamplingWavlen() const { return mWavSampling; }
@@ -120,6 +148,8 @@ namespace sim {
       unsigned long fPhotons;
       DRsimWavlenSpectrum fWavlenSpectrum;
       DRsimTimeStruct fTimeStruct;
+      DRsimCounts fWavlenCounts; // dense wavelength spectrum, used instead of fWavlenSpectrum if not empty
+      DRsimCounts fTimeCounts;   // dense time structure, used instead of fTimeStruct if not empty
       float mWavSampling;
       float mTimeSampling;
       float fWavlenMax;
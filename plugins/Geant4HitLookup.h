@@ -0,0 +1,45 @@
+#ifndef Geant4HitLookup_h
+#define Geant4HitLookup_h 1
+
+// DD4hep Framework include files
+#include "DD4hep/Primitives.h"
+#include "DDG4/Geant4HitCollection.h"
+
+/// Namespace for the AIDA detector description toolkit
+namespace dd4hep {
+
+/// Namespace for the Geant4 based simulation part of the AIDA detector description toolkit
+namespace sim {
+
+  /*
+   *  Hit lookup by cellID for the k4geo sensitive actions
+   *
+   *  The hits are added to the collection with their cellID as key, and looked up in the key map of
+   *  the collection (a tree lookup) instead of scanning the collection with CellIDCompare. Keyed hits
+   *  are also appended to the collection, so CellIDCompare and iteration still see them. The reverse
+   *  does not hold: every hit of the collection must be added through the helper or add(key, hit),
+   *  a hit added with add(hit) is not found by findHit and findOrCreateHit.
+   */
+
+  /// Hit with the given cellID, nullptr if the collection has none
+  template <typename HIT>
+  HIT* findHit(Geant4HitCollection* coll, VolumeID cellID) {
+    return coll->findByKey<HIT>(cellID);
+  }
+
+  /// Hit with the given cellID, the hit returned by create() is added to the collection if it has none.
+  /// create() must set the cellID of the hit
+  template <typename HIT, typename CREATE>
+  HIT* findOrCreateHit(Geant4HitCollection* coll, VolumeID cellID, CREATE create) {
+    HIT* hit = coll->findByKey<HIT>(cellID);
+    if (!hit) {
+      hit = create();
+      coll->add(cellID, hit);
+    }
+    return hit;
+  }
+
+} // namespace sim
+} // namespace dd4hep
+
+#endif // Geant4HitLookup_h
@@ -0,0 +1,49 @@
+#ifndef Geant4OpticalProcessLookup_h
+#define Geant4OpticalProcessLookup_h 1
+
+// Geant4 include files
+#include "G4OpBoundaryProcess.hh"
+#include "G4OpProcessSubType.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4ProcessManager.hh"
+#include "G4ProcessVector.hh"
+#include "G4VProcess.hh"
+
+/// Namespace for the AIDA detector description toolkit
+namespace dd4hep {
+
+/// Namespace for the Geant4 based simulation part of the AIDA detector description toolkit
+namespace sim {
+
+  /*
+   *  Lookup of the optical processes for the dual-readout calorimeter plugins
+   *
+   *  The processes are owned by the process manager of the particle, which is local to the worker
+   *  thread: the pointers must be looked up in the thread using them, once the physics list is
+   *  constructed (e.g. at the beginning of the run), and can then be kept for the whole run.
+   */
+
+  /// Post-step optical process of the given subtype of the particle, nullptr if the particle has none
+  template <typename PROC>
+  PROC* findOpticalProcess(const G4ParticleDefinition* particle, G4OpProcessSubType subType) {
+    G4ProcessManager* pm = particle ? particle->GetProcessManager() : nullptr;
+    if (!pm)
+      return nullptr;
+    G4ProcessVector* postStepProcessVector = pm->GetPostStepProcessVector();
+    for (G4int np = 0; np < (G4int)postStepProcessVector->entries(); np++) {
+      G4VProcess* theProcess = (*postStepProcessVector)[np];
+      if (theProcess->GetProcessType() == fOptical && theProcess->GetProcessSubType() == subType)
+        return dynamic_cast<PROC*>(theProcess);
+    }
+    return nullptr;
+  }
+
+  /// Optical boundary process of the particle, nullptr if the particle has none
+  inline G4OpBoundaryProcess* findOpBoundaryProcess(const G4ParticleDefinition* particle) {
+    return findOpticalProcess<G4OpBoundaryProcess>(particle, fOpBoundary);
+  }
+
+} // namespace sim
+} // namespace dd4hep
+
+#endif // Geant4OpticalProcessLookup_h
@@ -28,6 +28,13 @@ using ROOTWriter = podio::ROOTFrameWriter;
 #endif
 
 #include "FiberDRCaloSDAction.h"
+#include "Geant4ParticleIndex.h"
+#include "Geant4WriterQueue.h"
+
+/// C/C++ include files
+#include <chrono>
+#include <filesystem>
+#include <system_error>
 
 /// Namespace for the AIDA detector description toolkit
 namespace dd4hep {
@@ -37,6 +44,7 @@ class ComponentCast;
 /// Namespace for the Geant4 based simulation part of the AIDA detector description toolkit
 namespace sim {
 
+  class Geant4Particle;
   class Geant4ParticleMap;
 
   /// Base class to output Geant4 event data to EDM4hep
@@ -56,10 +64,21 @@ namespace sim {
                                    edm4hep::RawTimeSeriesCollection>; // Required info for IDEA DRC sim hit
     using drcalomap_t = std::map<std::string, drcalopair_t>;          // Required info for IDEA DRC sim hit
     using drcaloWavmap_t = std::map<std::string, edm4hep::RawTimeSeriesCollection>;
+    using framequeue_t = Geant4WriterQueue<std::pair<podio::Frame, std::string>>;
 
     std::unique_ptr<writer_t> m_file{};
+    /// Name of the output file of the run, for its size in the run summary
+    std::string m_fileName{};
+    /// Frames written by a dedicated thread if WriterThread is set
+    std::unique_ptr<framequeue_t> m_writerQueue{};
     podio::Frame m_frame{};
     edm4hep::MCParticleCollection m_particles{};
+    /// Index of the particle IDs in m_particles and their particles, reused across events
+    Geant4ParticleIndex m_particleIndex;
+    std::vector<const Geant4Particle*> m_particlePointers;
+    /// Particle IDs of the Geant4 tracks of the event, filled at the first hit contribution
+    Geant4ParticleIndex m_trackIndex;
+    bool m_trackIndexFilled{false};
     trackermap_t m_trackerHits;
     calorimetermap_t m_calorimeterHits;
     drcalomap_t m_drcaloHits;
@@ -75,11 +94,30 @@ namespace sim {
     int m_eventNo{0};
     int m_eventNumberOffset{0};
     bool m_filesByRun{false};
+    /// Store the DRC time series from their first to their last non-empty bin only
+    bool m_sparseTimeSeries{false};
+    /// Bins of the DRC time series in the histograms of the hits and stored in the output, for the run summary
+    unsigned long long m_timeSeriesBins{0};
+    unsigned long long m_timeSeriesBinsStored{0};
+    /// Write the frames in a dedicated thread instead of the worker thread committing the event
+    bool m_writerThread{false};
+    /// Frames queued at most for the writer thread
+    int m_writerQueueSize{16};
+    /// Start of the run, events committed and time spent writing the frames, for the run summary
+    std::chrono::steady_clock::time_point m_runStart{};
+    unsigned long long m_committedEvents{0};
+    double m_writeSeconds{0.};
 
     /// Data conversion interface for MC particles to EDM4hep format
     void saveParticles(Geant4ParticleMap* particles);
+    /// Particle ID of a Geant4 track, as Geant4ParticleMap::particleID
+    int particleID(Geant4ParticleMap* particles, int g4ID);
     /// Store the metadata frame with e.g. the cellID encoding strings
     void saveFileMetaData();
+    /// Write a frame to the output file, or queue it for the writer thread
+    void writeFrame(podio::Frame&& frame, const std::string& category);
+    /// Write a frame to the output file, adding the time spent to m_writeSeconds
+    void writeToFile(podio::Frame& frame, const std::string& category);
 
   public:
     /// Standard constructor
@@ -203,6 +241,10 @@ namespace sim {
 /// edm4hep include files
 #include <edm4hep/EventHeaderCollection.h>
 
+/// C/C++ include files
+#include <algorithm>
+#include <iterator>
+
 using namespace dd4hep::sim;
 using namespace dd4hep;
 
@@ -224,6 +266,9 @@ Geant4Output2EDM4hep_DRC::Geant4Output2EDM4hep_DRC(Geant4Context* ctxt, const st
   declareProperty("EventNumberOffset", m_eventNumberOffset);
   declareProperty("SectionName", m_section_name);
   declareProperty("FilesByRun", m_filesByRun);
+  declareProperty("SparseTimeSeries", m_sparseTimeSeries);
+  declareProperty("WriterThread", m_writerThread);
+  declareProperty("WriterQueueSize", m_writerQueueSize);
   info("Writer is now instantiated ...");
   InstanceCount::increment(this);
 }
@@ -231,6 +276,7 @@ Geant4Output2EDM4hep_DRC::Geant4Output2EDM4hep_DRC(Geant4Context* ctxt, const st
 /// Default destructor
 Geant4Output2EDM4hep_DRC::~Geant4Output2EDM4hep_DRC() {
   G4AutoLock protection_lock(&action_mutex);
+  m_writerQueue.reset();
   m_file.reset();
   InstanceCount::decrement(this);
 }
@@ -248,20 +294,65 @@ void Geant4Output2EDM4hep_DRC::beginRun(const G4Run* run) {
   }
   if (!fname.empty()) {
     m_file = std::make_unique<podio::ROOTWriter>(fname);
+    m_fileName = fname;
     if (!m_file) {
       fatal("+++ Failed to open output file: %s", fname.c_str());
     }
     printout(INFO, "Geant4Output2EDM4hep_DRC", "Opened %s for output", fname.c_str());
+    if (m_writerThread) {
+      m_writerQueue = std::make_unique<framequeue_t>(std::max(m_writerQueueSize, 1), [this](auto& item) {
+        writeToFile(item.first, item.second);
+      });
+      printout(INFO, "Geant4Output2EDM4hep_DRC", "Frames written by a writer thread, up to %d queued",
+               std::max(m_writerQueueSize, 1));
+    }
   }
+  m_runStart = std::chrono::steady_clock::now();
+  m_committedEvents = 0;
+  m_writeSeconds = 0.;
 }
 
 /// Callback to store the Geant4 run information
 void Geant4Output2EDM4hep_DRC::endRun(const G4Run* run) {
+  if (m_sparseTimeSeries && m_timeSeriesBins > 0) {
+    info("+++ Sparse DRC time series: stored %llu of %llu bins (%.1f%%)", m_timeSeriesBinsStored, m_timeSeriesBins,
+         100. * m_timeSeriesBinsStored / m_timeSeriesBins);
+  }
+  m_timeSeriesBins = m_timeSeriesBinsStored = 0;
   saveRun(run);
   saveFileMetaData();
+  std::string writerFailure;
+  if (m_writerQueue) {
+    std::unique_ptr<framequeue_t> writerQueue = std::move(m_writerQueue);
+    try {
+      writerQueue->close();
+    } catch (const std::exception& e) {
+      writerFailure = e.what();
+    }
+    info("+++ Writer thread: %zu frames, the queue was full for %zu of them", writerQueue->pushes(),
+         writerQueue->fullWaits());
+  }
   if (m_file) {
+    const auto finishStart = std::chrono::steady_clock::now();
     m_file->finish();
     m_file.reset();
+    const auto runEnd = std::chrono::steady_clock::now();
+    m_writeSeconds += std::chrono::duration<double>(runEnd - finishStart).count();
+    // events/s of the whole run, to compare the output modes for different numbers of worker threads
+    const double runSeconds = std::chrono::duration<double>(runEnd - m_runStart).count();
+    info("+++ Output: %llu events in %.2f s (%.2f events/s), %.2f s writing the frames %s", m_committedEvents,
+         runSeconds, m_committedEvents / runSeconds, m_writeSeconds,
+         m_writerThread ? "in the writer thread" : "under the output lock");
+    // file size with dense or sparse DRC time series, to compare both settings on the same sample
+    std::error_code error;
+    const auto fileBytes = std::filesystem::file_size(m_fileName, error);
+    if (!error) {
+      info("+++ Output file %s: %.2f MB with %s DRC time series", m_fileName.c_str(), fileBytes / (1024. * 1024.),
+           m_sparseTimeSeries ? "sparse" : "dense");
+    }
+  }
+  if (!writerFailure.empty()) {
+    except("+++ Writer thread failed to write a frame: %s", writerFailure.c_str());
   }
 }
 
@@ -271,7 +362,23 @@ void Geant4Output2EDM4hep_DRC::saveFileMetaData() {
     metaFrame.putParameter(name + "__CellIDEncoding", encodingStr);
   }
 
-  m_file->writeFrame(metaFrame, "metadata");
+  writeFrame(std::move(metaFrame), "metadata");
+}
+
+void Geant4Output2EDM4hep_DRC::writeFrame(podio::Frame&& frame, const std::string& category) {
+  // The worker threads only wait for the writer thread when the queue is full
+  if (m_writerQueue) {
+    m_writerQueue->push(std::make_pair(std::move(frame), category));
+    return;
+  }
+  writeToFile(frame, category);
+}
+
+void Geant4Output2EDM4hep_DRC::writeToFile(podio::Frame& frame, const std::string& category) {
+  // Called under the output lock, at the end of the run or by the writer thread, never concurrently
+  const auto start = std::chrono::steady_clock::now();
+  m_file->writeFrame(frame, category);
+  m_writeSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 }
 
 /// Commit data at end of filling procedure
@@ -293,7 +400,8 @@ void Geant4Output2EDM4hep_DRC::commit(OutputContext<G4Event>& /* ctxt */) {
     for (auto it = m_drcaloWaves.begin(); it != m_drcaloWaves.end(); ++it) {
       m_frame.put(std::move(it->second), it->first + "WaveLen");
     }
-    m_file->writeFrame(m_frame, m_section_name);
+    writeFrame(std::move(m_frame), m_section_name);
+    m_committedEvents++;
     m_particles.clear();
     m_trackerHits.clear();
     m_calorimeterHits.clear();
@@ -326,7 +434,7 @@ void Geant4Output2EDM4hep_DRC::saveRun(const G4Run* run) {
     parameters->extractParameters(runHeader);
   }
 
-  m_file->writeFrame(runHeader, "runs");
+  writeFrame(std::move(runHeader), "runs");
 }
 
 void Geant4Output2EDM4hep_DRC::begin(const G4Event* event) {
@@ -338,6 +446,7 @@ void Geant4Output2EDM4hep_DRC::begin(const G4Event* event) {
   m_calorimeterHits.clear();
   m_drcaloHits.clear();
   m_drcaloWaves.clear();
+  m_trackIndexFilled = false;
 }
 
 /// Data conversion interface for MC particles to EDM4hep format
@@ -350,8 +459,10 @@ void Geant4Output2EDM4hep_DRC::saveParticles(Geant4ParticleMap* particles) {
   if (pm.size() > 0) {
     size_t cnt = 0;
     // Mapping of ids in the ParticleMap to indices in the MCParticle collection
-    std::map<int, int> p_ids;
-    std::vector<const Geant4Particle*> p_part;
+    Geant4ParticleIndex& p_ids = m_particleIndex;
+    p_ids.reset(pm.begin()->first, pm.rbegin()->first, pm.size());
+    std::vector<const Geant4Particle*>& p_part = m_particlePointers;
+    p_part.clear();
     p_part.reserve(pm.size());
     // First create the particles
     for (const auto& iParticle : pm) {
@@ -411,34 +522,32 @@ void Geant4Output2EDM4hep_DRC::saveParticles(Geant4ParticleMap* particles) {
 
       mcp.setSpin(p->spin);
 
-      p_ids[id] = cnt++;
+      p_ids.set(id, cnt++);
       p_part.push_back(p);
     }
 
     // Now establish parent-daughter relationships
-    for (size_t i = 0; i < p_ids.size(); ++i) {
+    for (size_t i = 0; i < p_part.size(); ++i) {
       const Geant4Particle* p = p_part[i];
       auto q = m_particles[i];
 
       for (const auto& idau : p->daughters) {
-        const auto k = p_ids.find(idau);
-        if (k == p_ids.end()) {
+        int iqdau = p_ids.find(idau);
+        if (iqdau < 0) {
           fatal("+++ Particle %d: FAILED to find daughter with ID:%d", p->id, idau);
           continue;
         }
-        int iqdau = (*k).second;
         auto qdau = m_particles[iqdau];
         q.addToDaughters(qdau);
       }
 
       for (const auto& ipar : p->parents) {
         if (ipar >= 0) { // A parent ID of -1 means NO parent, because a base of 0 is perfectly legal
-          const auto k = p_ids.find(ipar);
-          if (k == p_ids.end()) {
+          int iqpar = p_ids.find(ipar);
+          if (iqpar < 0) {
             fatal("+++ Particle %d: FAILED to find parent with ID:%d", p->id, ipar);
             continue;
           }
-          int iqpar = (*k).second;
           auto qpar = m_particles[iqpar];
           q.addToParents(qpar);
         }
@@ -447,6 +556,24 @@ void Geant4Output2EDM4hep_DRC::saveParticles(Geant4ParticleMap* particles) {
   }
 }
 
+int Geant4Output2EDM4hep_DRC::particleID(Geant4ParticleMap* particles, int g4ID) {
+  // Flat copy of the track equivalents, instead of a map lookup per hit contribution
+  if (!m_trackIndexFilled) {
+    const auto& equivalents = particles->equivalentTracks;
+    if (equivalents.empty()) {
+      m_trackIndex.reset(0, -1, 0);
+    } else {
+      m_trackIndex.reset(equivalents.begin()->first, equivalents.rbegin()->first, equivalents.size());
+      for (const auto& [track, particle] : equivalents)
+        m_trackIndex.set(track, particle);
+    }
+    m_trackIndexFilled = true;
+  }
+  const int id = m_trackIndex.find(g4ID);
+  // tracks without equivalent particle are reported by the particle map
+  return id >= 0 ? id : particles->particleID(g4ID);
+}
+
 /// Callback to store the Geant4 event
 void Geant4Output2EDM4hep_DRC::saveEvent(OutputContext<G4Event>& ctxt) {
   EventParameters* parameters = context()->event().extension<EventParameters>(false);
@@ -515,6 +642,50 @@ private:
   Geant4HitCollection* m_coll{nullptr};
 };
 
+namespace {
+/// Add the photon counts of the bins 1 to nbin of a DRC hit histogram (0: underflow, nbin+1: overflow) to the
+/// ADC counts of a time series, in one pass over the histogram. If trimmed only the bins from the first to the
+/// last non-empty one are added (none if all are empty). Returns the number of leading bins dropped.
+template <typename SERIES>
+unsigned addAdcCounts(SERIES& series, const std::map<int, int>& counts, unsigned nbin, bool trim) {
+  auto it = counts.lower_bound(1);
+  const auto end = counts.upper_bound(static_cast<int>(nbin));
+  if (trim && it == end)
+    return 0;
+  const unsigned first = trim ? it->first : 1;
+  const unsigned last = trim ? std::prev(end)->first : nbin;
+  for (unsigned ibin = first; ibin <= last; ibin++) {
+    if (it != end && static_cast<unsigned>(it->first) == ibin) {
+      series.addToAdcCounts(it->second);
+      ++it;
+    } else {
+      series.addToAdcCounts(0);
+    }
+  }
+  return first - 1;
+}
+
+template <typename SERIES>
+unsigned addAdcCounts(SERIES& series, const std::vector<int>& counts, unsigned nbin, bool trim) {
+  // bins beyond the dense histogram are empty
+  const unsigned nfilled = std::min<unsigned>(nbin, counts.size() > 1 ? counts.size() - 2 : 0);
+  unsigned first = 1;
+  unsigned last = nbin;
+  if (trim) {
+    while (first <= nfilled && counts[first] == 0)
+      first++;
+    if (first > nfilled)
+      return 0;
+    last = nfilled;
+    while (counts[last] == 0)
+      last--;
+  }
+  for (unsigned ibin = first; ibin <= last; ibin++)
+    series.addToAdcCounts(ibin <= nfilled ? counts[ibin] : 0);
+  return first - 1;
+}
+} // namespace
+
 /// Callback to store each Geant4 hit collection
 void Geant4Output2EDM4hep_DRC::saveCollection(OutputContext<G4Event>& /*ctxt*/, G4VHitsCollection* collection) {
   Geant4HitCollection* coll = dynamic_cast<Geant4HitCollection*>(collection);
@@ -538,7 +709,7 @@ void Geant4Output2EDM4hep_DRC::saveCollection(OutputContext<G4Event>& /*ctxt*/,
       auto sth = hits->create();
       const Geant4Tracker::Hit* hit = coll->hit(i);
       const Geant4Tracker::Hit::Contribution& t = hit->truth;
-      int trackID = pm->particleID(t.trackID);
+      int trackID = particleID(pm, t.trackID);
       auto mcp = m_particles.at(trackID);
       const auto& mom = hit->momentum;
       const auto& pos = hit->position;
@@ -583,7 +754,7 @@ void Geant4Output2EDM4hep_DRC::saveCollection(OutputContext<G4Event>& /*ctxt*/,
         sch.addToContributions(sCaloHitCont);
 
         const Geant4HitData::Contribution& c = *ci;
-        int trackID = pm->particleID(c.trackID);
+        int trackID = particleID(pm, c.trackID);
         auto mcp = m_particles.at(trackID);
         sCaloHitCont.setEnergy(c.deposit / CLHEP::GeV);
         sCaloHitCont.setTime(c.time / CLHEP::ns);
@@ -613,10 +784,8 @@ void Geant4Output2EDM4hep_DRC::saveCollection(OutputContext<G4Event>& /*ctxt*/,
       float samplingT = hit->GetSamplingTime();
       float timeStart = hit->GetTimeStart();
       float timeEnd = hit->GetTimeEnd();
-      auto& timemap = hit->GetTimeStruct();
 
       rawTimeStruct.setInterval(samplingT);
-      rawTimeStruct.setTime(timeStart);
       rawTimeStruct.setCharge(static_cast<float>(hit->GetPhotonCount()));
       rawTimeStruct.setCellID(hit->cellID);
 
@@ -624,9 +793,7 @@ void Geant4Output2EDM4hep_DRC::saveCollection(OutputContext<G4Event>& /*ctxt*/,
       float samplingW = hit->GetSamplingWavlen();
       float wavMax = hit->GetWavlenMax();
       float wavMin = hit->GetWavlenMin();
-      auto& wavmap = hit->GetWavlenSpectrum();
       rawWaveStruct.setInterval(samplingW);
-      rawWaveStruct.setTime(wavMin);
       rawWaveStruct.setCharge(static_cast<float>(hit->GetPhotonCount()));
       rawWaveStruct.setCellID(hit->cellID);
 
@@ -634,23 +801,21 @@ void Geant4Output2EDM4hep_DRC::saveCollection(OutputContext<G4Event>& /*ctxt*/,
       unsigned nbinWav = static_cast<unsigned>((wavMax - wavMin) / samplingW);
 
       // same as the ROOT TH1 binning scheme (0: underflow, nbin+1:overflow)
-      for (unsigned itime = 1; itime < nbinTime + 1; itime++) {
-        int count = 0;
-
-        if (timemap.find(itime) != timemap.end())
-          count = timemap.at(itime);
-
-        rawTimeStruct.addToAdcCounts(count);
-      }
-
-      for (unsigned iwav = 1; iwav < nbinWav + 1; iwav++) {
-        int count = 0;
-
-        if (wavmap.find(iwav) != wavmap.end())
-          count = wavmap.at(iwav);
-
-        rawWaveStruct.addToAdcCounts(count);
-      }
+      // the hit counts the photons either in maps or in dense arrays
+      // sparse series start at their first non-empty bin, their time is shifted accordingly
+      const unsigned offsetTime = hit->HasDenseHistograms()
+                                      ? addAdcCounts(rawTimeStruct, hit->GetTimeCounts(), nbinTime, m_sparseTimeSeries)
+                                      : addAdcCounts(rawTimeStruct, hit->GetTimeStruct(), nbinTime, m_sparseTimeSeries);
+      rawTimeStruct.setTime(timeStart + offsetTime * samplingT);
+
+      const unsigned offsetWav =
+          hit->HasDenseHistograms()
+              ? addAdcCounts(rawWaveStruct, hit->GetWavlenCounts(), nbinWav, m_sparseTimeSeries)
+              : addAdcCounts(rawWaveStruct, hit->GetWavlenSpectrum(), nbinWav, m_sparseTimeSeries);
+      rawWaveStruct.setTime(wavMin + offsetWav * samplingW);
+
+      m_timeSeriesBins += nbinTime + nbinWav;
+      m_timeSeriesBinsStored += rawTimeStruct.adcCounts_size() + rawWaveStruct.adcCounts_size();
 
       const auto& pos = hit->position;
       simCaloHits.setCellID(hit->cellID);
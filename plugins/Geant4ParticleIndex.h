@@ -0,0 +1,68 @@
+#ifndef Geant4ParticleIndex_h
+#define Geant4ParticleIndex_h 1
+
+// C/C++ include files
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+/// Namespace for the AIDA detector description toolkit
+namespace dd4hep {
+
+/// Namespace for the Geant4 based simulation part of the AIDA detector description toolkit
+namespace sim {
+
+  /// Flat index of the particles (or tracks) of an event, reused across events
+  /*
+   *  Maps the non-negative IDs of an event, e.g. the particle IDs to their index in the MCParticle
+   *  collection, or the Geant4 track IDs to their particle ID. The IDs of an event are mostly dense,
+   *  they are then looked up in a vector, otherwise in a hash map. The storage of both is kept from one
+   *  event to the next, so that the index is not reallocated for events of similar size.
+   */
+  class Geant4ParticleIndex {
+  public:
+    /// Empty the index for the IDs of an event, from minID to maxID, with nEntries IDs
+    void reset(int minID, int maxID, std::size_t nEntries) {
+      m_sparse.clear();
+      m_dense.clear();
+      const std::size_t size = maxID >= 0 ? static_cast<std::size_t>(maxID) + 1 : 0;
+      m_useDense = minID >= 0 && size <= kMaxHolesPerEntry * nEntries + kMinDense;
+      if (m_useDense)
+        m_dense.assign(size, -1);
+      else
+        m_sparse.reserve(nEntries);
+    }
+
+    /// Set the value of an ID in the range given to reset()
+    void set(int id, int value) {
+      if (m_useDense)
+        m_dense[id] = value;
+      else
+        m_sparse[id] = value;
+    }
+
+    /// Value of the ID, -1 if it is not in the index
+    int find(int id) const {
+      if (m_useDense)
+        return id >= 0 && static_cast<std::size_t>(id) < m_dense.size() ? m_dense[id] : -1;
+      const auto it = m_sparse.find(id);
+      return it == m_sparse.end() ? -1 : it->second;
+    }
+
+    /// True if the IDs are looked up in the vector
+    bool isDense() const { return m_useDense; }
+
+  private:
+    /// The vector is used up to this many slots per ID in the event, plus kMinDense
+    static constexpr std::size_t kMaxHolesPerEntry = 4;
+    static constexpr std::size_t kMinDense = 1024;
+
+    bool m_useDense{true};
+    std::vector<int> m_dense;
+    std::unordered_map<int, int> m_sparse;
+  };
+
+} // namespace sim
+} // namespace dd4hep
+
+#endif // Geant4ParticleIndex_h
@@ -0,0 +1,128 @@
+#ifndef Geant4WriterQueue_h
+#define Geant4WriterQueue_h 1
+
+// C/C++ include files
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+/// Namespace for the AIDA detector description toolkit
+namespace dd4hep {
+
+/// Namespace for the Geant4 based simulation part of the AIDA detector description toolkit
+namespace sim {
+
+  /// Bounded queue drained by a dedicated writer thread
+  /*
+   *  The items pushed by the producers (e.g. the event frames of the Geant4 worker threads) are handed
+   *  to the write function by the writer thread, in the order they were pushed. A push only waits while
+   *  the queue is full, so the producers do not wait for the output unless it falls behind by more than
+   *  the capacity of the queue, which bounds the memory held by the queued items.
+   */
+  template <typename ITEM>
+  class Geant4WriterQueue {
+  public:
+    using write_t = std::function<void(ITEM&)>;
+
+    /// Start the writer thread, queueing at most capacity items (at least one)
+    Geant4WriterQueue(std::size_t capacity, write_t write)
+        : m_capacity(capacity > 0 ? capacity : 1), m_write(std::move(write)) {
+      m_writer = std::thread(&Geant4WriterQueue::run, this);
+    }
+    /// Write the queued items and stop the writer thread, an exception of the write function is dropped
+    ~Geant4WriterQueue() {
+      try {
+        close();
+      } catch (...) {
+      }
+    }
+
+    Geant4WriterQueue(const Geant4WriterQueue&) = delete;
+    Geant4WriterQueue& operator=(const Geant4WriterQueue&) = delete;
+
+    /// Queue an item for the writer thread, waiting while the queue is full. Not to be called after close()
+    void push(ITEM&& item) {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_pushes++;
+      if (m_items.size() >= m_capacity) {
+        m_fullWaits++;
+        m_notFull.wait(lock, [this] { return m_items.size() < m_capacity; });
+      }
+      m_items.push_back(std::move(item));
+      lock.unlock();
+      m_notEmpty.notify_one();
+    }
+
+    /// Write the queued items and stop the writer thread. The first exception thrown by the write function
+    /// is rethrown here, the items after it are still written
+    void close() {
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_writer.joinable())
+          return;
+        m_closing = true;
+      }
+      m_notEmpty.notify_all();
+      m_writer.join();
+      if (m_exception) {
+        std::exception_ptr exception = std::move(m_exception);
+        m_exception = nullptr;
+        std::rethrow_exception(exception);
+      }
+    }
+
+    /// Number of items pushed
+    std::size_t pushes() const {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      return m_pushes;
+    }
+    /// Number of pushes which had to wait for the writer thread
+    std::size_t fullWaits() const {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      return m_fullWaits;
+    }
+
+  private:
+    void run() {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      while (true) {
+        m_notEmpty.wait(lock, [this] { return !m_items.empty() || m_closing; });
+        if (m_items.empty())
+          return; // closing and drained
+        ITEM item = std::move(m_items.front());
+        m_items.pop_front();
+        lock.unlock();
+        m_notFull.notify_one();
+        try {
+          m_write(item);
+        } catch (...) {
+          if (!m_exception)
+            m_exception = std::current_exception();
+        }
+        lock.lock();
+      }
+    }
+
+    const std::size_t m_capacity;
+    write_t m_write;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_notFull;
+    std::condition_variable m_notEmpty;
+    std::deque<ITEM> m_items;
+    bool m_closing{false};
+    std::size_t m_pushes{0};
+    std::size_t m_fullWaits{0};
+    /// First exception of the write function, only accessed by the writer thread until it is joined
+    std::exception_ptr m_exception;
+    std::thread m_writer;
+  };
+
+} // namespace sim
+} // namespace dd4hep
+
+#endif // Geant4WriterQueue_h
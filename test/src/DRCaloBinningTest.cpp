@@ -0,0 +1,142 @@
+// Wavelength and time bins of the dual-readout calorimeter SD action, checked against the linear scans
+// they replace on every bin edge, its neighbouring values and random values including under/overflow,
+// with the ns/lookup of both
+//
+// Usage: DRCaloBinningTest [nLookups]
+
+#include "DRCaloBinning.h"
+
+#include <DD4hep/DDTest.h>
+
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static dd4hep::DDTest test("DRCaloBinningTest");
+
+namespace {
+
+using dd4hep::sim::DRCaloBinning;
+
+// The former linear scans of the FiberDRCaloSDAction
+int scanWavBin(const DRCaloBinning& b, G4double en) {
+  int i = 0;
+  for (; i < b.fWavBin + 1; i++) {
+    if (en < b.wavToE((b.fWavlenStart - static_cast<float>(i) * b.fWavlenStep) * CLHEP::nm))
+      break;
+  }
+
+  return b.fWavBin + 1 - i;
+}
+
+int scanTimeBin(const DRCaloBinning& b, G4double stepTime) {
+  int i = 0;
+  for (; i < b.fTimeBin + 1; i++) {
+    if (stepTime < ((b.fTimeStart + static_cast<float>(i) * b.fTimeStep) * CLHEP::ns))
+      break;
+  }
+
+  return i;
+}
+
+// Each edge, the doubles just below and above it, and the special values
+std::vector<double> edgeValues(const std::vector<double>& edges) {
+  const double inf = std::numeric_limits<double>::infinity();
+  std::vector<double> values = {0., -0., -1., inf, -inf, std::numeric_limits<double>::quiet_NaN()};
+  for (const double edge : edges) {
+    values.push_back(edge);
+    values.push_back(std::nextafter(edge, -inf));
+    values.push_back(std::nextafter(edge, inf));
+  }
+  return values;
+}
+
+// Number of values for which the bins differ
+template <typename Scan, typename Find>
+int countMismatches(const std::vector<double>& values, Scan scan, Find find, int& nUnder, int& nOver, int overflow) {
+  int mismatches = 0;
+  for (const double v : values) {
+    const int expected = scan(v);
+    if (find(v) != expected) {
+      if (mismatches++ < 10)
+        std::cout << "value " << std::setprecision(17) << v << " bin " << find(v) << " instead of " << expected
+                  << std::endl;
+    }
+    nUnder += expected == 0;
+    nOver += expected == overflow;
+  }
+  return mismatches;
+}
+
+template <typename Find>
+double nsPerLookup(const std::vector<double>& values, int nLookups, Find find, long& checksum) {
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < nLookups; i++)
+    checksum += find(values[i % values.size()]);
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / nLookups;
+}
+
+} // namespace
+
+int main(int argc, char** args) {
+
+  const int nLookups = argc > 1 ? std::stoi(args[1]) : 10000000;
+
+  // Binning of the FiberDRCaloSDAction, and a coarser one with other edges
+  for (const DRCaloBinning& binning :
+       {DRCaloBinning(120, 650, 900., 300., 5., 70.), DRCaloBinning(7, 33, 750., 250.5, -1.25, 40.)}) {
+
+    std::mt19937_64 rng(1988301045);
+    const double eMin = binning.fEnergyEdges.front();
+    const double eMax = binning.fEnergyEdges.back();
+    const double tMin = binning.fTimeEdges.front();
+    const double tMax = binning.fTimeEdges.back();
+    std::uniform_real_distribution<double> energies(0.5 * eMin, 1.5 * eMax);
+    std::uniform_real_distribution<double> times(tMin - 0.2 * (tMax - tMin), tMax + 0.2 * (tMax - tMin));
+
+    std::vector<double> energyValues = edgeValues(binning.fEnergyEdges);
+    std::vector<double> timeValues = edgeValues(binning.fTimeEdges);
+    for (int i = 0; i < 1000000; i++) {
+      energyValues.push_back(energies(rng));
+      timeValues.push_back(times(rng));
+    }
+
+    auto scanWav = [&binning](double en) { return scanWavBin(binning, en); };
+    auto findWav = [&binning](double en) { return binning.findWavBin(en); };
+    auto scanTime = [&binning](double t) { return scanTimeBin(binning, t); };
+    auto findTime = [&binning](double t) { return binning.findTimeBin(t); };
+
+    int nUnder = 0, nOver = 0;
+    std::stringstream msg;
+    msg << binning.fWavBin << " wavelength bins identical to the linear scan";
+    test(countMismatches(energyValues, scanWav, findWav, nUnder, nOver, binning.fWavBin + 1), 0, msg.str());
+    test(nUnder > 0 && nOver > 0, true, "wavelength values include underflow and overflow");
+
+    nUnder = nOver = 0;
+    msg.str("");
+    msg << binning.fTimeBin << " time bins identical to the linear scan";
+    test(countMismatches(timeValues, scanTime, findTime, nUnder, nOver, binning.fTimeBin + 1), 0, msg.str());
+    test(nUnder > 0 && nOver > 0, true, "time values include underflow and overflow");
+
+    // Random values only, in the order they would come from the photons
+    energyValues.erase(energyValues.begin(), energyValues.end() - 1000000);
+    timeValues.erase(timeValues.begin(), timeValues.end() - 1000000);
+    long checksum = 0;
+    std::cout << std::endl << binning.fWavBin << " wavelength and " << binning.fTimeBin << " time bins" << std::endl;
+    std::cout << std::setw(16) << "" << std::setw(16) << "scan ns" << std::setw(16) << "lookup ns" << std::endl;
+    std::cout << std::setw(16) << "wavelength" << std::setw(16)
+              << nsPerLookup(energyValues, nLookups, scanWav, checksum) << std::setw(16)
+              << nsPerLookup(energyValues, nLookups, findWav, checksum) << std::endl;
+    std::cout << std::setw(16) << "time" << std::setw(16) << nsPerLookup(timeValues, nLookups, scanTime, checksum)
+              << std::setw(16) << nsPerLookup(timeValues, nLookups, findTime, checksum) << std::endl;
+    std::cout << "checksum " << checksum << std::endl << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,120 @@
+// Light attenuation of DRTubesSglHpr (one binomial draw per step) compared with the former draw per
+// photon: the distribution of surviving photons is tested against the exact binomial distribution
+// with a chi2 test, for small and large signals and survival probabilities. The chi2 and ns/call of
+// the former draw per photon are printed for reference, from at most perPhotonBudget random numbers
+//
+// Usage: DRTubesAttenuationTest [nDraws]
+
+#include "G4Poisson.hh"
+#include "G4Step.hh"
+#include "G4TouchableHistory.hh"
+
+#include "DRTubesSglHpr.hh"
+
+#include <DD4hep/DDTest.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static dd4hep::DDTest test("DRTubesAttenuationTest");
+
+namespace {
+
+// The former implementation of DRTubesSglHpr::AttenuateHelper
+G4int perPhotonAttenuation(const G4int& signal, const G4double& distance, const G4double& attenuation_length) {
+  double probability_of_survival = exp(-distance / attenuation_length);
+
+  G4int survived_photons = 0;
+  for (int i = 0; i < signal; i++) {
+    // Simulate drawing between 0 and 1 with probability x of getting 1
+    if (G4UniformRand() <= probability_of_survival)
+      survived_photons++;
+  }
+  return survived_photons;
+}
+
+// Chi2 of the histogram of the surviving photons against the binomial distribution, merging
+// the bins with less than 5 expected entries
+double binomialChi2(const std::vector<long>& histogram, int signal, double p, long nDraws, int& ndf) {
+  double chi2 = 0.;
+  double expected = 0.;
+  double observed = 0.;
+  ndf = -1;
+  for (int k = 0; k <= signal; k++) {
+    expected += nDraws * std::exp(std::lgamma(signal + 1.) - std::lgamma(k + 1.) - std::lgamma(signal - k + 1.) +
+                                  k * std::log(p) + (signal - k) * std::log1p(-p));
+    observed += histogram[k];
+    if (expected >= 5. || k == signal) {
+      chi2 += expected > 0. ? (observed - expected) * (observed - expected) / expected : observed;
+      ndf++;
+      expected = observed = 0.;
+    }
+  }
+  return chi2;
+}
+
+template <typename Attenuation>
+double sample(Attenuation attenuation, int signal, double distance, double length, long nDraws,
+              std::vector<long>& histogram) {
+  histogram.assign(signal + 1, 0);
+  const auto start = std::chrono::steady_clock::now();
+  for (long i = 0; i < nDraws; i++)
+    histogram[attenuation(signal, distance, length)]++;
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / nDraws;
+}
+
+// Random numbers drawn by the former implementation for each signal and distance, at most
+const long perPhotonBudget = 10000000;
+
+} // namespace
+
+int main(int argc, char** args) {
+
+  const long nDraws = argc > 1 ? std::stol(args[1]) : 100000;
+  G4Random::setTheSeed(1988301045);
+
+  const double length = 1000. * CLHEP::m;
+  std::cout << std::setw(8) << "photons" << std::setw(12) << "survival" << std::setw(16) << "binomial chi2"
+            << std::setw(8) << "ndf" << std::setw(16) << "per photon chi2" << std::setw(8) << "ndf" << std::setw(16)
+            << "binomial ns" << std::setw(16) << "per photon ns" << std::endl;
+  for (const int signal : {1, 2, 5, 20, 100, 500, 3000}) {
+    // 2.5 m fibers with the attenuation length of the IDEA tubes, and much stronger attenuations
+    for (const double distance : {2.5 * CLHEP::m, 100. * CLHEP::m, 693. * CLHEP::m, 3000. * CLHEP::m}) {
+      const double p = std::exp(-distance / length);
+      const long nPerPhotonDraws = std::max(1L, std::min(nDraws, perPhotonBudget / std::max(signal, 1)));
+      std::vector<long> binomial, perPhoton;
+      const double nsBinomial = sample(DRTubesSglHpr::AttenuateHelper, signal, distance, length, nDraws, binomial);
+      const double nsPerPhoton = sample(perPhotonAttenuation, signal, distance, length, nPerPhotonDraws, perPhoton);
+      int ndf = 0;
+      int ndfPerPhoton = 0;
+      const double chi2Binomial = binomialChi2(binomial, signal, p, nDraws, ndf);
+      const double chi2PerPhoton = binomialChi2(perPhoton, signal, p, nPerPhotonDraws, ndfPerPhoton);
+
+      // Far in the tail for the fixed seed, a wrong distribution gives chi2/ndf >> 1 with 10^5 draws
+      const double maxChi2 = ndf + 5. * std::sqrt(2. * ndf) + 5.;
+      std::stringstream msg;
+      msg << signal << " photons, survival " << p << ": binomial distribution of the survivors";
+      test(chi2Binomial < maxChi2, msg.str());
+      std::cout << std::setw(8) << signal << std::setw(12) << p << std::setw(16) << chi2Binomial << std::setw(8) << ndf
+                << std::setw(16) << chi2PerPhoton << std::setw(8) << ndfPerPhoton << std::setw(16) << nsBinomial
+                << std::setw(16) << nsPerPhoton << std::endl;
+    }
+  }
+
+  // Without attenuation all photons survive, as with a draw per photon
+  bool allSurvive = true;
+  for (const int signal : {0, 1, 7, 1000}) {
+    allSurvive &= DRTubesSglHpr::AttenuateHelper(signal, 2.5 * CLHEP::m, DBL_MAX) == signal;
+    allSurvive &= DRTubesSglHpr::AttenuateHelper(signal, 0., length) == signal;
+  }
+  test(allSurvive, "no photon lost without attenuation");
+
+  return 0;
+}
@@ -0,0 +1,179 @@
+// Fiber helpers of DRTubesSglHpr with the cached half lengths and the shared touchable of the step points,
+// checked bitwise against the former implementations (dynamic_cast of the solid and transform per call)
+// on steps located with a G4Navigator in a rotated tower of fibers of different lengths, with the ns/step
+//
+// Usage: DRTubesGeometryCacheTest [nSteps]
+
+#include "G4Box.hh"
+#include "G4LogicalVolume.hh"
+#include "G4Navigator.hh"
+#include "G4NistManager.hh"
+#include "G4PVPlacement.hh"
+#include "G4Poisson.hh"
+#include "G4Step.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4TouchableHistory.hh"
+#include "G4Tubs.hh"
+
+#include "DRTubesSglHpr.hh"
+
+#include <DD4hep/DDTest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+static dd4hep::DDTest test("DRTubesGeometryCacheTest");
+
+namespace {
+
+// The former implementations of the DRTubesSglHpr fiber helpers
+G4double formerDistanceToSiPM(const G4Step* step, bool prestep) {
+  const G4StepPoint* StepPoint = prestep ? step->GetPreStepPoint() : step->GetPostStepPoint();
+  G4ThreeVector globalPos = StepPoint->GetPosition();
+  G4ThreeVector localPos = StepPoint->GetTouchableHandle()->GetHistory()->GetTopTransform().TransformPoint(globalPos);
+  G4LogicalVolume* currentVolume = StepPoint->GetTouchableHandle()->GetVolume()->GetLogicalVolume();
+  G4Tubs* solid = dynamic_cast<G4Tubs*>(currentVolume->GetSolid());
+  G4double size = solid->GetZHalfLength();
+  return size - localPos.z();
+}
+
+bool formerIsReflectedForward(const G4Step* step) {
+  double PreStepDistance = formerDistanceToSiPM(step, true);
+  double PostStepDistance = formerDistanceToSiPM(step, false);
+  return PostStepDistance < PreStepDistance;
+}
+
+G4ThreeVector formerFiberPosition(const G4Step* step) {
+  G4TouchableHandle theTouchable = step->GetPreStepPoint()->GetTouchableHandle();
+  G4ThreeVector origin(0., 0., 0.);
+  G4ThreeVector zdir(0., 0., 1.);
+  G4ThreeVector vectPos = theTouchable->GetHistory()->GetTopTransform().Inverse().TransformPoint(origin);
+  G4ThreeVector direction = theTouchable->GetHistory()->GetTopTransform().Inverse().TransformAxis(zdir);
+  G4LogicalVolume* currentVolume = step->GetPreStepPoint()->GetTouchableHandle()->GetVolume()->GetLogicalVolume();
+  G4Tubs* solid = dynamic_cast<G4Tubs*>(currentVolume->GetSolid());
+  G4double size = solid->GetZHalfLength();
+  G4double lengthfiber = size * 2.;
+  G4ThreeVector Halffibervect = direction * lengthfiber / 2;
+  return vectPos - Halffibervect;
+}
+
+bool sameBits(const G4ThreeVector& a, const G4ThreeVector& b) {
+  return a.x() == b.x() && a.y() == b.y() && a.z() == b.z();
+}
+
+} // namespace
+
+int main(int argc, char** args) {
+
+  const int nSteps = argc > 1 ? std::stoi(args[1]) : 100000;
+
+  // A rotated tower with 5x5 fibers, one fiber length per column and every other row flipped
+  G4Material* air = G4NistManager::Instance()->FindOrBuildMaterial("G4_AIR");
+  auto* worldLV = new G4LogicalVolume(new G4Box("world", 1. * m, 1. * m, 1. * m), air, "world");
+  auto* worldPV = new G4PVPlacement(nullptr, G4ThreeVector(), worldLV, "world", nullptr, false, 0);
+  auto* towerLV = new G4LogicalVolume(new G4Box("tower", 10. * cm, 10. * cm, 30. * cm), air, "tower");
+  auto* towerRot = new G4RotationMatrix();
+  towerRot->rotateY(30. * deg);
+  towerRot->rotateX(10. * deg);
+  new G4PVPlacement(towerRot, G4ThreeVector(10. * cm, -5. * cm, 30. * cm), towerLV, "tower", worldLV, false, 0);
+  auto* flip = new G4RotationMatrix();
+  flip->rotateX(180. * deg);
+  std::vector<G4LogicalVolume*> fiberLVs;
+  for (int col = 0; col < 5; col++) {
+    const G4double halfLength = (20. + 2. * col) * cm;
+    fiberLVs.push_back(new G4LogicalVolume(new G4Tubs("fiber", 0., 1.5 * cm, halfLength, 0., 360. * deg), air,
+                                           "fiber" + std::to_string(col)));
+    for (int row = 0; row < 5; row++) {
+      const G4ThreeVector pos((col - 2) * 4. * cm, (row - 2) * 4. * cm, (col - 2) * 1. * cm);
+      new G4PVPlacement(row % 2 ? flip : nullptr, pos, fiberLVs.back(), "fiber", towerLV, false, (row << 16) | col);
+    }
+  }
+
+  G4Navigator navigator;
+  navigator.SetWorldVolume(worldPV);
+  auto inFiber = [&fiberLVs](const G4TouchableHandle& touchable) {
+    const G4LogicalVolume* lv = touchable->GetVolume()->GetLogicalVolume();
+    return std::find(fiberLVs.begin(), fiberLVs.end(), lv) != fiberLVs.end();
+  };
+
+  // Steps in the fibers: the post-step point shares the touchable of the pre-step point when both are
+  // in the same fiber, as when Geant4 does not cross a boundary, or has its own when in another fiber
+  std::mt19937_64 rng(1988301045);
+  std::uniform_real_distribution<double> box(-40. * cm, 40. * cm);
+  std::uniform_real_distribution<double> move(-5. * cm, 5. * cm);
+  std::vector<G4Step*> steps;
+  int nShared = 0;
+  while ((int)steps.size() < nSteps) {
+    const G4ThreeVector pre(10. * cm + box(rng), -5. * cm + box(rng), 30. * cm + box(rng));
+    navigator.LocateGlobalPointAndSetup(pre, nullptr, false);
+    G4TouchableHandle preTouchable = navigator.CreateTouchableHistoryHandle();
+    if (!inFiber(preTouchable))
+      continue;
+    const G4ThreeVector post = pre + G4ThreeVector(move(rng), move(rng), move(rng));
+    navigator.LocateGlobalPointAndSetup(post, nullptr, false);
+    G4TouchableHandle postTouchable = navigator.CreateTouchableHistoryHandle();
+    if (!inFiber(postTouchable))
+      continue;
+    if (postTouchable->GetVolume() == preTouchable->GetVolume()) {
+      postTouchable = preTouchable;
+      nShared++;
+    }
+
+    auto* step = new G4Step();
+    step->GetPreStepPoint()->SetPosition(pre);
+    step->GetPreStepPoint()->SetTouchableHandle(preTouchable);
+    step->GetPostStepPoint()->SetPosition(post);
+    step->GetPostStepPoint()->SetTouchableHandle(postTouchable);
+    steps.push_back(step);
+  }
+
+  int mismatches = 0;
+  for (const G4Step* step : steps) {
+    G4double distance = 0.;
+    mismatches += DRTubesSglHpr::IsReflectedForward(step, distance) != formerIsReflectedForward(step);
+    mismatches += distance != formerDistanceToSiPM(step, true);
+    mismatches += DRTubesSglHpr::GetDistanceToSiPM(step) != formerDistanceToSiPM(step, true);
+    mismatches += DRTubesSglHpr::GetDistanceToSiPM(step, false) != formerDistanceToSiPM(step, false);
+    mismatches += !sameBits(DRTubesSglHpr::CalculateFiberPosition(step), formerFiberPosition(step));
+  }
+  test(mismatches, 0, "fiber distances, directions and positions identical to the former helpers");
+  test(nShared > 0 && nShared < nSteps, "steps with shared and distinct touchables");
+
+  // Per step as in DRTubesSDAction for a Cherenkov photon: direction and distance to the SiPM
+  int forward = 0;
+  double distances = 0.;
+  const auto formerStart = std::chrono::steady_clock::now();
+  for (const G4Step* step : steps) {
+    if (formerIsReflectedForward(step)) {
+      forward++;
+      distances += formerDistanceToSiPM(step, true);
+    }
+  }
+  const double nsFormer =
+      std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - formerStart).count() / nSteps;
+  const auto cachedStart = std::chrono::steady_clock::now();
+  for (const G4Step* step : steps) {
+    G4double distance = 0.;
+    if (DRTubesSglHpr::IsReflectedForward(step, distance)) {
+      forward--;
+      distances -= distance;
+    }
+  }
+  const double nsCached =
+      std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - cachedStart).count() / nSteps;
+  test(forward, 0, "same photons reflected forward");
+
+  std::cout << std::setw(12) << "steps" << std::setw(12) << "shared" << std::setw(16) << "former ns"
+            << std::setw(16) << "cached ns" << std::endl;
+  std::cout << std::setw(12) << nSteps << std::setw(12) << nShared << std::setw(16) << nsFormer << std::setw(16)
+            << nsCached << "   (" << distances << ")" << std::endl;
+
+  for (G4Step* step : steps)
+    delete step;
+  return 0;
+}
@@ -0,0 +1,74 @@
+// VolumeIDs of the DRTubesSDAction composed with the cached shifts and masks, checked against the
+// BitFieldCoder::set calls by field name they replace, for the endcap and barrel descriptors over
+// random values covering the range of each field, including the negative towers and columns of the barrel
+//
+// Usage: DRTubesVolIDTest [nVolIDs]
+
+#include "DRTubesVolID.hh"
+
+#include <DD4hep/DDTest.h>
+#include <DDSegmentation/BitFieldCoder.h>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+static dd4hep::DDTest test("DRTubesVolIDTest");
+
+using dd4hep::DDSegmentation::BitFieldCoder;
+using dd4hep::DDSegmentation::CellID;
+
+int main(int argc, char** args) {
+
+  const int nVolIDs = argc > 1 ? std::stoi(args[1]) : 1000000;
+  const char* names[9] = {"system", "stave", "tower", "air", "col", "row", "clad", "core", "cherenkov"};
+
+  std::mt19937_64 rng(1988301045);
+  for (const std::string descriptor : {"system:5,stave:10,tower:6,air:1,col:16,row:16,clad:1,core:1,cherenkov:1",
+                                       "system:5,stave:10,tower:-8,air:6,col:-16,row:16,clad:1,core:1,cherenkov:1"}) {
+    const DRTubesVolID volID(descriptor);
+
+    // Random values in the range of each field
+    std::vector<long long> values(9 * nVolIDs);
+    {
+      const BitFieldCoder coder(descriptor);
+      for (int f = 0; f < 9; f++) {
+        const auto& element = coder[names[f]];
+        std::uniform_int_distribution<long long> range(element.minValue(), element.maxValue());
+        for (int i = 0; i < nVolIDs; i++)
+          values[9 * i + f] = range(rng);
+      }
+    }
+
+    // The former code path, with a new BitFieldCoder per VolumeID
+    std::vector<CellID> expected(nVolIDs);
+    const auto coderStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < nVolIDs; i++) {
+      CellID VolID = 0;
+      BitFieldCoder bc(descriptor);
+      for (int f = 0; f < 9; f++)
+        bc.set(VolID, names[f], values[9 * i + f]);
+      expected[i] = VolID;
+    }
+    const double nsCoder =
+        std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - coderStart).count() / nVolIDs;
+
+    int mismatches = 0;
+    const auto composeStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < nVolIDs; i++) {
+      const long long* v = &values[9 * i];
+      mismatches += volID.Compose(v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7], v[8]) != expected[i];
+    }
+    const double nsCompose =
+        std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - composeStart).count() / nVolIDs;
+
+    test(mismatches, 0, "VolumeIDs identical to BitFieldCoder::set for " + descriptor);
+    std::cout << std::setw(16) << "BitFieldCoder" << std::setw(12) << nsCoder << " ns" << std::endl;
+    std::cout << std::setw(16) << "DRTubesVolID" << std::setw(12) << nsCompose << " ns" << std::endl;
+  }
+
+  return 0;
+}
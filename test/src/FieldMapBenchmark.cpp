@@ -0,0 +1,895 @@
+// Microbenchmark of the field map lookups on a synthetic grid, comparing the storage layouts
+// in ns/lookup for random and track-like query streams, and checking that they agree
+//
+// Usage: FieldMapBenchmark [nLookups] [nBins] [FieldXYZ map with the branches of the ILD maps]
+
+#include "FieldComposite.h"
+#include "FieldMapBrBz.h"
+#include "FieldMapRPhiZ.h"
+#include "FieldMapSimd.h"
+#include "FieldMapXYZ.h"
+
+#include <DD4hep/DD4hepUnits.h>
+#include <DD4hep/DDTest.h>
+
+#include <TFile.h>
+#include <TTree.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static dd4hep::DDTest test("FieldMapBenchmark");
+
+namespace {
+
+struct Point {
+  double x, y, z;
+};
+
+// Smooth solenoid-like field with some x-y asymmetry, so every component is non-trivial.
+// Without the asymmetry the field has the default mirror symmetries of FieldMapXYZ
+void analyticField(double x, double y, double z, double* B, double asymmetry = 0.01 * dd4hep::tesla) {
+  const double r2 = (x * x + y * y) / (3. * dd4hep::m * 3. * dd4hep::m);
+  const double zz = z / (4. * dd4hep::m);
+  const double Bz = 2. * dd4hep::tesla * std::exp(-r2 - zz * zz);
+  B[0] = Bz * zz * x / (3. * dd4hep::m) + asymmetry * y / dd4hep::m;
+  B[1] = Bz * zz * y / (3. * dd4hep::m);
+  B[2] = Bz;
+}
+
+// Tri-quadratic field, which the cubic interpolation reproduces up to rounding
+void quadraticField(double x, double y, double z, double* B) {
+  const double u = x / dd4hep::m;
+  const double v = y / dd4hep::m;
+  const double w = z / dd4hep::m;
+  B[0] = 0.01 * dd4hep::tesla * (u * u * v - 2. * u * w * w + 3. * v);
+  B[1] = 0.01 * dd4hep::tesla * (u * v * w + v * v - 1.);
+  B[2] = 0.01 * dd4hep::tesla * (u * u * v * v * w * w + 4. * w);
+}
+
+// Field values at the nodes of the grid of map
+template <typename Field> void sampleField(FieldMapXYZ& map, Field field) {
+  map.fieldMap.clear();
+  map.fieldMap.reserve(map.nX * map.nY * map.nZ);
+  for (int iz = 0; iz < map.nZ; iz++) {
+    for (int iy = 0; iy < map.nY; iy++) {
+      for (int ix = 0; ix < map.nX; ix++) {
+        double B[3];
+        field(map.xMin + ix * map.xStep, map.yMin + iy * map.yStep, map.zMin + iz * map.zStep, B);
+        map.fieldMap.push_back(FieldMapXYZ::FieldValues_t(B[0], B[1], B[2]));
+      }
+    }
+  }
+}
+
+void fillSyntheticMap(FieldMapXYZ& map, int nBins, double halfSize, double asymmetry = 0.01 * dd4hep::tesla,
+                      bool positiveOctant = false) {
+  map.nX = map.nY = map.nZ = nBins;
+  map.xMin = map.yMin = map.zMin = positiveOctant ? 0. : -halfSize;
+  map.xMax = map.yMax = map.zMax = halfSize;
+  map.xStep = map.yStep = map.zStep = (map.xMax - map.xMin) / (nBins - 1);
+  sampleField(map, [asymmetry](double x, double y, double z, double* B) { analyticField(x, y, z, B, asymmetry); });
+}
+
+// Same field as above, sampled in (rho, z) for z >= 0 along the x axis
+void fillSyntheticMap(FieldMapBrBz& map, int nBins, double halfSize) {
+  map.nRho = map.nZ = nBins;
+  map.rhoMin = map.zMin = 0.;
+  map.rhoMax = map.zMax = halfSize;
+  map.rhoStep = map.zStep = halfSize / (nBins - 1);
+  map.fieldMap.clear();
+  map.fieldMap.reserve(nBins * nBins);
+  for (int iz = 0; iz < nBins; iz++) {
+    for (int ir = 0; ir < nBins; ir++) {
+      double B[3];
+      analyticField(map.rhoMin + ir * map.rhoStep, 0., map.zMin + iz * map.zStep, B);
+      map.fieldMap.push_back(FieldMapBrBz::FieldValues_t(B[0], B[2]));
+    }
+  }
+}
+
+// Brho, Bphi and Bz of the same field with an azimuthal component and a dipole-like cos(phi) modulation of Bz
+void cylindricalField(double rho, double phi, double z, double* B) {
+  analyticField(rho, 0., z, B);
+  B[1] = 0.1 * B[2] * std::sin(phi);
+  B[2] *= 1. + 0.2 * std::cos(phi);
+}
+
+// Bx, By and Bz of cylindricalField
+void cartesianField(double x, double y, double z, double* B) {
+  const double phi = std::atan2(y, x);
+  double Bcyl[3];
+  cylindricalField(std::hypot(x, y), phi, z, Bcyl);
+  B[0] = Bcyl[0] * std::cos(phi) - Bcyl[1] * std::sin(phi);
+  B[1] = Bcyl[0] * std::sin(phi) + Bcyl[1] * std::cos(phi);
+  B[2] = Bcyl[2];
+}
+
+// cylindricalField sampled in (rho, phi, z) over the full turn
+void fillSyntheticMap(FieldMapRPhiZ& map, int nBins, double halfSize) {
+  map.nRho = map.nZ = nBins;
+  map.nPhi = 4 * (nBins / 2) + 4;
+  map.rhoMin = 0.;
+  map.rhoMax = halfSize;
+  map.rhoStep = halfSize / (nBins - 1);
+  map.zMin = -halfSize;
+  map.zMax = halfSize;
+  map.zStep = 2. * halfSize / (nBins - 1);
+  map.phiMin = -M_PI;
+  map.phiStep = 2. * M_PI / map.nPhi;
+  map.fieldMap.clear();
+  map.fieldMap.reserve(map.nRho * map.nPhi * map.nZ);
+  for (int iz = 0; iz < map.nZ; iz++) {
+    for (int ip = 0; ip < map.nPhi; ip++) {
+      for (int ir = 0; ir < map.nRho; ir++) {
+        double B[3];
+        cylindricalField(map.rhoMin + ir * map.rhoStep, map.phiMin + ip * map.phiStep, map.zMin + iz * map.zStep, B);
+        map.fieldMap.push_back(FieldMapRPhiZ::FieldValues_t(B[0], B[1], B[2]));
+      }
+    }
+  }
+  map.buildTables();
+}
+
+// Points uniformly distributed inside the map
+std::vector<Point> randomStream(int nPoints, double halfSize, std::mt19937_64& rng) {
+  std::uniform_real_distribution<double> flat(-halfSize, halfSize);
+  std::vector<Point> points(nPoints);
+  for (auto& p : points)
+    p = {flat(rng), flat(rng), flat(rng)};
+  return points;
+}
+
+// Points along helices from the origin with a few mm step length, as seen by a Geant4 stepper
+std::vector<Point> trackStream(int nPoints, double halfSize, std::mt19937_64& rng) {
+  std::uniform_real_distribution<double> flat(0., 1.);
+  std::vector<Point> points;
+  points.reserve(nPoints);
+  while (int(points.size()) < nPoints) {
+    const double phi0 = 2. * M_PI * flat(rng);
+    const double cosTheta = 2. * flat(rng) - 1.;
+    const double radius = (0.5 + 5. * flat(rng)) * dd4hep::m;
+    const double step = (1. + 4. * flat(rng)) * dd4hep::mm;
+    const double sinTheta = std::sqrt(1. - cosTheta * cosTheta);
+    for (double s = 0.; int(points.size()) < nPoints; s += step) {
+      const double alpha = s * sinTheta / radius;
+      const Point p = {radius * (std::sin(phi0 + alpha) - std::sin(phi0)),
+                       -radius * (std::cos(phi0 + alpha) - std::cos(phi0)), s * cosTheta};
+      if (std::fabs(p.x) > halfSize || std::fabs(p.y) > halfSize || std::fabs(p.z) > halfSize)
+        break;
+      points.push_back(p);
+    }
+  }
+  return points;
+}
+
+// Fraction of the lookups inside the cached cell, for maps queried one after the other at each point
+template <typename Map> double cacheHitRate(const std::vector<Map*>& maps, const std::vector<Point>& points) {
+  std::uint64_t lookups = 0;
+  std::uint64_t hits = 0;
+  for (const Map* map : maps) {
+    lookups -= map->cacheCounters->lookups;
+    hits -= map->cacheCounters->hits;
+  }
+  for (const auto& p : points) {
+    const double pos[3] = {p.x, p.y, p.z};
+    double B[3] = {0., 0., 0.};
+    for (Map* map : maps)
+      map->fieldComponents(pos, B);
+  }
+  for (const Map* map : maps) {
+    lookups += map->cacheCounters->lookups;
+    hits += map->cacheCounters->hits;
+  }
+  return lookups > 0 ? double(hits) / lookups : 0.;
+}
+
+template <typename Map>
+double nsPerLookup(Map& map, const std::vector<Point>& points, int nLookups, double& checksum) {
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < nLookups; i++) {
+    const Point& p = points[i & (points.size() - 1)];
+    const double pos[3] = {p.x, p.y, p.z};
+    double B[3] = {0., 0., 0.};
+    map.fieldComponents(pos, B);
+    checksum += B[0] + B[1] + B[2];
+  }
+  const auto stop = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(stop - start).count() / nLookups;
+}
+
+// Batch lookups in blocks of the size of a Runge-Kutta/helix sampling request
+template <typename Map>
+double nsPerBatchLookup(Map& map, const std::vector<Point>& points, int nLookups, double& checksum) {
+  const int blockSize = 64;
+  std::vector<double> x(blockSize), y(blockSize), z(blockSize), bx(blockSize), by(blockSize), bz(blockSize);
+  double elapsed = 0.;
+  for (int i = 0; i < nLookups; i += blockSize) {
+    for (int j = 0; j < blockSize; j++) {
+      const Point& p = points[(i + j) & (points.size() - 1)];
+      x[j] = p.x;
+      y[j] = p.y;
+      z[j] = p.z;
+      bx[j] = by[j] = bz[j] = 0.;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    map.batchFieldComponents(blockSize, x.data(), y.data(), z.data(), bx.data(), by.data(), bz.data());
+    const auto stop = std::chrono::steady_clock::now();
+    elapsed += std::chrono::duration<double, std::nano>(stop - start).count();
+    for (int j = 0; j < blockSize; j++)
+      checksum += bx[j] + by[j] + bz[j];
+  }
+  return elapsed / nLookups;
+}
+
+template <typename Map>
+double maxBatchDeviation(Map& map, const std::vector<Point>& points) {
+  const std::size_t n = points.size();
+  std::vector<double> x(n), y(n), z(n), bx(n, 0.), by(n, 0.), bz(n, 0.);
+  for (std::size_t i = 0; i < n; i++) {
+    x[i] = points[i].x;
+    y[i] = points[i].y;
+    z[i] = points[i].z;
+  }
+  map.batchFieldComponents(n, x.data(), y.data(), z.data(), bx.data(), by.data(), bz.data());
+  double maxDev = 0.;
+  for (std::size_t i = 0; i < n; i++) {
+    const double pos[3] = {x[i], y[i], z[i]};
+    double B[3] = {0., 0., 0.};
+    map.fieldComponents(pos, B);
+    maxDev = std::max(maxDev, std::fabs(bx[i] - B[0]));
+    maxDev = std::max(maxDev, std::fabs(by[i] - B[1]));
+    maxDev = std::max(maxDev, std::fabs(bz[i] - B[2]));
+  }
+  return maxDev;
+}
+
+// Largest deviation from the analytic field, and the maximum magnitude of its components
+template <typename Map, typename Field>
+double maxAnalyticDeviation(Map& map, Field field, const std::vector<Point>& points, double& peak) {
+  double maxDev = 0.;
+  peak = 0.;
+  for (const auto& p : points) {
+    const double pos[3] = {p.x, p.y, p.z};
+    double B0[3];
+    double B1[3] = {0., 0., 0.};
+    field(p.x, p.y, p.z, B0);
+    map.fieldComponents(pos, B1);
+    for (int k = 0; k < 3; k++) {
+      maxDev = std::max(maxDev, std::fabs(B1[k] - B0[k]));
+      peak = std::max(peak, std::fabs(B0[k]));
+    }
+  }
+  return maxDev;
+}
+
+// Every other node of fine, the removed nodes are used to measure the interpolation error on real maps
+void decimate(const FieldMapXYZ& fine, FieldMapXYZ& coarse) {
+  coarse.nX = (fine.nX + 1) / 2;
+  coarse.nY = (fine.nY + 1) / 2;
+  coarse.nZ = (fine.nZ + 1) / 2;
+  coarse.xMin = fine.xMin;
+  coarse.yMin = fine.yMin;
+  coarse.zMin = fine.zMin;
+  coarse.xStep = 2. * fine.xStep;
+  coarse.yStep = 2. * fine.yStep;
+  coarse.zStep = 2. * fine.zStep;
+  coarse.xMax = coarse.xMin + (coarse.nX - 1) * coarse.xStep;
+  coarse.yMax = coarse.yMin + (coarse.nY - 1) * coarse.yStep;
+  coarse.zMax = coarse.zMin + (coarse.nZ - 1) * coarse.zStep;
+  coarse.fieldMap.clear();
+  for (int iz = 0; iz < coarse.nZ; iz++)
+    for (int iy = 0; iy < coarse.nY; iy++)
+      for (int ix = 0; ix < coarse.nX; ix++)
+        coarse.fieldMap.push_back(fine.nodes()[2 * ix + 2 * iy * fine.nX + 2 * iz * fine.nX * fine.nY]);
+}
+
+// Largest deviation of coarse from the nodes of fine inside it, and the maximum magnitude of their components
+double maxNodeDeviation(const FieldMapXYZ& fine, FieldMapXYZ& coarse, double& peak) {
+  double maxDev = 0.;
+  peak = 0.;
+  for (int iz = 0; iz < fine.nZ; iz++) {
+    for (int iy = 0; iy < fine.nY; iy++) {
+      for (int ix = 0; ix < fine.nX; ix++) {
+        const double pos[3] = {fine.xMin + ix * fine.xStep, fine.yMin + iy * fine.yStep, fine.zMin + iz * fine.zStep};
+        if (pos[0] > coarse.xMax || pos[1] > coarse.yMax || pos[2] > coarse.zMax)
+          continue;
+        const FieldMapXYZ::FieldValues_t& B0 = fine.nodes()[ix + iy * fine.nX + iz * fine.nX * fine.nY];
+        double B1[3] = {0., 0., 0.};
+        coarse.fieldComponents(pos, B1);
+        maxDev = std::max({maxDev, std::fabs(B1[0] - B0.Bx), std::fabs(B1[1] - B0.By), std::fabs(B1[2] - B0.Bz)});
+        peak = std::max({peak, std::fabs(B0.Bx), std::fabs(B0.By), std::fabs(B0.Bz)});
+      }
+    }
+  }
+  return maxDev;
+}
+
+double maxDeviation(FieldMapXYZ& reference, FieldMapXYZ& map, const std::vector<Point>& points) {
+  double maxDev = 0.;
+  for (const auto& p : points) {
+    const double pos[3] = {p.x, p.y, p.z};
+    double B0[3] = {0., 0., 0.};
+    double B1[3] = {0., 0., 0.};
+    reference.fieldComponents(pos, B0);
+    map.fieldComponents(pos, B1);
+    for (int k = 0; k < 3; k++)
+      maxDev = std::max(maxDev, std::fabs(B1[k] - B0[k]));
+  }
+  return maxDev;
+}
+
+// Reference copy of FieldMapBrBz::fieldComponents with the rotation through atan2, sin and cos
+void atan2BrBzField(const FieldMapBrBz& map, const double* pos, double* globalField) {
+  double r = std::sqrt(pos[0] * pos[0] + pos[1] * pos[1]);
+  double z = pos[2];
+  double phi = std::atan2(pos[1], pos[0]);
+  if (z < 0) {
+    z *= -1;
+    phi += M_PI;
+  }
+  r = std::max(r, map.rhoMin);
+  z = std::max(z, map.zMin);
+  if (not(r <= map.rhoMax && z <= map.zMax))
+    return;
+
+  int rBin = int((r - map.rhoMin) / map.rhoStep);
+  int zBin = int((z - map.zMin) / map.zStep);
+  double r0 = map.rhoMin + rBin * map.rhoStep;
+  double z0 = map.zMin + zBin * map.zStep;
+  if (r0 > r) {
+    r0 -= map.rhoStep;
+    rBin -= 1;
+  }
+  if (z0 > z) {
+    z0 -= map.zStep;
+    zBin -= 1;
+  }
+  const double rd = (r - r0) / map.rhoStep;
+  const double zd = (z - z0) / map.zStep;
+  const int rBin1 = std::min(rBin + 1, map.nRho - 1);
+  const int zBin1 = std::min(zBin + 1, map.nZ - 1);
+  const FieldMapBrBz::FieldValues_t* nodes = map.nodes();
+  const FieldMapBrBz::FieldValues_t& B00 = nodes[rBin + zBin * map.nRho];
+  const FieldMapBrBz::FieldValues_t& B10 = nodes[rBin1 + zBin * map.nRho];
+  const FieldMapBrBz::FieldValues_t& B01 = nodes[rBin + zBin1 * map.nRho];
+  const FieldMapBrBz::FieldValues_t& B11 = nodes[rBin1 + zBin1 * map.nRho];
+  const double Br = (1 - rd) * (1 - zd) * B00.Br + rd * (1 - zd) * B10.Br + (1 - rd) * zd * B01.Br + rd * zd * B11.Br;
+  const double Bz = (1 - rd) * (1 - zd) * B00.Bz + rd * (1 - zd) * B10.Bz + (1 - rd) * zd * B01.Bz + rd * zd * B11.Bz;
+  globalField[0] += Br * std::sin(phi);
+  globalField[1] += Br * std::cos(phi);
+  globalField[2] += Bz;
+}
+
+struct Atan2BrBz {
+  const FieldMapBrBz& map;
+  void fieldComponents(const double* pos, double* B) { atan2BrBzField(map, pos, B); }
+};
+
+// Tree with the nodes of cylindricalField, the fastest changing coordinate first in order (e.g. "RPZ"). The nodes
+// are in cm and in phiUnits, the field in tesla
+void writeRPhiZTree(const std::string& filename, const std::string& order, const std::vector<double>& rhoNodes,
+                    const std::vector<double>& phiNodes, const std::vector<double>& zNodes, double phiUnits) {
+  TFile* file = TFile::Open(filename.c_str(), "RECREATE");
+  TTree* tree = new TTree("ntuple", "ntuple");
+  const std::string names[6] = {"rho", "phi", "z", "Brho", "Bphi", "Bz"};
+  float values[6];
+  for (int k = 0; k < 6; k++)
+    tree->Branch(names[k].c_str(), &values[k], (names[k] + "/F").c_str());
+
+  const std::vector<double>* nodes[3] = {&rhoNodes, &phiNodes, &zNodes};
+  int axis[3];
+  for (int k = 0; k < 3; k++)
+    axis[k] = std::string("RPZ").find(order[k]);
+  int bin[3];
+  for (bin[axis[2]] = 0; bin[axis[2]] < int(nodes[axis[2]]->size()); bin[axis[2]]++) {
+    for (bin[axis[1]] = 0; bin[axis[1]] < int(nodes[axis[1]]->size()); bin[axis[1]]++) {
+      for (bin[axis[0]] = 0; bin[axis[0]] < int(nodes[axis[0]]->size()); bin[axis[0]]++) {
+        double B[3];
+        cylindricalField(rhoNodes[bin[0]] * dd4hep::cm, phiNodes[bin[1]] * phiUnits, zNodes[bin[2]] * dd4hep::cm, B);
+        for (int k = 0; k < 3; k++) {
+          values[k] = (*nodes[k])[bin[k]];
+          values[k + 3] = B[k] / dd4hep::tesla;
+        }
+        tree->Fill();
+      }
+    }
+  }
+  file->Write();
+  file->Close();
+  delete file;
+}
+
+// Largest deviation from cylindricalField of the nodes of the map read from a tree of writeRPhiZTree, which must
+// have nPhi distinct phi nodes, the tree values are in single precision
+double loadedRPhiZDeviation(const std::string& filename, double phiUnits, int nPhi) {
+  FieldMapRPhiZ map;
+  map.ntupleName = "ntuple";
+  map.rhoVar = "rho";
+  map.phiVar = "phi";
+  map.zVar = "z";
+  map.BrhoVar = "Brho";
+  map.BphiVar = "Bphi";
+  map.BzVar = "Bz";
+  map.bScale = 1.;
+  map.fillFieldMapFromTree(filename, dd4hep::cm, phiUnits, dd4hep::tesla);
+  if (map.nPhi != nPhi || std::fabs(map.phiStep * nPhi - 2. * M_PI) > 1e-12)
+    return dd4hep::tesla;
+
+  double maxDev = 0.;
+  for (int iz = 0; iz < map.nZ; iz++) {
+    for (int ip = 0; ip < map.nPhi; ip++) {
+      for (int ir = 0; ir < map.nRho; ir++) {
+        double B[3];
+        cylindricalField(map.rhoMin + ir * map.rhoStep, map.phiMin + ip * map.phiStep, map.zMin + iz * map.zStep, B);
+        const auto& node = map.fieldMap[ir + ip * map.nRho + iz * map.nRho * map.nPhi];
+        maxDev = std::max(
+            {maxDev, std::fabs(node.Brho - B[0]), std::fabs(node.Bphi - B[1]), std::fabs(node.Bz - B[2])});
+      }
+    }
+  }
+  return maxDev;
+}
+
+// Sum of all fields and of the fallback outside all of them, as without the grid index
+void sumOfFields(FieldComposite& composite, const double* pos, double* B) {
+  for (auto& field : composite.fields)
+    field->fieldComponents(pos, B);
+  bool insideMap = false;
+  for (const auto& box : composite.boxes)
+    insideMap |= box.contains(pos);
+  for (int k = 0; k < 3 && not insideMap; k++)
+    B[k] += composite.fallbackField[k];
+}
+
+} // namespace
+
+int main(int argc, char** args) {
+
+  const int nLookups = argc > 1 ? std::stoi(args[1]) : 10000000;
+  const int nBins = argc > 2 ? std::stoi(args[2]) : 101;
+  const double halfSize = 5. * dd4hep::m;
+  const int nPoints = 1 << 20;
+
+  std::mt19937_64 rng(1988301045);
+  const std::vector<Point> randomPoints = randomStream(nPoints, halfSize, rng);
+  const std::vector<Point> trackPoints = trackStream(nPoints, halfSize, rng);
+
+  FieldMapXYZ reference;
+  fillSyntheticMap(reference, nBins, halfSize);
+
+  FieldMapXYZ packedDouble;
+  fillSyntheticMap(packedDouble, nBins, halfSize);
+  packedDouble.usePackedCells = true;
+  packedDouble.buildPackedCells();
+
+  FieldMapXYZ packedFloat;
+  fillSyntheticMap(packedFloat, nBins, halfSize);
+  packedFloat.usePackedCells = true;
+  packedFloat.floatStorage = true;
+  packedFloat.buildPackedCells();
+
+  // Tolerances relative to the 2 tesla peak field: rounding only for doubles, single precision for floats
+  const double peak = 2. * dd4hep::tesla;
+  std::stringstream msg;
+  msg << "packed cells (double) agree with fieldMap within " << 1e-12 * peak / dd4hep::tesla << " tesla";
+  test(maxDeviation(reference, packedDouble, randomPoints) < 1e-12 * peak, msg.str());
+  msg.str("");
+  msg << "packed cells (float) agree with fieldMap within " << 1e-6 * peak / dd4hep::tesla << " tesla";
+  test(maxDeviation(reference, packedFloat, randomPoints) < 1e-6 * peak, msg.str());
+
+  // Mirror symmetries: the positive octant of a symmetric field reflected in x, y and z, sharing the
+  // nodes of the full map (odd nBins), in double and single precision
+  const int nBinsOctant = (nBins | 1) / 2 + 1;
+  FieldMapXYZ symmetricReference;
+  fillSyntheticMap(symmetricReference, 2 * nBinsOctant - 1, halfSize, 0.);
+  FieldMapXYZ octantDouble;
+  FieldMapXYZ octantFloat;
+  for (FieldMapXYZ* octant : {&octantDouble, &octantFloat}) {
+    fillSyntheticMap(*octant, nBinsOctant, halfSize, 0., true);
+    octant->hasSymmetry = true;
+    octant->mirror[0] = octant->mirror[1] = octant->mirror[2] = true;
+  }
+  octantFloat.floatStorage = true;
+  octantFloat.buildStorage();
+  msg.str("");
+  msg << "mirrored octant (double) agrees with the full map within " << 1e-12 * peak / dd4hep::tesla << " tesla";
+  test(maxDeviation(symmetricReference, octantDouble, randomPoints) < 1e-12 * peak, msg.str());
+  msg.str("");
+  msg << "mirrored octant (float) agrees with the full map within " << 1e-6 * peak / dd4hep::tesla << " tesla";
+  test(maxDeviation(symmetricReference, octantFloat, randomPoints) < 1e-6 * peak, msg.str());
+
+  // Batch API, see detector/other/FieldMapSimd.h for the tolerance and the choice of the instruction set
+  std::cout << "batch kernels: " << FieldMapSimd::isaName() << std::endl;
+  FieldMapBrBz referenceBrBz;
+  fillSyntheticMap(referenceBrBz, nBins, halfSize);
+  msg.str("");
+  msg << "FieldMapXYZ batch agrees with fieldComponents within " << 1e-12 * peak / dd4hep::tesla << " tesla";
+  test(maxBatchDeviation(reference, randomPoints) < 1e-12 * peak, msg.str());
+  msg.str("");
+  msg << "FieldMapBrBz batch agrees with fieldComponents within " << 1e-12 * peak / dd4hep::tesla << " tesla";
+  test(maxBatchDeviation(referenceBrBz, randomPoints) < 1e-12 * peak, msg.str());
+
+  // FieldMapBrBz rotation without atan2, sin and cos, on a dense grid covering both z signs, the z axis
+  // and the points just outside the map
+  double maxRotationDev = 0.;
+  const int nGrid = 161;
+  const double gridHalfSize = 1.05 * halfSize;
+  for (int ix = 0; ix < nGrid; ix++) {
+    for (int iy = 0; iy < nGrid; iy++) {
+      for (int iz = 0; iz < nGrid; iz++) {
+        const double pos[3] = {-gridHalfSize + 2. * gridHalfSize * ix / (nGrid - 1),
+                               -gridHalfSize + 2. * gridHalfSize * iy / (nGrid - 1),
+                               -gridHalfSize + 2. * gridHalfSize * iz / (nGrid - 1)};
+        double B0[3] = {0., 0., 0.};
+        double B1[3] = {0., 0., 0.};
+        atan2BrBzField(referenceBrBz, pos, B0);
+        referenceBrBz.fieldComponents(pos, B1);
+        for (int k = 0; k < 3; k++)
+          maxRotationDev = std::max(maxRotationDev, std::fabs(B1[k] - B0[k]));
+      }
+    }
+  }
+  msg.str("");
+  msg << "FieldMapBrBz agrees with the atan2 rotation within " << 1e-12 * peak / dd4hep::tesla << " tesla";
+  test(maxRotationDev < 1e-12 * peak, msg.str());
+
+  // Composite of a solenoid, four small quadrupole-like maps and a dipole-like map along z, with a fallback field
+  FieldComposite composite;
+  FieldMapBrBz* solenoid = new FieldMapBrBz();
+  fillSyntheticMap(*solenoid, nBins, 0.5 * halfSize);
+  composite.add(solenoid);
+  for (int i = 0; i < 4; i++) {
+    FieldMapXYZ* quadrupole = new FieldMapXYZ();
+    fillSyntheticMap(*quadrupole, 11, 0.1 * halfSize);
+    const double zOffset = (i < 2 ? -1. : 1.) * (0.6 + 0.2 * (i % 2)) * halfSize;
+    quadrupole->zMin += zOffset;
+    quadrupole->zMax += zOffset;
+    composite.add(quadrupole);
+  }
+  FieldMapRPhiZ* dipole = new FieldMapRPhiZ();
+  fillSyntheticMap(*dipole, 11, 0.1 * halfSize);
+  dipole->zMin += 0.9 * halfSize;
+  dipole->zMax += 0.9 * halfSize;
+  composite.add(dipole);
+  composite.hasFallback = true;
+  composite.fallbackField[2] = 0.5 * dd4hep::tesla;
+  composite.buildIndex(16);
+
+  double maxCompositeDev = 0.;
+  for (const auto& p : randomPoints) {
+    const double pos[3] = {p.x, p.y, p.z};
+    double B0[3] = {0., 0., 0.};
+    double B1[3] = {0., 0., 0.};
+    sumOfFields(composite, pos, B0);
+    composite.fieldComponents(pos, B1);
+    for (int k = 0; k < 3; k++)
+      maxCompositeDev = std::max(maxCompositeDev, std::fabs(B1[k] - B0[k]));
+  }
+  test(maxCompositeDev == 0., "FieldComposite agrees with the sum of its fields");
+  test(composite.unboundedFields.empty(), "FieldComposite knows the bounding boxes of all the field maps");
+
+  // FieldMapRPhiZ: lookups after a far away point (atan2 for the phi bin) or after the previous point
+  // of the track (cached phi bin) give the same field
+  FieldMapRPhiZ mapRPhiZ;
+  fillSyntheticMap(mapRPhiZ, nBins, halfSize);
+  double maxRPhiZDev = 0.;
+  for (const auto& p : trackPoints) {
+    const double pos[3] = {p.x, p.y, p.z};
+    const double farPos[3] = {-p.x, -p.y, p.z};
+    double B0[3] = {0., 0., 0.};
+    double B1[3] = {0., 0., 0.};
+    mapRPhiZ.fieldComponents(pos, B0);
+    mapRPhiZ.fieldComponents(farPos, B1);
+    for (int k = 0; k < 3; k++)
+      B1[k] = 0.;
+    mapRPhiZ.fieldComponents(pos, B1);
+    for (int k = 0; k < 3; k++)
+      maxRPhiZDev = std::max(maxRPhiZDev, std::fabs(B1[k] - B0[k]));
+  }
+  test(maxRPhiZDev == 0., "FieldMapRPhiZ cached and computed phi bins agree");
+
+  // FieldMapRPhiZ against the analytic field inside its cylinder, the deviation of the linear interpolation
+  // drops by about 4 when the step-sizes are halved
+  std::vector<Point> cylinderPoints;
+  for (const auto& p : randomPoints)
+    if (p.x * p.x + p.y * p.y < halfSize * halfSize)
+      cylinderPoints.push_back(p);
+  FieldMapRPhiZ coarseRPhiZ;
+  fillSyntheticMap(coarseRPhiZ, (nBins - 1) / 2 + 1, halfSize);
+  double cylindricalPeak = 0.;
+  const double coarseRPhiZDev = maxAnalyticDeviation(coarseRPhiZ, cartesianField, cylinderPoints, cylindricalPeak);
+  const double rphizDev = maxAnalyticDeviation(mapRPhiZ, cartesianField, cylinderPoints, cylindricalPeak);
+  std::cout << "FieldMapRPhiZ deviation from the analytic field relative to the peak field: "
+            << coarseRPhiZDev / cylindricalPeak << " (" << coarseRPhiZ.nRho << " rho nodes), "
+            << rphizDev / cylindricalPeak << " (" << mapRPhiZ.nRho << " rho nodes)" << std::endl;
+  msg.str("");
+  msg << "FieldMapRPhiZ agrees with the analytic field within " << 0.1 * std::pow(10. / nBins, 2)
+      << " of the peak field, with second order convergence";
+  test(rphizDev < 0.1 * std::pow(10. / nBins, 2) * cylindricalPeak && rphizDev < coarseRPhiZDev / 3., msg.str());
+
+  // FieldMapRPhiZ rotation of (Brho, Bphi) to (Bx, By) without atan2, sin and cos, on uniform radial, azimuthal
+  // and axial fields, which the interpolation reproduces up to rounding
+  FieldMapRPhiZ uniformRPhiZ;
+  fillSyntheticMap(uniformRPhiZ, 11, halfSize);
+  const double uniformB[3] = {1. * dd4hep::tesla, 0.5 * dd4hep::tesla, 2. * dd4hep::tesla};
+  for (auto& node : uniformRPhiZ.fieldMap)
+    node = FieldMapRPhiZ::FieldValues_t(uniformB[0], uniformB[1], uniformB[2]);
+  auto uniformField = [&uniformB](double x, double y, double, double* B) {
+    const double phi = std::atan2(y, x);
+    B[0] = uniformB[0] * std::cos(phi) - uniformB[1] * std::sin(phi);
+    B[1] = uniformB[0] * std::sin(phi) + uniformB[1] * std::cos(phi);
+    B[2] = uniformB[2];
+  };
+  double uniformPeak = 0.;
+  msg.str("");
+  msg << "FieldMapRPhiZ agrees with the atan2 rotation within " << 1e-12 * peak / dd4hep::tesla << " tesla";
+  test(maxAnalyticDeviation(uniformRPhiZ, uniformField, cylinderPoints, uniformPeak) < 1e-12 * peak, msg.str());
+
+  // FieldMapRPhiZ tree loader: full turns with or without the node at 2 pi, in rad or deg, for several orders of
+  // the coordinates and of their nodes. Maps not covering a full turn are rejected
+  std::vector<double> rhoNodes, zNodes;
+  for (int i = 0; i < 6; i++)
+    rhoNodes.push_back(20. * i);
+  for (int i = 0; i < 5; i++)
+    zNodes.push_back(-100. + 50. * i);
+  const std::vector<double> rhoDescending(rhoNodes.rbegin(), rhoNodes.rend());
+  const std::vector<double> zDescending(zNodes.rbegin(), zNodes.rend());
+  std::vector<double> phiClosedRad, phiClosedDescending, phiOpenDescending, phiHalfTurn;
+  for (int i = 0; i <= 12; i++)
+    phiClosedRad.push_back(-M_PI + i * M_PI / 6.);
+  for (int i = 24; i >= 0; i--)
+    phiClosedDescending.push_back(15. * i);
+  for (int i = 23; i >= 0; i--)
+    phiOpenDescending.push_back(15. * i);
+  for (int i = 0; i <= 6; i++)
+    phiHalfTurn.push_back(30. * i);
+
+  const std::string treeFile = "FieldMapBenchmark_RPhiZ.root";
+  writeRPhiZTree(treeFile, "RPZ", rhoNodes, phiClosedRad, zNodes, dd4hep::rad);
+  test(loadedRPhiZDeviation(treeFile, dd4hep::rad, 12) < 1e-5 * dd4hep::tesla,
+       "FieldMapRPhiZ loads an RPZ tree with the node at 2 pi, in rad");
+  writeRPhiZTree(treeFile, "PZR", rhoNodes, phiClosedDescending, zDescending, dd4hep::deg);
+  test(loadedRPhiZDeviation(treeFile, dd4hep::deg, 24) < 1e-5 * dd4hep::tesla,
+       "FieldMapRPhiZ loads a PZR tree with the node at 2 pi, in deg, phi and z from high to low");
+  writeRPhiZTree(treeFile, "ZPR", rhoDescending, phiOpenDescending, zNodes, dd4hep::deg);
+  test(loadedRPhiZDeviation(treeFile, dd4hep::deg, 24) < 1e-5 * dd4hep::tesla,
+       "FieldMapRPhiZ loads a ZPR tree without the node at 2 pi, in deg, rho and phi from high to low");
+  writeRPhiZTree(treeFile, "RZP", rhoNodes, phiHalfTurn, zNodes, dd4hep::deg);
+  bool rejected = false;
+  try {
+    loadedRPhiZDeviation(treeFile, dd4hep::deg, 6);
+  } catch (const std::runtime_error&) {
+    rejected = true;
+  }
+  test(rejected, "FieldMapRPhiZ rejects a tree covering half a turn");
+  std::remove(treeFile.c_str());
+
+  // Thread-local cell cache: a hit uses the corners of the previous lookup, the result must not change,
+  // neither on the track points (mostly hits) nor on the random points (mostly misses)
+  FieldMapXYZ cachedXYZ;
+  fillSyntheticMap(cachedXYZ, nBins, halfSize);
+  cachedXYZ.useCellCache = true;
+  FieldMapBrBz cachedBrBz;
+  fillSyntheticMap(cachedBrBz, nBins, halfSize);
+  cachedBrBz.useCellCache = true;
+  double maxCachedDevXYZ = 0.;
+  double maxCachedDevBrBz = 0.;
+  for (const auto* points : {&trackPoints, &randomPoints}) {
+    for (const auto& p : *points) {
+      const double pos[3] = {p.x, p.y, p.z};
+      double B0[3] = {0., 0., 0.};
+      double B1[3] = {0., 0., 0.};
+      double B2[3] = {0., 0., 0.};
+      double B3[3] = {0., 0., 0.};
+      reference.fieldComponents(pos, B0);
+      cachedXYZ.fieldComponents(pos, B1);
+      referenceBrBz.fieldComponents(pos, B2);
+      cachedBrBz.fieldComponents(pos, B3);
+      for (int k = 0; k < 3; k++) {
+        maxCachedDevXYZ = std::max(maxCachedDevXYZ, std::fabs(B1[k] - B0[k]));
+        maxCachedDevBrBz = std::max(maxCachedDevBrBz, std::fabs(B3[k] - B2[k]));
+      }
+    }
+  }
+  msg.str("");
+  msg << "FieldMapXYZ cell cache agrees with fieldMap within " << 1e-12 * peak / dd4hep::tesla << " tesla";
+  test(maxCachedDevXYZ < 1e-12 * peak, msg.str());
+  test(maxCachedDevBrBz == 0., "FieldMapBrBz cell cache agrees with fieldMap");
+
+  // Maps queried alternately, as the overlapping maps of a FieldComposite, keep their own cells: the hit rate on
+  // the track points is the one of a single map
+  FieldMapXYZ cachedXYZ2;
+  fillSyntheticMap(cachedXYZ2, nBins, halfSize);
+  cachedXYZ2.useCellCache = true;
+  FieldMapBrBz cachedBrBz2;
+  fillSyntheticMap(cachedBrBz2, nBins, halfSize);
+  cachedBrBz2.useCellCache = true;
+  const double hitRateXYZ = cacheHitRate<FieldMapXYZ>({&cachedXYZ}, trackPoints);
+  const double hitRateBrBz = cacheHitRate<FieldMapBrBz>({&cachedBrBz}, trackPoints);
+  test(std::fabs(cacheHitRate<FieldMapXYZ>({&cachedXYZ, &cachedXYZ2}, trackPoints) - hitRateXYZ) < 0.01,
+       "alternated FieldMapXYZ maps keep the hit rate of a single map");
+  test(std::fabs(cacheHitRate<FieldMapBrBz>({&cachedBrBz, &cachedBrBz2}, trackPoints) - hitRateBrBz) < 0.01,
+       "alternated FieldMapBrBz maps keep the hit rate of a single map");
+
+  // Cubic interpolation is exact for tri-quadratic fields, as are its finite difference derivatives
+  FieldMapXYZ quadratic;
+  quadratic.nX = quadratic.nY = quadratic.nZ = 11;
+  quadratic.xMin = quadratic.yMin = quadratic.zMin = -halfSize;
+  quadratic.xMax = quadratic.yMax = quadratic.zMax = halfSize;
+  quadratic.xStep = quadratic.yStep = quadratic.zStep = 2. * halfSize / 10;
+  sampleField(quadratic, quadraticField);
+  quadratic.useCubic = true;
+  quadratic.buildStorage();
+  double quadraticPeak = 0.;
+  const double quadraticDev = maxAnalyticDeviation(quadratic, quadraticField, randomPoints, quadraticPeak);
+  test(quadraticDev < 1e-12 * quadraticPeak, "cubic interpolation reproduces a tri-quadratic field");
+
+  struct Layout {
+    std::string name;
+    FieldMapXYZ* map;
+  };
+  const std::vector<Layout> layouts = {
+      {"fieldMap", &reference},         {"packed double", &packedDouble}, {"packed float", &packedFloat},
+      {"octant double", &octantDouble}, {"octant float", &octantFloat}};
+
+  double checksum = 0.;
+  std::cout << std::endl << "grid " << nBins << "^3, " << nLookups << " lookups per stream" << std::endl;
+  std::cout << std::setw(16) << "layout" << std::setw(12) << "MB" << std::setw(16) << "random ns" << std::setw(16)
+            << "track ns" << std::endl;
+  for (const auto& layout : layouts) {
+    const double nsRandom = nsPerLookup(*layout.map, randomPoints, nLookups, checksum);
+    const double nsTrack = nsPerLookup(*layout.map, trackPoints, nLookups, checksum);
+    std::cout << std::setw(16) << layout.name << std::setw(12) << std::setprecision(4)
+              << layout.map->storageBytes() / (1024. * 1024.) << std::setw(16) << nsRandom << std::setw(16) << nsTrack
+              << std::endl;
+  }
+
+  // Memory vs. accuracy vs. time of the linear and cubic interpolations, for the analytic field on grids of
+  // decreasing step-size and, if given, for a FieldXYZ map decimated to every other node
+  std::cout << std::endl << "linear vs. cubic interpolation, deviation relative to the peak field" << std::endl;
+  std::cout << std::setw(16) << "grid" << std::setw(12) << "MB" << std::setw(16) << "linear dev" << std::setw(16)
+            << "cubic dev" << std::setw(16) << "linear track ns" << std::setw(16) << "cubic track ns" << std::endl;
+  for (const int n : {(nBins - 1) / 4 + 1, (nBins - 1) / 2 + 1, nBins}) {
+    FieldMapXYZ linear;
+    FieldMapXYZ cubic;
+    fillSyntheticMap(linear, n, halfSize);
+    fillSyntheticMap(cubic, n, halfSize);
+    cubic.useCubic = true;
+    cubic.buildStorage();
+    auto field = [](double x, double y, double z, double* B) { analyticField(x, y, z, B); };
+    double fieldPeak = 0.;
+    const double linearDev = maxAnalyticDeviation(linear, field, randomPoints, fieldPeak);
+    const double cubicDev = maxAnalyticDeviation(cubic, field, randomPoints, fieldPeak);
+    std::stringstream grid;
+    grid << n << "^3";
+    std::cout << std::setw(16) << grid.str() << std::setw(12) << std::setprecision(4)
+              << linear.storageBytes() / (1024. * 1024.) << " /" << std::setw(9)
+              << cubic.storageBytes() / (1024. * 1024.) << std::setw(16) << linearDev / fieldPeak << std::setw(16)
+              << cubicDev / fieldPeak << std::setw(16) << nsPerLookup(linear, trackPoints, nLookups, checksum)
+              << std::setw(16) << nsPerLookup(cubic, trackPoints, nLookups, checksum) << std::endl;
+  }
+  if (argc > 3) {
+    // Shipped maps, e.g. fieldmaps/ild_fieldMap_antiDID_10cm_v1_20170223.root
+    FieldMapXYZ shipped;
+    shipped.ntupleName = "ntuple";
+    shipped.xVar = "x_mm";
+    shipped.yVar = "y_mm";
+    shipped.zVar = "z_mm";
+    shipped.BxVar = "Bx";
+    shipped.ByVar = "By";
+    shipped.BzVar = "Bz";
+    shipped.bScale = 1.;
+    shipped.fillFieldMapFromTree(args[3], dd4hep::mm, dd4hep::tesla);
+    FieldMapXYZ linear;
+    FieldMapXYZ cubic;
+    decimate(shipped, linear);
+    decimate(shipped, cubic);
+    cubic.useCubic = true;
+    cubic.buildStorage();
+    double fieldPeak = 0.;
+    const double linearDev = maxNodeDeviation(shipped, linear, fieldPeak);
+    const double cubicDev = maxNodeDeviation(shipped, cubic, fieldPeak);
+    std::stringstream grid;
+    grid << linear.nX << "x" << linear.nY << "x" << linear.nZ;
+    std::cout << std::setw(16) << grid.str() << std::setw(12) << linear.storageBytes() / (1024. * 1024.) << " /"
+              << std::setw(9) << cubic.storageBytes() / (1024. * 1024.) << std::setw(16) << linearDev / fieldPeak
+              << std::setw(16) << cubicDev / fieldPeak << std::setw(16)
+              << nsPerLookup(linear, trackPoints, nLookups, checksum) << std::setw(16)
+              << nsPerLookup(cubic, trackPoints, nLookups, checksum) << "   " << args[3] << std::endl;
+  }
+
+  std::cout << std::endl
+            << "single lookups vs. batches of 64 points, " << FieldMapSimd::isaName() << " kernels" << std::endl;
+  std::cout << std::setw(16) << "map" << std::setw(16) << "random ns" << std::setw(16) << "track ns" << std::setw(16)
+            << "batch random" << std::setw(16) << "batch track" << std::endl;
+  std::cout << std::setw(16) << "FieldMapXYZ" << std::setw(16)
+            << nsPerLookup(reference, randomPoints, nLookups, checksum) << std::setw(16)
+            << nsPerLookup(reference, trackPoints, nLookups, checksum) << std::setw(16)
+            << nsPerBatchLookup(reference, randomPoints, nLookups, checksum) << std::setw(16)
+            << nsPerBatchLookup(reference, trackPoints, nLookups, checksum) << std::endl;
+  std::cout << std::setw(16) << "FieldMapBrBz" << std::setw(16)
+            << nsPerLookup(referenceBrBz, randomPoints, nLookups, checksum) << std::setw(16)
+            << nsPerLookup(referenceBrBz, trackPoints, nLookups, checksum) << std::setw(16)
+            << nsPerBatchLookup(referenceBrBz, randomPoints, nLookups, checksum) << std::setw(16)
+            << nsPerBatchLookup(referenceBrBz, trackPoints, nLookups, checksum) << std::endl;
+  Atan2BrBz atan2BrBz = {referenceBrBz};
+  std::cout << std::setw(16) << "BrBz with atan2" << std::setw(16)
+            << nsPerLookup(atan2BrBz, randomPoints, nLookups, checksum) << std::setw(16)
+            << nsPerLookup(atan2BrBz, trackPoints, nLookups, checksum) << std::endl;
+  std::cout << std::setw(16) << "FieldMapRPhiZ" << std::setw(16)
+            << nsPerLookup(mapRPhiZ, randomPoints, nLookups, checksum) << std::setw(16)
+            << nsPerLookup(mapRPhiZ, trackPoints, nLookups, checksum) << std::endl;
+
+  // The counters of the maps are updated every few thousand lookups, good enough for a hit rate
+  std::cout << std::endl << "thread-local cell cache" << std::endl;
+  std::cout << std::setw(16) << "map" << std::setw(16) << "random ns" << std::setw(16) << "random hits" << std::setw(16)
+            << "track ns" << std::setw(16) << "track hits" << std::endl;
+  auto printCached = [&](const char* name, auto& map) {
+    std::cout << std::setw(16) << name;
+    for (const auto* points : {&randomPoints, &trackPoints}) {
+      const std::uint64_t lookups0 = map.cacheCounters->lookups;
+      const std::uint64_t hits0 = map.cacheCounters->hits;
+      const double ns = nsPerLookup(map, *points, nLookups, checksum);
+      const std::uint64_t lookups = map.cacheCounters->lookups - lookups0;
+      const std::uint64_t hits = map.cacheCounters->hits - hits0;
+      std::cout << std::setw(16) << ns << std::setw(15) << (lookups > 0 ? 100. * hits / lookups : 0.) << "%";
+    }
+    std::cout << std::endl;
+  };
+  printCached("FieldMapXYZ", cachedXYZ);
+  printCached("FieldMapBrBz", cachedBrBz);
+
+  // Two cached maps of each type queried alternately, ns per lookup of one map
+  auto printAlternated = [&](const char* name, auto& map1, auto& map2) {
+    std::cout << std::setw(16) << name;
+    for (const auto* points : {&randomPoints, &trackPoints}) {
+      const std::uint64_t lookups0 = map1.cacheCounters->lookups + map2.cacheCounters->lookups;
+      const std::uint64_t hits0 = map1.cacheCounters->hits + map2.cacheCounters->hits;
+      const auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < nLookups; i++) {
+        const Point& p = (*points)[i & (points->size() - 1)];
+        const double pos[3] = {p.x, p.y, p.z};
+        double B[3] = {0., 0., 0.};
+        map1.fieldComponents(pos, B);
+        map2.fieldComponents(pos, B);
+        checksum += B[0] + B[1] + B[2];
+      }
+      const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+      const std::uint64_t lookups = map1.cacheCounters->lookups + map2.cacheCounters->lookups - lookups0;
+      const std::uint64_t hits = map1.cacheCounters->hits + map2.cacheCounters->hits - hits0;
+      std::cout << std::setw(16) << ns / (2. * nLookups) << std::setw(15) << (lookups > 0 ? 100. * hits / lookups : 0.)
+                << "%";
+    }
+    std::cout << std::endl;
+  };
+  printAlternated("2 x FieldMapXYZ", cachedXYZ, cachedXYZ2);
+  printAlternated("2 x FieldMapBrBz", cachedBrBz, cachedBrBz2);
+
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < nLookups; i++) {
+    const Point& p = trackPoints[i & (trackPoints.size() - 1)];
+    const double pos[3] = {p.x, p.y, p.z};
+    double B[3] = {0., 0., 0.};
+    sumOfFields(composite, pos, B);
+    checksum += B[0] + B[1] + B[2];
+  }
+  const double nsSum = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  std::cout << std::endl << "composite of " << composite.fields.size() << " maps, track ns" << std::endl;
+  std::cout << std::setw(16) << "all maps" << std::setw(16) << nsSum / nLookups << std::endl;
+  std::cout << std::setw(16) << "grid index" << std::setw(16) << nsPerLookup(composite, trackPoints, nLookups, checksum)
+            << std::endl;
+  std::cout << "checksum " << checksum << std::endl << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,176 @@
+// Test of the precomputed neighbour tables of the HCal segmentations FCCSWHCalPhiTheta_k4geo and
+// FCCSWHCalPhiRow_k4geo, in the ALLEGRO o1 v03 barrel and endcap configurations: the neighbours from the table,
+// also after writing it to a file and reading it back, are the ones computed by the segmentation for every cell.
+// Prints the time to build the tables and the time per neighbours call with and without them
+//
+// Usage: HCalNeighbourTableTest [tableFile]
+
+#include "detectorSegmentations/CellNeighbourTable_k4geo.h"
+#include "detectorSegmentations/FCCSWHCalPhiRow_k4geo.h"
+#include "detectorSegmentations/FCCSWHCalPhiTheta_k4geo.h"
+
+#include <DD4hep/DDTest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static dd4hep::DDTest test("HCalNeighbourTableTest");
+
+using dd4hep::DDSegmentation::CellID;
+using dd4hep::DDSegmentation::CellNeighbourTable_k4geo;
+using dd4hep::DDSegmentation::FCCSWHCalPhiRow_k4geo;
+using dd4hep::DDSegmentation::FCCSWHCalPhiTheta_k4geo;
+
+namespace {
+
+struct Configuration {
+  std::string name;
+  std::map<std::string, std::string> parameters;
+};
+
+const std::vector<Configuration> kConfigurations = {
+    {"barrel",
+     {{"detLayout", "0"},
+      {"offset_z", "0"},
+      {"width_z", "560"},
+      {"offset_r", "281.05"},
+      {"numLayers", "4 6 3"},
+      {"dRlayer", "5 10 20"},
+      {"offset_theta", "0.783406"},
+      {"dz_row", "1.8"},
+      {"grid_size_row", "1 1 1 1 1 1 1 1 1 1 1 1 1"}}},
+    {"endcap",
+     {{"detLayout", "1"},
+      {"offset_z", "315 365 467.5"},
+      {"width_z", "50 50 155"},
+      {"offset_r", "361.05 291.05 36.05"},
+      {"numLayers", "5 1 0 4 3 2 4 10 8"},
+      {"dRlayer", "10 15 25"},
+      {"offset_theta", "0.007106"},
+      {"dz_row", "1.8"},
+      {"grid_size_row", "1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1"}}}};
+
+template <typename SEGMENTATION>
+std::unique_ptr<SEGMENTATION> makeSegmentation(const std::string& encoding, const Configuration& configuration) {
+  auto segmentation = std::make_unique<SEGMENTATION>(encoding);
+  std::map<std::string, std::string> parameters = {
+      {"phi_bins", "256"}, {"offset_phi", "-3.129321"}, {"grid_size_theta", "0.022180"}};
+  parameters.insert(configuration.parameters.begin(), configuration.parameters.end());
+  for (auto* parameter : segmentation->parameters()) {
+    const auto value = parameters.find(parameter->name());
+    if (value != parameters.end())
+      parameter->setValue(value->second);
+  }
+  return segmentation;
+}
+
+double nsSince(const std::chrono::steady_clock::time_point& start, double n) {
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n;
+}
+
+/// Number of cells whose neighbours differ between the two functions, and their time per call
+long compare(const std::vector<uint64_t>& cells, const std::function<std::vector<uint64_t>(CellID)>& reference,
+             const std::function<std::vector<uint64_t>(CellID)>& tested, double& nsReference, double& nsTested) {
+  std::vector<std::vector<uint64_t>> expected, found;
+  expected.reserve(cells.size());
+  found.reserve(cells.size());
+  auto start = std::chrono::steady_clock::now();
+  for (const CellID cID : cells)
+    expected.push_back(reference(cID));
+  nsReference = nsSince(start, cells.size());
+  start = std::chrono::steady_clock::now();
+  for (const CellID cID : cells)
+    found.push_back(tested(cID));
+  nsTested = nsSince(start, cells.size());
+  long mismatches = 0;
+  for (std::size_t i = 0; i < cells.size(); i++)
+    mismatches += expected[i] != found[i];
+  return mismatches;
+}
+
+} // namespace
+
+int main(int argc, char** args) {
+
+  const std::string fileName = argc > 1 ? args[1] : "HCalNeighbourTableTest.bin";
+
+  std::cout << std::setw(22) << "readout" << std::setw(10) << "cells" << std::setw(12) << "neighbours"
+            << std::setw(10) << "build s" << std::setw(14) << "computed ns" << std::setw(12) << "table ns"
+            << std::endl;
+  for (const auto& configuration : kConfigurations) {
+    const bool endcap = configuration.name == "endcap";
+    const std::string typeField = endcap ? "type:3," : "";
+    CellID volumeID = 0;
+
+    for (const bool diagonal : {false, true}) {
+      // the segmentation computing the neighbours, and the one using the table read back from the file
+      auto computing = makeSegmentation<FCCSWHCalPhiTheta_k4geo>(
+          "system:4," + typeField + "layer:6,row:11,theta:11,phi:10", configuration);
+      auto tabulated = makeSegmentation<FCCSWHCalPhiTheta_k4geo>(
+          "system:4," + typeField + "layer:6,row:11,theta:11,phi:10", configuration);
+      computing->decoder()->set(volumeID, "system", 8);
+
+      auto start = std::chrono::steady_clock::now();
+      const auto table = computing->makeNeighbourTable(volumeID, diagonal);
+      const double buildTime = nsSince(start, 1e9);
+      auto readTable = std::make_shared<CellNeighbourTable_k4geo>();
+      test(table->write(fileName) && readTable->read(fileName), "neighbour table written and read back");
+      tabulated->setNeighbourTable(readTable, diagonal);
+
+      double nsComputed = 0., nsTable = 0.;
+      const long mismatches = compare(
+          computing->cellIDs(volumeID), [&](CellID cID) { return computing->neighbours(cID, diagonal); },
+          [&](CellID cID) { return tabulated->neighbours(cID, diagonal); }, nsComputed, nsTable);
+      std::stringstream msg;
+      msg << "FCCSWHCalPhiTheta_k4geo " << configuration.name << (diagonal ? " diagonal" : "")
+          << " neighbours from the table";
+      test(mismatches == 0 && readTable->numberOfCells() == table->numberOfCells() &&
+               readTable->numberOfNeighbours() == table->numberOfNeighbours(),
+           msg.str());
+      std::cout << std::setw(22) << "PhiTheta " + configuration.name + (diagonal ? " diag" : "") << std::setw(10)
+                << table->numberOfCells() << std::setw(12) << table->numberOfNeighbours() << std::setw(10)
+                << buildTime << std::setw(14) << nsComputed << std::setw(12) << nsTable << std::endl;
+    }
+
+    auto computing =
+        makeSegmentation<FCCSWHCalPhiRow_k4geo>("system:4," + typeField + "layer:6,row:-10,phi:10", configuration);
+    auto tabulated =
+        makeSegmentation<FCCSWHCalPhiRow_k4geo>("system:4," + typeField + "layer:6,row:-10,phi:10", configuration);
+    auto start = std::chrono::steady_clock::now();
+    const auto table = computing->makeNeighbourTable(volumeID);
+    const double buildTime = nsSince(start, 1e9);
+    auto readTable = std::make_shared<CellNeighbourTable_k4geo>();
+    test(table->write(fileName) && readTable->read(fileName), "neighbour table written and read back");
+    tabulated->setNeighbourTable(readTable);
+
+    double nsComputed = 0., nsTable = 0.;
+    const long mismatches = compare(
+        computing->cellIDs(volumeID), [&](CellID cID) { return computing->neighbours(cID); },
+        [&](CellID cID) { return tabulated->neighbours(cID); }, nsComputed, nsTable);
+    test(mismatches, 0L, "FCCSWHCalPhiRow_k4geo " + configuration.name + " neighbours from the table");
+    std::cout << std::setw(22) << "PhiRow " + configuration.name << std::setw(10) << table->numberOfCells()
+              << std::setw(12) << table->numberOfNeighbours() << std::setw(10) << buildTime << std::setw(14)
+              << nsComputed << std::setw(12) << nsTable << std::endl;
+  }
+
+  // A truncated file is not read
+  {
+    std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+    file << "K4GNBRS2 truncated";
+  }
+  CellNeighbourTable_k4geo table;
+  test(!table.read(fileName) && table.numberOfCells() == 0 && table.neighbours(1).empty(),
+       "truncated neighbour table file rejected");
+  std::remove(fileName.c_str());
+
+  return 0;
+}
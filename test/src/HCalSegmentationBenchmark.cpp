@@ -0,0 +1,194 @@
+// Microbenchmark of the HCal segmentations FCCSWHCalPhiTheta_k4geo and FCCSWHCalPhiRow_k4geo, in the ALLEGRO
+// o1 v03 barrel and endcap configurations: time per cellID call of the theta segmentation and per position and
+// cellTheta call of the row segmentation, for hits spread uniformly over the layers. Checks that cellID finds the
+// cell that a linear scan of the cell edges of the layer finds, and that the cell edges contain the cell positions
+//
+// Usage: HCalSegmentationBenchmark [nHits] [nRepetitions]
+
+#include "detectorSegmentations/FCCSWHCalPhiRow_k4geo.h"
+#include "detectorSegmentations/FCCSWHCalPhiTheta_k4geo.h"
+
+#include <DD4hep/DDTest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static dd4hep::DDTest test("HCalSegmentationBenchmark");
+
+using dd4hep::DDSegmentation::CellID;
+using dd4hep::DDSegmentation::Vector3D;
+
+namespace {
+
+/// Access to the cell tables of the segmentations
+struct PhiTheta : public dd4hep::DDSegmentation::FCCSWHCalPhiTheta_k4geo {
+  using FCCSWHCalPhiTheta_k4geo::cellEdges;
+  using FCCSWHCalPhiTheta_k4geo::FCCSWHCalPhiTheta_k4geo;
+  using FCCSWHCalPhiTheta_k4geo::m_layerEdges;
+  using FCCSWHCalPhiTheta_k4geo::m_radii;
+};
+
+struct PhiRow : public dd4hep::DDSegmentation::FCCSWHCalPhiRow_k4geo {
+  using FCCSWHCalPhiRow_k4geo::cellEdges;
+  using FCCSWHCalPhiRow_k4geo::FCCSWHCalPhiRow_k4geo;
+  using FCCSWHCalPhiRow_k4geo::m_layerEdges;
+  using FCCSWHCalPhiRow_k4geo::m_radii;
+};
+
+struct Configuration {
+  std::string name;
+  std::map<std::string, std::string> parameters;
+};
+
+const std::vector<Configuration> kConfigurations = {
+    {"barrel",
+     {{"detLayout", "0"},
+      {"offset_z", "0"},
+      {"width_z", "560"},
+      {"offset_r", "281.05"},
+      {"numLayers", "4 6 3"},
+      {"dRlayer", "5 10 20"},
+      {"offset_theta", "0.783406"},
+      {"dz_row", "1.8"},
+      {"grid_size_row", "1 1 1 1 1 1 1 1 1 1 1 1 1"}}},
+    {"endcap",
+     {{"detLayout", "1"},
+      {"offset_z", "315 365 467.5"},
+      {"width_z", "50 50 155"},
+      {"offset_r", "361.05 291.05 36.05"},
+      {"numLayers", "5 1 0 4 3 2 4 10 8"},
+      {"dRlayer", "10 15 25"},
+      {"offset_theta", "0.007106"},
+      {"dz_row", "1.8"},
+      {"grid_size_row", "1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1 1"}}}};
+
+template <typename SEGMENTATION>
+void configure(SEGMENTATION& segmentation, const Configuration& configuration) {
+  std::map<std::string, std::string> parameters = {
+      {"phi_bins", "256"}, {"offset_phi", "-3.129321"}, {"grid_size_theta", "0.022180"}};
+  parameters.insert(configuration.parameters.begin(), configuration.parameters.end());
+  for (auto* parameter : segmentation.parameters()) {
+    const auto value = parameters.find(parameter->name());
+    if (value != parameters.end())
+      parameter->setValue(value->second);
+  }
+}
+
+struct Hit {
+  CellID volumeID;
+  Vector3D position;
+};
+
+/// Hits at random z and phi in random layers, on both sides of the endcap
+template <typename SEGMENTATION>
+std::vector<Hit> makeHits(const SEGMENTATION& segmentation, int nHits, bool endcap, std::mt19937_64& rng) {
+  const auto nLayers = segmentation.m_radii.size();
+  std::uniform_int_distribution<unsigned> layerDistribution(0, nLayers - 1);
+  std::uniform_real_distribution<double> uniform(0., 1.);
+  std::vector<Hit> hits;
+  hits.reserve(nHits);
+  for (int i = 0; i < nHits; i++) {
+    const unsigned layer = layerDistribution(rng);
+    const auto& [zmin, zmax] = segmentation.m_layerEdges[layer];
+    double z = zmin + uniform(rng) * (zmax - zmin);
+    if (endcap && uniform(rng) < 0.5)
+      z = -z;
+    const double r = segmentation.m_radii[layer], phi = -M_PI + 2 * M_PI * uniform(rng);
+    CellID volumeID = 0;
+    segmentation.decoder()->set(volumeID, "system", 8);
+    segmentation.decoder()->set(volumeID, "layer", layer);
+    hits.push_back({volumeID, Vector3D(r * std::cos(phi), r * std::sin(phi), z)});
+  }
+  return hits;
+}
+
+double nsSince(const std::chrono::steady_clock::time_point& start, double n) {
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n;
+}
+
+} // namespace
+
+int main(int argc, char** args) {
+
+  const int nHits = argc > 1 ? std::stoi(args[1]) : 1000000;
+  const int nRepetitions = argc > 2 ? std::stoi(args[2]) : 5;
+
+  std::mt19937_64 rng(2718281828);
+  std::cout << std::setw(8) << "layout" << std::setw(16) << "cellID ns" << std::setw(24) << "row position+theta ns"
+            << std::endl;
+  for (const auto& configuration : kConfigurations) {
+    const bool endcap = configuration.name == "endcap";
+    const std::string typeField = endcap ? "type:3," : "";
+
+    // theta segmentation: cellID
+    PhiTheta phiTheta("system:4," + typeField + "layer:6,row:11,theta:11,phi:10");
+    configure(phiTheta, configuration);
+    phiTheta.defineCellsInRZplan();
+    const std::vector<Hit> hits = makeHits(phiTheta, nHits, endcap, rng);
+    std::vector<CellID> cellIDs(hits.size());
+    const auto start = std::chrono::steady_clock::now();
+    for (int rep = 0; rep < nRepetitions; rep++)
+      for (std::size_t i = 0; i < hits.size(); i++)
+        cellIDs[i] = phiTheta.cellID(Vector3D(), hits[i].position, hits[i].volumeID);
+    const double nsCellID = nsSince(start, double(nRepetitions) * hits.size());
+
+    long mismatches = 0;
+    for (std::size_t i = 0; i < hits.size(); i++) {
+      const unsigned layer = phiTheta.decoder()->get(hits[i].volumeID, "layer");
+      const double z = hits[i].position.z();
+      int expected = -1;
+      for (const int bin : phiTheta.thetaBins(layer))
+        if (z > phiTheta.cellEdges(layer, bin).first && z < phiTheta.cellEdges(layer, bin).second)
+          expected = bin;
+      mismatches += expected != phiTheta.decoder()->get(cellIDs[i], "theta");
+    }
+    std::stringstream msg;
+    msg << "cellID finds the theta bin of the linear scan in the " << configuration.name;
+    test(mismatches, 0L, msg.str());
+
+    // row segmentation: position and cellTheta, which look up the cell edges
+    PhiRow phiRow("system:4," + typeField + "layer:6,row:-10,phi:10");
+    configure(phiRow, configuration);
+    phiRow.calculateLayerRadii();
+    std::uniform_real_distribution<double> uniform(0., 1.);
+    std::vector<CellID> rowIDs;
+    for (const auto& hit : hits) {
+      CellID cID = hit.volumeID;
+      const unsigned layer = phiRow.decoder()->get(cID, "layer");
+      const int nRows = endcap ? phiRow.cellIndexes(layer).size() / 2 : phiRow.cellIndexes(layer).size();
+      const int row = 1 + std::min(int(uniform(rng) * nRows), nRows - 1);
+      phiRow.decoder()->set(cID, "row", endcap && hit.position.z() < 0 ? -row : row);
+      rowIDs.push_back(cID);
+    }
+    double sum = 0.;
+    const auto rowStart = std::chrono::steady_clock::now();
+    for (int rep = 0; rep < nRepetitions; rep++)
+      for (const CellID cID : rowIDs)
+        sum += phiRow.position(cID).z() + phiRow.cellTheta(cID)[0];
+    const double nsRow = nsSince(rowStart, double(nRepetitions) * rowIDs.size());
+
+    mismatches = 0;
+    for (const CellID cID : rowIDs) {
+      const unsigned layer = phiRow.decoder()->get(cID, "layer");
+      const auto& [zmin, zmax] = phiRow.cellEdges(layer, phiRow.decoder()->get(cID, "row"));
+      const double z = phiRow.position(cID).z();
+      mismatches += !(z > zmin && z < zmax);
+    }
+    msg.str("");
+    msg << "the row cell edges contain the cell positions in the " << configuration.name;
+    test(mismatches == 0 && std::isfinite(sum), msg.str());
+
+    std::cout << std::setw(8) << configuration.name << std::setw(16) << nsCellID << std::setw(24) << nsRow
+              << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,157 @@
+// Multi-threaded stress test of the HCal segmentations FCCSWHCalPhiTheta_k4geo and FCCSWHCalPhiRow_k4geo:
+// several threads call cellID, position, neighbours and cellTheta on a freshly configured segmentation, so that
+// they race to build its layer and cell tables, and the results are compared with those of a single thread.
+// The configuration is the one of the ALLEGRO o1 v03 HCal barrel. Best run in a ThreadSanitizer build
+//
+// Usage: HCalSegmentationMTTest [nThreads] [nRepetitions]
+
+#include "detectorSegmentations/FCCSWHCalPhiRow_k4geo.h"
+#include "detectorSegmentations/FCCSWHCalPhiTheta_k4geo.h"
+
+#include <DD4hep/DDTest.h>
+
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+static dd4hep::DDTest test("HCalSegmentationMTTest");
+
+using dd4hep::DDSegmentation::CellID;
+using dd4hep::DDSegmentation::Segmentation;
+using dd4hep::DDSegmentation::Vector3D;
+
+namespace {
+
+const std::map<std::string, std::string> kBarrelParameters = {{"detLayout", "0"},
+                                                              {"offset_z", "0"},
+                                                              {"offset_r", "281.05"},
+                                                              {"numLayers", "4 6 3"},
+                                                              {"dRlayer", "5 10 20"},
+                                                              {"phi_bins", "256"},
+                                                              {"offset_phi", "-3.129321"},
+                                                              {"grid_size_theta", "0.022180"},
+                                                              {"offset_theta", "0.783406"},
+                                                              {"dz_row", "1.8"},
+                                                              {"grid_size_row", "1 1 1 1 1 1 1 1 1 1 1 1 1"}};
+
+template <typename SEGMENTATION>
+SEGMENTATION* makeSegmentation(const std::string& encoding, const std::string& widthZ) {
+  auto* segmentation = new SEGMENTATION(encoding);
+  for (auto* parameter : segmentation->parameters()) {
+    const auto value = kBarrelParameters.find(parameter->name());
+    if (value != kBarrelParameters.end())
+      parameter->setValue(value->second);
+  }
+  segmentation->parameter("width_z")->setValue(widthZ);
+  return segmentation;
+}
+
+/// Volume IDs and global positions of hits spread over all layers, rows and phi bins of the barrel
+struct Hit {
+  CellID volumeID;
+  Vector3D position;
+};
+
+std::vector<Hit> makeHits(const Segmentation& segmentation, bool withRow) {
+  const double radii[] = {2.5, 7.5, 12.5, 17.5, 22.5, 32.5, 42.5, 52.5, 62.5, 72.5, 90., 110., 130.};
+  const double halfWidth = 279.55, dzRow = 1.8;
+  std::vector<Hit> hits;
+  for (unsigned layer = 0; layer < 13; layer++) {
+    for (int iz = 0; iz < 311; iz += 7) {
+      const double z = -halfWidth + (iz + 0.5) * dzRow;
+      for (int iphi = 0; iphi < 256; iphi += 37) {
+        const double r = 281.05 + radii[layer], phi = -M_PI + (iphi + 0.3) * 2 * M_PI / 256;
+        CellID volumeID = 0;
+        segmentation.decoder()->set(volumeID, "system", 8);
+        segmentation.decoder()->set(volumeID, "layer", layer);
+        if (withRow)
+          segmentation.decoder()->set(volumeID, "row", iz);
+        hits.push_back({volumeID, Vector3D(r * std::cos(phi), r * std::sin(phi), z)});
+      }
+    }
+  }
+  return hits;
+}
+
+/// Everything the segmentation computes for the hits, flattened
+template <typename SEGMENTATION>
+std::vector<double> evaluate(const SEGMENTATION& segmentation, const std::vector<Hit>& hits) {
+  std::vector<double> results;
+  for (const auto& hit : hits) {
+    const CellID cID = segmentation.cellID(Vector3D(), hit.position, hit.volumeID);
+    results.push_back(cID);
+    const Vector3D position = segmentation.position(cID);
+    results.insert(results.end(), {position.x(), position.y(), position.z()});
+    for (const double theta : segmentation.cellTheta(cID))
+      results.push_back(theta);
+    std::vector<uint64_t> neighbours;
+    if constexpr (std::is_same_v<SEGMENTATION, dd4hep::DDSegmentation::FCCSWHCalPhiTheta_k4geo>)
+      neighbours = segmentation.neighbours(cID, true);
+    else
+      neighbours = segmentation.neighbours(cID);
+    results.push_back(neighbours.size());
+    results.insert(results.end(), neighbours.begin(), neighbours.end());
+  }
+  return results;
+}
+
+/// Number of threads whose results differ from the single threaded ones, each thread using a new segmentation
+template <typename SEGMENTATION>
+int countMismatches(const std::string& encoding, const std::string& widthZ, bool withRow, int nThreads,
+                    int nRepetitions) {
+  const SEGMENTATION* reference = makeSegmentation<SEGMENTATION>(encoding, widthZ);
+  const std::vector<Hit> hits = makeHits(*reference, withRow);
+  const std::vector<double> expected = evaluate(*reference, hits);
+  delete reference;
+
+  int mismatches = 0;
+  for (int rep = 0; rep < nRepetitions; rep++) {
+    const SEGMENTATION* segmentation = makeSegmentation<SEGMENTATION>(encoding, widthZ);
+    std::vector<std::vector<double>> results(nThreads);
+    std::atomic<int> ready{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nThreads; t++) {
+      threads.emplace_back([&, t]() {
+        // start all threads together, none of them finds the tables already filled
+        ready++;
+        while (ready < nThreads)
+          std::this_thread::yield();
+        results[t] = evaluate(*segmentation, hits);
+      });
+    }
+    for (auto& thread : threads)
+      thread.join();
+    for (const auto& result : results)
+      mismatches += result != expected;
+    delete segmentation;
+  }
+  return mismatches;
+}
+
+} // namespace
+
+int main(int argc, char** args) {
+
+  const int nThreads = argc > 1 ? std::stoi(args[1]) : 8;
+  const int nRepetitions = argc > 2 ? std::stoi(args[2]) : 20;
+
+  int mismatches = countMismatches<dd4hep::DDSegmentation::FCCSWHCalPhiTheta_k4geo>(
+      "system:4,layer:5,row:9,theta:9,phi:10", "560", false, nThreads, nRepetitions);
+  std::stringstream msg;
+  msg << "FCCSWHCalPhiTheta_k4geo gives the same results in " << nThreads << " threads as in one";
+  test(mismatches, 0, msg.str());
+
+  mismatches = countMismatches<dd4hep::DDSegmentation::FCCSWHCalPhiRow_k4geo>("system:4,layer:5,row:9,phi:10",
+                                                                              "559.1", true, nThreads, nRepetitions);
+  msg.str("");
+  msg << "FCCSWHCalPhiRow_k4geo gives the same results in " << nThreads << " threads as in one";
+  test(mismatches, 0, msg.str());
+
+  return 0;
+}
@@ -0,0 +1,90 @@
+// Microbenchmark of the hit lookup of the sensitive actions, comparing the scan of the collection with
+// CellIDCompare and the keyed lookup of plugins/Geant4HitLookup.h in ns/step for collections of
+// 10^2 to 10^6 hits, and checking that both find the same hits
+//
+// Usage: HitLookupBenchmark [nSteps] [maxHits]
+
+#include "Geant4HitLookup.h"
+
+#include <DD4hep/DDTest.h>
+#include <DDG4/Geant4Data.h>
+#include <DDG4/Geant4SensDetAction.inl>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static dd4hep::DDTest test("HitLookupBenchmark");
+
+using dd4hep::sim::CellIDCompare;
+using dd4hep::sim::Geant4Calorimeter;
+using dd4hep::sim::Geant4HitCollection;
+
+typedef Geant4Calorimeter::Hit Hit;
+
+int main(int argc, char** args) {
+
+  const int nSteps = argc > 1 ? std::stoi(args[1]) : 1000000;
+  const int maxHits = argc > 2 ? std::stoi(args[2]) : 1000000;
+  // The scans of the large collections are limited to this many hit comparisons
+  const double maxScanned = 2e9;
+
+  std::mt19937_64 rng(1988301045);
+  std::cout << std::setw(12) << "hits" << std::setw(16) << "scan ns" << std::setw(16) << "keyed ns" << std::setw(16)
+            << "create ns" << std::endl;
+  for (int nHits = 100; nHits <= maxHits; nHits *= 10) {
+    // Sparse cellIDs, as from a segmentation, each step hitting one of the existing cells
+    std::vector<dd4hep::VolumeID> cellIDs(nHits);
+    for (auto& id : cellIDs)
+      id = rng();
+    std::uniform_int_distribution<int> cell(0, nHits - 1);
+    std::vector<dd4hep::VolumeID> steps(std::max(nSteps, 1));
+    for (auto& id : steps)
+      id = cellIDs[cell(rng)];
+
+    // The hits created through the helper, as the sensitive actions do
+    Geant4HitCollection coll("HitLookupBenchmark", "hits", nullptr, (const Hit*)nullptr);
+    const auto createStart = std::chrono::steady_clock::now();
+    for (const auto id : cellIDs) {
+      dd4hep::sim::findOrCreateHit<Hit>(&coll, id, [id]() {
+        Hit* hit = new Hit();
+        hit->cellID = id;
+        return hit;
+      });
+    }
+    const double nsCreate =
+        std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - createStart).count() / nHits;
+
+    double deposit = 0.;
+    const auto keyedStart = std::chrono::steady_clock::now();
+    for (const auto id : steps)
+      deposit += dd4hep::sim::findHit<Hit>(&coll, id)->energyDeposit;
+    const double nsKeyed =
+        std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - keyedStart).count() / steps.size();
+
+    const int nScanned = std::max(1, std::min(int(steps.size()), int(maxScanned / nHits)));
+    int mismatches = 0;
+    const auto scanStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < nScanned; i++) {
+      const Hit* hit = coll.find<Hit>(CellIDCompare<Hit>(steps[i]));
+      mismatches += hit != dd4hep::sim::findHit<Hit>(&coll, steps[i]);
+    }
+    const double nsScan =
+        std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - scanStart).count() / nScanned;
+
+    std::stringstream msg;
+    msg << "keyed lookup finds the hits of the scan in a collection of " << nHits << " hits";
+    test(mismatches, 0, msg.str());
+    test(int(coll.GetSize()), nHits, "one hit per cellID");
+
+    std::cout << std::setw(12) << nHits << std::setw(16) << nsScan << std::setw(16) << nsKeyed << std::setw(16)
+              << nsCreate << "   (" << deposit << ")" << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,155 @@
+// Test of the parallel neighbour and crosstalk maps of the module-theta merged readout, by default in the
+// configuration of the ALLEGRO o1 v03 ECal barrel (1536 modules, 11 layers, merging of ECalBarrelModuleThetaMerged):
+// the maps are the same for all numbers of threads, contain the neighbours given cell by cell by
+// neighbours_ModuleThetaMerged and getNeighboursModuleThetaMerged, and are written to and read back from a file.
+// Prints the wall time of the maps for each number of threads.
+//
+// The full barrel takes tens of seconds per number of threads and is run by hand as a benchmark, the ctest uses
+// fewer modules (an even number, the modules are merged by 2) and the first layers
+//
+// Usage: ModuleThetaMergedNeighbourMapsTest [nModules] [nLayers] [nThreads...]
+
+#include "detectorCommon/DetUtils_k4geo.h"
+#include "detectorCommon/ModuleThetaMergedNeighbourMaps_k4geo.h"
+#include "detectorCommon/xtalk_neighbors_moduleThetaMergedSegmentation.h"
+
+#include <DD4hep/DDTest.h>
+#include <DD4hep/Detector.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static dd4hep::DDTest test("ModuleThetaMergedNeighbourMapsTest");
+
+using dd4hep::DDSegmentation::CellNeighbourTable_k4geo;
+using dd4hep::DDSegmentation::FCCSWGridModuleThetaMerged_k4geo;
+
+namespace {
+
+double secondsSince(const std::chrono::steady_clock::time_point& start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool sameTables(const CellNeighbourTable_k4geo& a, const CellNeighbourTable_k4geo& b) {
+  if (a.cells() != b.cells() || a.numberOfNeighbours() != b.numberOfNeighbours() || a.hasWeights() != b.hasWeights())
+    return false;
+  for (const auto cID : a.cells()) {
+    const auto neighboursA = a.neighbours(cID), neighboursB = b.neighbours(cID);
+    const auto weightsA = a.weights(cID), weightsB = b.weights(cID);
+    if (!std::equal(neighboursA.begin(), neighboursA.end(), neighboursB.begin(), neighboursB.end()) ||
+        !std::equal(weightsA.begin(), weightsA.end(), weightsB.begin(), weightsB.end()))
+      return false;
+  }
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char** args) {
+
+  const int nModules = argc > 1 ? std::stoi(args[1]) : 1536;
+  const int nLayers = argc > 2 ? std::min(std::stoi(args[2]), 11) : 11;
+  std::vector<unsigned> threadCounts;
+  for (int i = 3; i < argc; i++)
+    threadCounts.push_back(std::stoul(args[i]));
+  if (threadCounts.empty())
+    threadCounts = {1, 2, 4, 8, 16, 32, 64};
+
+  // the segmentation takes the numbers of modules and layers from the detector constants
+  auto& description = dd4hep::Detector::getInstance();
+  description.addConstant(dd4hep::Constant("ECalBarrelNumPlanes", std::to_string(nModules)));
+  description.addConstant(dd4hep::Constant("ECalBarrelNumLayers", std::to_string(nLayers)));
+  // merging of the first nLayers layers of ECalBarrelModuleThetaMerged
+  const std::string mergedThetaCells = std::string("4 1 4 4 4 4 4 4 4 4 4").substr(0, 2 * nLayers - 1);
+  const std::string mergedModules = std::string("2 2 2 2 2 2 2 2 2 2 2").substr(0, 2 * nLayers - 1);
+  FCCSWGridModuleThetaMerged_k4geo segmentation("system:4,cryo:1,type:3,subtype:3,layer:8,module:11,theta:10");
+  segmentation.parameter("mergedCells_Theta")->setValue(mergedThetaCells);
+  segmentation.parameter("mergedModules")->setValue(mergedModules);
+  segmentation.parameter("grid_size_theta")->setValue("0.0024543693");
+  segmentation.parameter("offset_theta")->setValue("0.5902785");
+
+  // cells of each layer, as numberOfCells gives them for the ALLEGRO ECal barrel volumes
+  std::vector<std::array<uint, 3>> numberOfCells;
+  for (int layer = 0; layer < segmentation.nLayers(); layer++)
+    numberOfCells.push_back({uint(nModules) / 2, 784u / segmentation.mergedThetaCells(layer), 4});
+  dd4hep::DDSegmentation::CellID volumeID = 0;
+  segmentation.decoder()->set(volumeID, "system", 4);
+  const std::vector<std::string> fieldNames = {"layer", "module", "theta"};
+
+  std::cout << std::setw(10) << "threads" << std::setw(16) << "neighbours s" << std::setw(16) << "crosstalk s"
+            << std::endl;
+  CellNeighbourTable_k4geo neighbours, crosstalk;
+  for (const unsigned nThreads : threadCounts) {
+    auto start = std::chrono::steady_clock::now();
+    const auto threadNeighbours =
+        det::utils::neighbourTable_ModuleThetaMerged(segmentation, volumeID, numberOfCells, true, nThreads);
+    const double neighbourSeconds = secondsSince(start);
+    start = std::chrono::steady_clock::now();
+    const auto threadCrosstalk =
+        det::utils::crosstalkTable_ModuleThetaMerged(segmentation, volumeID, numberOfCells, nThreads);
+    const double crosstalkSeconds = secondsSince(start);
+    std::cout << std::setw(10) << nThreads << std::setw(16) << neighbourSeconds << std::setw(16) << crosstalkSeconds
+              << std::endl;
+
+    if (neighbours.numberOfCells() == 0) {
+      neighbours = threadNeighbours;
+      crosstalk = threadCrosstalk;
+      continue;
+    }
+    std::stringstream msg;
+    msg << "the maps in " << nThreads << " threads are the ones in " << threadCounts.front();
+    test(sameTables(threadNeighbours, neighbours) && sameTables(threadCrosstalk, crosstalk), msg.str());
+  }
+
+  const auto cells = det::utils::cells_ModuleThetaMerged(segmentation, volumeID, numberOfCells);
+  test(neighbours.cells() == cells && crosstalk.cells() == cells, "the maps contain all the cells");
+
+  // neighbours of a sample of the cells, computed one by one
+  long mismatches = 0;
+  for (std::size_t i = 0; i < cells.size(); i += 97) {
+    const int layer = segmentation.decoder()->get(cells[i], "layer");
+    const int maxTheta = 4 + (numberOfCells[layer][1] - 1) * segmentation.mergedThetaCells(layer);
+    auto expected = det::utils::neighbours_ModuleThetaMerged(segmentation, *segmentation.decoder(), fieldNames,
+                                                             {{0, nLayers - 1}, {0, nModules - 1}, {4, maxTheta}},
+                                                             cells[i], true);
+    std::sort(expected.begin(), expected.end());
+    const auto found = neighbours.neighbours(cells[i]);
+    mismatches += !std::equal(expected.begin(), expected.end(), found.begin(), found.end());
+
+    std::vector<std::vector<std::pair<int, int>>> extremes;
+    for (uint l = 0; l < numberOfCells.size(); l++)
+      extremes.push_back({{0, nLayers - 1},
+                          {0, nModules - 1},
+                          {4, 4 + (int(numberOfCells[l][1]) - 1) * segmentation.mergedThetaCells(l)}});
+    auto expectedXtalk = det::crosstalk::getNeighboursModuleThetaMerged(segmentation, *segmentation.decoder(),
+                                                                        fieldNames, extremes, cells[i]);
+    std::sort(expectedXtalk.begin(), expectedXtalk.end());
+    const auto foundXtalk = crosstalk.neighbours(cells[i]);
+    const auto foundCoefficients = crosstalk.weights(cells[i]);
+    bool same = expectedXtalk.size() == foundXtalk.size();
+    for (std::size_t k = 0; same && k < expectedXtalk.size(); k++)
+      same = expectedXtalk[k].first == foundXtalk.begin()[k] && expectedXtalk[k].second == foundCoefficients[k];
+    mismatches += !same;
+  }
+  test(mismatches, 0L, "the maps contain the neighbours computed for each cell");
+
+  CellNeighbourTable_k4geo readNeighbours, readCrosstalk;
+  test(neighbours.write("ModuleThetaMergedNeighbourMapsTest_neighbours.bin") &&
+           crosstalk.write("ModuleThetaMergedNeighbourMapsTest_crosstalk.bin") &&
+           readNeighbours.read("ModuleThetaMergedNeighbourMapsTest_neighbours.bin") &&
+           readCrosstalk.read("ModuleThetaMergedNeighbourMapsTest_crosstalk.bin") &&
+           sameTables(readNeighbours, neighbours) && sameTables(readCrosstalk, crosstalk),
+       "the maps are written and read back");
+  std::remove("ModuleThetaMergedNeighbourMapsTest_neighbours.bin");
+  std::remove("ModuleThetaMergedNeighbourMapsTest_crosstalk.bin");
+  std::cout << neighbours.numberOfCells() << " cells, " << neighbours.numberOfNeighbours() << " neighbours, "
+            << crosstalk.numberOfNeighbours() << " crosstalk neighbours" << std::endl;
+
+  return 0;
+}
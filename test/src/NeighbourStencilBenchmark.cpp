@@ -0,0 +1,134 @@
+// Microbenchmark of det::utils::NeighbourStencil against det::utils::neighbours, for the layer, module and theta
+// fields of the ALLEGRO ECal barrel readout (module cyclic), with and without the diagonal neighbours: time per cell
+// over random cellIDs. Checks that both give the same neighbours, and that these are all the cells that differ by
+// at most one in each field (by one in only one field without the diagonal ones), within the extremes
+//
+// Usage: NeighbourStencilBenchmark [nCells]
+
+#include "detectorCommon/DetUtils_k4geo.h"
+
+#include <DD4hep/DDTest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static dd4hep::DDTest test("NeighbourStencilBenchmark");
+
+namespace {
+
+double nsSince(const std::chrono::steady_clock::time_point& start, double n) {
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n;
+}
+
+/// Neighbours found by trying all the changes of the fields by -1, 0 or +1, sorted
+std::vector<uint64_t> bruteForceNeighbours(const dd4hep::DDSegmentation::BitFieldCoder& aDecoder,
+                                           const std::vector<std::string>& aFieldNames,
+                                           const std::vector<std::pair<int, int>>& aFieldExtremes,
+                                           const std::vector<bool>& aFieldCyclic, bool aDiagonal, uint64_t aCellId) {
+  std::vector<uint64_t> neighbours;
+  int nPatterns = 1;
+  for (std::size_t i = 0; i < aFieldNames.size(); i++)
+    nPatterns *= 3;
+  for (int pattern = 0; pattern < nPatterns; pattern++) {
+    uint64_t cID = aCellId;
+    int nChanged = 0;
+    bool valid = true;
+    for (int i = 0, rest = pattern; i < int(aFieldNames.size()); i++, rest /= 3) {
+      const int change = rest % 3 - 1;
+      if (change == 0)
+        continue;
+      nChanged++;
+      int id = aDecoder.get(aCellId, aFieldNames[i]) + change;
+      const auto& [min, max] = aFieldExtremes[i];
+      if (aFieldCyclic[i])
+        id = id < min ? max : (id > max ? min : id);
+      valid = valid && id >= min && id <= max;
+      if (valid)
+        aDecoder.set(cID, aFieldNames[i], id);
+    }
+    if (valid && nChanged > 0 && (aDiagonal || nChanged == 1))
+      neighbours.push_back(cID);
+  }
+  std::sort(neighbours.begin(), neighbours.end());
+  return neighbours;
+}
+
+} // namespace
+
+int main(int argc, char** args) {
+
+  const int nCells = argc > 1 ? std::stoi(args[1]) : 1000000;
+
+  const dd4hep::DDSegmentation::BitFieldCoder decoder(
+      "system:4,cryo:1,type:3,subtype:3,layer:8,module:11,theta:10,phi:-10");
+  const std::vector<std::string> fieldNames = {"layer", "module", "theta"};
+  const std::vector<std::pair<int, int>> fieldExtremes = {{0, 10}, {0, 1535}, {0, 799}};
+  const std::vector<bool> fieldCyclic = {false, true, false};
+
+  // random cells, each field at one of its extremes in a tenth of them
+  std::mt19937_64 rng(1234567);
+  std::uniform_real_distribution<double> uniform(0., 1.);
+  std::vector<uint64_t> cells(nCells);
+  for (auto& cID : cells) {
+    cID = 0;
+    decoder.set(cID, "system", 4);
+    decoder.set(cID, "phi", -7);
+    for (std::size_t i = 0; i < fieldNames.size(); i++) {
+      const auto& [min, max] = fieldExtremes[i];
+      const double u = uniform(rng);
+      decoder.set(cID, fieldNames[i], u < 0.05 ? min : (u < 0.1 ? max : min + int(uniform(rng) * (max - min + 1))));
+    }
+  }
+
+  std::cout << std::setw(10) << "diagonal" << std::setw(16) << "neighbours ns" << std::setw(14) << "stencil ns"
+            << std::endl;
+  for (const bool diagonal : {false, true}) {
+    // the original function, allocating its result and decoding the fields by name for each cell
+    uint64_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const uint64_t cID : cells) {
+      const auto neighbours = det::utils::neighbours(decoder, fieldNames, fieldExtremes, cID, fieldCyclic, diagonal);
+      for (std::size_t k = 0; k < neighbours.size(); k++)
+        checksum += (k + 1) * neighbours[k];
+    }
+    const double nsNeighbours = nsSince(start, cells.size());
+
+    // the stencil, filling the same buffer for all the cells
+    const det::utils::NeighbourStencil stencil(decoder, fieldNames, fieldExtremes, fieldCyclic, diagonal);
+    std::vector<uint64_t> buffer(stencil.maxNeighbours());
+    uint64_t stencilChecksum = 0;
+    start = std::chrono::steady_clock::now();
+    for (const uint64_t cID : cells) {
+      const std::size_t n = stencil.neighbours(cID, buffer);
+      for (std::size_t k = 0; k < n; k++)
+        stencilChecksum += (k + 1) * buffer[k];
+    }
+    const double nsStencil = nsSince(start, cells.size());
+
+    long mismatches = checksum != stencilChecksum, wrongNeighbours = 0;
+    for (std::size_t i = 0; i < cells.size(); i += 100) {
+      std::vector<uint64_t> fromStencil(buffer.begin(), buffer.begin() + stencil.neighbours(cells[i], buffer));
+      mismatches +=
+          fromStencil != det::utils::neighbours(decoder, fieldNames, fieldExtremes, cells[i], fieldCyclic, diagonal);
+      std::sort(fromStencil.begin(), fromStencil.end());
+      wrongNeighbours +=
+          fromStencil != bruteForceNeighbours(decoder, fieldNames, fieldExtremes, fieldCyclic, diagonal, cells[i]);
+    }
+    std::stringstream msg;
+    msg << "the stencil gives the neighbours of det::utils::neighbours" << (diagonal ? " with diagonals" : "");
+    test(mismatches, 0L, msg.str());
+    msg.str("");
+    msg << "the neighbours are the cells next to the cell" << (diagonal ? " with diagonals" : "");
+    test(wrongNeighbours, 0L, msg.str());
+    std::cout << std::setw(10) << diagonal << std::setw(16) << nsNeighbours << std::setw(14) << nsStencil
+              << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,144 @@
+// Microbenchmark of the particle indexing of the EDM4hep DRC output on synthetic particle maps of 10^3 to
+// 10^6 particles: the parent and daughter links resolved through a std::map of the particle IDs or through
+// the Geant4ParticleIndex reused across events, and the hit contributions resolved through a map lookup of
+// the track equivalents or through their flat copy. Checks that both give the same indices
+//
+// Usage: ParticleIndexBenchmark [maxParticles] [nEvents]
+
+#include "Geant4ParticleIndex.h"
+
+#include <DD4hep/DDTest.h>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static dd4hep::DDTest test("ParticleIndexBenchmark");
+
+using dd4hep::sim::Geant4ParticleIndex;
+
+namespace {
+
+/// Synthetic event: a binary tree of particles and the Geant4 tracks they are equivalent to
+struct Event {
+  std::map<int, int> particles;    // particle ID -> position in the tree
+  std::vector<int> treeIDs;        // particle ID at each position in the tree
+  std::map<int, int> equivalents;  // Geant4 track ID -> particle ID
+  std::vector<int> contributions;  // Geant4 track IDs of the hit contributions
+};
+
+Event makeEvent(int nParticles, int idStride, std::mt19937_64& rng) {
+  Event event;
+  for (int i = 0; i < nParticles; i++) {
+    event.treeIDs.push_back(i * idStride);
+    event.particles[i * idStride] = i;
+  }
+  // three tracks per particle, the secondaries not kept being attached to their parent
+  std::uniform_int_distribution<int> particle(0, nParticles - 1);
+  for (int track = 1; track <= 3 * nParticles; track++)
+    event.equivalents[track] = event.treeIDs[particle(rng)];
+  std::uniform_int_distribution<int> track(1, 3 * nParticles);
+  for (int i = 0; i < 10 * nParticles; i++)
+    event.contributions.push_back(track(rng));
+  return event;
+}
+
+double nsSince(const std::chrono::steady_clock::time_point& start, double n) {
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n;
+}
+
+} // namespace
+
+int main(int argc, char** args) {
+
+  const int maxParticles = argc > 1 ? std::stoi(args[1]) : 1000000;
+  const int nEvents = argc > 2 ? std::stoi(args[2]) : 3;
+
+  std::mt19937_64 rng(1988301045);
+  Geant4ParticleIndex particleIndex, trackIndex;
+  std::cout << std::setw(10) << "particles" << std::setw(8) << "stride" << std::setw(18) << "map links ns/p"
+            << std::setw(18) << "flat links ns/p" << std::setw(18) << "map contrib ns" << std::setw(18)
+            << "flat contrib ns" << std::endl;
+  for (int nParticles = 1000; nParticles <= maxParticles; nParticles *= 10) {
+    // rebased particle IDs as from the DDG4 particle handler, and sparse IDs for the hash map
+    for (const int idStride : {1, 1000}) {
+      const Event event = makeEvent(nParticles, idStride, rng);
+      double nsMapLinks = 0., nsFlatLinks = 0., nsMapContrib = 0., nsFlatContrib = 0.;
+      long mismatches = 0;
+
+      for (int iev = 0; iev < nEvents; iev++) {
+        // The parent and daughter links of the binary tree
+        std::vector<int> mapLinks, flatLinks;
+        mapLinks.reserve(3 * nParticles);
+        flatLinks.reserve(3 * nParticles);
+        auto start = std::chrono::steady_clock::now();
+        {
+          std::map<int, int> p_ids;
+          int cnt = 0;
+          for (const auto& p : event.particles)
+            p_ids[p.first] = cnt++;
+          for (const auto& p : event.particles) {
+            const int i = p.second;
+            for (const int d : {2 * i + 1, 2 * i + 2})
+              if (d < nParticles)
+                mapLinks.push_back(p_ids.find(event.treeIDs[d])->second);
+            if (i > 0)
+              mapLinks.push_back(p_ids.find(event.treeIDs[(i - 1) / 2])->second);
+          }
+        }
+        nsMapLinks += nsSince(start, nParticles);
+
+        start = std::chrono::steady_clock::now();
+        {
+          particleIndex.reset(event.particles.begin()->first, event.particles.rbegin()->first, nParticles);
+          int cnt = 0;
+          for (const auto& p : event.particles)
+            particleIndex.set(p.first, cnt++);
+          for (const auto& p : event.particles) {
+            const int i = p.second;
+            for (const int d : {2 * i + 1, 2 * i + 2})
+              if (d < nParticles)
+                flatLinks.push_back(particleIndex.find(event.treeIDs[d]));
+            if (i > 0)
+              flatLinks.push_back(particleIndex.find(event.treeIDs[(i - 1) / 2]));
+          }
+        }
+        nsFlatLinks += nsSince(start, nParticles);
+        mismatches += mapLinks != flatLinks;
+
+        // The particles of the hit contributions
+        long mapSum = 0, flatSum = 0;
+        start = std::chrono::steady_clock::now();
+        for (const int track : event.contributions)
+          mapSum += event.equivalents.find(track)->second;
+        nsMapContrib += nsSince(start, event.contributions.size());
+
+        start = std::chrono::steady_clock::now();
+        trackIndex.reset(event.equivalents.begin()->first, event.equivalents.rbegin()->first,
+                         event.equivalents.size());
+        for (const auto& [track, particle] : event.equivalents)
+          trackIndex.set(track, particle);
+        for (const int track : event.contributions)
+          flatSum += trackIndex.find(track);
+        nsFlatContrib += nsSince(start, event.contributions.size());
+        mismatches += mapSum != flatSum;
+      }
+
+      std::stringstream msg;
+      msg << "same particle indices for " << nParticles << " particles with ID stride " << idStride;
+      test(mismatches, 0L, msg.str());
+      std::cout << std::setw(10) << nParticles << std::setw(8) << idStride << std::setw(18) << nsMapLinks / nEvents
+                << std::setw(18) << nsFlatLinks / nEvents << std::setw(18) << nsMapContrib / nEvents << std::setw(18)
+                << nsFlatContrib / nEvents << std::endl;
+    }
+  }
+  test(particleIndex.find(-1), -1, "negative IDs are not in the index");
+  test(trackIndex.isDense(), "rebased track IDs are looked up in the vector");
+
+  return 0;
+}
@@ -0,0 +1,137 @@
+// Scaling benchmark of the event output in MT mode, in events/s versus the number of worker threads:
+// the workers simulate an event and convert it under the output lock, then either write it under the
+// lock (as Geant4Output2EDM4hep_DRC without WriterThread) or push it to the Geant4WriterQueue drained by
+// one writer thread. The simulation, conversion and write times are emulated by busy waits. Also checks
+// that the writer thread writes every event once and in the order of the pushes. The simulate and write times of
+// a sample are given by the run summary of Geant4Output2EDM4hep_DRC with one thread (run time per event and write
+// time per event)
+//
+// Usage: WriterQueueBenchmark [nEvents] [simulate us] [write us] [maxThreads]
+
+#include "Geant4WriterQueue.h"
+
+#include <DD4hep/DDTest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+static dd4hep::DDTest test("WriterQueueBenchmark");
+
+namespace {
+
+void busyWait(double us) {
+  const auto end = std::chrono::steady_clock::now() + std::chrono::duration<double, std::micro>(us);
+  while (std::chrono::steady_clock::now() < end) {
+  }
+}
+
+struct Event {
+  int number{-1};
+  std::vector<char> payload;
+};
+
+/// Events/s with nThreads workers, the events in the order they were converted and written
+double eventsPerSecond(int nEvents, int nThreads, double simulateUs, double convertUs, double writeUs, bool queued,
+                       std::vector<int>& converted, std::vector<int>& written) {
+  converted.clear();
+  written.clear();
+  auto write = [&written, writeUs](Event& event) {
+    busyWait(writeUs);
+    written.push_back(event.number);
+  };
+
+  std::mutex outputMutex;
+  int nextEvent = 0;
+  std::vector<std::thread> workers;
+  const auto start = std::chrono::steady_clock::now();
+  {
+    dd4hep::sim::Geant4WriterQueue<Event> queue(16, write);
+    for (int t = 0; t < nThreads; t++) {
+      workers.emplace_back([&]() {
+        while (true) {
+          int number;
+          {
+            std::lock_guard<std::mutex> lock(outputMutex);
+            number = nextEvent++;
+          }
+          if (number >= nEvents)
+            return;
+          busyWait(simulateUs);
+          // the conversion and write of the output action are serialized by its lock
+          std::lock_guard<std::mutex> lock(outputMutex);
+          Event event{number, std::vector<char>(1024)};
+          busyWait(convertUs);
+          converted.push_back(number);
+          if (queued)
+            queue.push(std::move(event));
+          else
+            write(event);
+        }
+      });
+    }
+    for (auto& worker : workers)
+      worker.join();
+    queue.close();
+  }
+  return nEvents / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char** args) {
+
+  const int nEvents = argc > 1 ? std::stoi(args[1]) : 2000;
+  const double simulateUs = argc > 2 ? std::stod(args[2]) : 2000.;
+  const double writeUs = argc > 3 ? std::stod(args[3]) : 200.;
+  const int maxThreads = argc > 4 ? std::stoi(args[4]) : std::max(1u, std::thread::hardware_concurrency());
+  const double convertUs = 20.;
+
+  std::cout << std::setw(8) << "threads" << std::setw(16) << "locked ev/s" << std::setw(16) << "queued ev/s"
+            << std::endl;
+  for (int nThreads = 1; nThreads <= maxThreads; nThreads *= 2) {
+    std::vector<int> converted, written;
+    const double locked = eventsPerSecond(nEvents, nThreads, simulateUs, convertUs, writeUs, false, converted, written);
+    const double queued = eventsPerSecond(nEvents, nThreads, simulateUs, convertUs, writeUs, true, converted, written);
+
+    // pushed under the output lock, the events are written in the order they were converted
+    std::vector<int> sorted(written);
+    std::sort(sorted.begin(), sorted.end());
+    bool allOnce = int(sorted.size()) == nEvents;
+    for (int i = 0; allOnce && i < nEvents; i++)
+      allOnce = sorted[i] == i;
+    std::stringstream msg;
+    msg << "writer thread writes every event once, in the order of the pushes, with " << nThreads << " workers";
+    test(allOnce && written == converted, msg.str());
+
+    std::cout << std::setw(8) << nThreads << std::setw(16) << locked << std::setw(16) << queued << std::endl;
+  }
+
+  // The first exception of the write function is rethrown when closing, after writing the other items
+  std::vector<int> written;
+  bool rethrown = false;
+  {
+    dd4hep::sim::Geant4WriterQueue<int> queue(2, [&written](int& item) {
+      if (item == 3)
+        throw std::runtime_error("write failed");
+      written.push_back(item);
+    });
+    for (int i = 0; i < 10; i++)
+      queue.push(int(i));
+    try {
+      queue.close();
+    } catch (const std::runtime_error&) {
+      rethrown = true;
+    }
+  }
+  test(rethrown && written.size() == 9, "write exception rethrown by close, other items written");
+
+  return 0;
+}